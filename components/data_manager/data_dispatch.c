@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+#include "data_dispatch.h"
+#include "data_manager.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "error_handler.h"
+
+static const char *TAG = "data_dispatch";
+
+#define DISPATCH_TASK_STACK_SIZE    4096
+#define DISPATCH_TASK_PRIORITY      (tskIDLE_PRIORITY + 2)
+
+typedef struct {
+    const char *source;             // Points into the source table, entries are never removed
+    union {
+        sensor_sample_t sample;     // Raw subscribers
+        data_manager_rollup_t rollup;   // Rollup subscribers
+    };
+} dispatch_item_t;
+
+// Bounded FIFO of one subscriber, guarded by dispatch_lock
+typedef struct {
+    uint8_t rollup_level;           // 0 for raw samples
+    sensor_data_callback_t callback;
+    sensor_rollup_callback_t rollup_callback;
+    data_manager_overflow_t overflow;
+    data_manager_deadband_t deadband;
+    bool skip_unsent;
+    sensor_sample_t *reported;      // Last sample queued per source handle, when deadband is enabled
+    uint32_t reported_sources;      // Bit per source handle with an entry in reported
+    dispatch_item_t *items;
+    uint16_t head;                  // Oldest queued item
+    data_manager_subscriber_stats_t stats;
+} subscriber_t;
+
+static subscriber_t subscribers[DATA_MANAGER_MAX_SUBSCRIBERS];
+static volatile size_t subscriber_count = 0;
+static portMUX_TYPE dispatch_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t dispatch_task_handle = NULL;
+
+// Pop the oldest item of a subscriber, returns false when its queue is empty
+static bool pop_item(subscriber_t *sub, dispatch_item_t *item) {
+    bool popped = false;
+
+    portENTER_CRITICAL(&dispatch_lock);
+    if (sub->stats.queued > 0) {
+        *item = sub->items[sub->head];
+        sub->head = (sub->head + 1) % sub->stats.depth;
+        sub->stats.queued--;
+        popped = true;
+    }
+    portEXIT_CRITICAL(&dispatch_lock);
+    return popped;
+}
+
+static void dispatch_task(void *pvParameters) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Round-robin one sample per subscriber until every queue is empty
+        bool delivered;
+        do {
+            delivered = false;
+            for (size_t i = 0; i < subscriber_count; i++) {
+                subscriber_t *sub = &subscribers[i];
+                dispatch_item_t item;
+                if (!pop_item(sub, &item)) {
+                    continue;
+                }
+
+                esp_err_t ret = sub->rollup_level ? sub->rollup_callback(item.source, &item.rollup)
+                                                  : sub->callback(item.source, &item.sample);
+                portENTER_CRITICAL(&dispatch_lock);
+                if (ret == ESP_OK) {
+                    sub->stats.delivered++;
+                } else {
+                    sub->stats.failed++;
+                }
+                portEXIT_CRITICAL(&dispatch_lock);
+                delivered = true;
+            }
+        } while (delivered);
+    }
+}
+
+esp_err_t data_dispatch_start(void) {
+    if (dispatch_task_handle != NULL) {
+        return ESP_OK;
+    }
+
+    if (xTaskCreate(dispatch_task, "data_dispatch", DISPATCH_TASK_STACK_SIZE,
+                    NULL, DISPATCH_TASK_PRIORITY, &dispatch_task_handle) != pdPASS) {
+        ERROR_LOG_ERROR(TAG, ESP_FAIL, ERROR_CAT_SYSTEM, "Failed to create dispatcher task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static bool beyond_deadband(int16_t value, int16_t reported, const data_manager_deadband_t *deadband) {
+    int32_t change = abs(value - reported);
+    if (deadband->absolute == 0 && deadband->percent == 0) {
+        return change > 0;
+    }
+    return (deadband->absolute != 0 && change > deadband->absolute) ||
+           (deadband->percent != 0 && change * 100 > abs(reported) * deadband->percent);
+}
+
+// Report-by-exception check against the last sample queued for the source; caller holds dispatch_lock
+static bool passes_deadband(const subscriber_t *sub, data_manager_handle_t handle, const sensor_sample_t *sample) {
+    if ((sub->reported_sources & (1U << handle)) == 0) {
+        return true;
+    }
+    const sensor_sample_t *reported = &sub->reported[handle];
+    return sensor_sample_is_valid(sample) != sensor_sample_is_valid(reported) ||
+           beyond_deadband(sample->temperature, reported->temperature, &sub->deadband) ||
+           beyond_deadband(sample->humidity, reported->humidity, &sub->deadband) ||
+           (sub->deadband.heartbeat_ms != 0 &&
+            sample->timestamp_ms - reported->timestamp_ms >= sub->deadband.heartbeat_ms);
+}
+
+// Append to the subscribers of one level, applying each one's overflow policy
+static void enqueue_level(uint8_t level, data_manager_handle_t handle, const dispatch_item_t *new_item) {
+    size_t count = subscriber_count;
+    if (count == 0 || dispatch_task_handle == NULL) {
+        return;
+    }
+
+    bool queued_any = false;
+    for (size_t i = 0; i < count; i++) {
+        subscriber_t *sub = &subscribers[i];
+        if (sub->rollup_level != level) {
+            continue;
+        }
+
+        // Before the deadband, so a sample the subscriber never sees cannot become its reference
+        if (level == 0 && sub->skip_unsent && (new_item->sample.flags & SENSOR_SAMPLE_UNSENT)) {
+            continue;
+        }
+
+        portENTER_CRITICAL(&dispatch_lock);
+        if (sub->reported != NULL && !passes_deadband(sub, handle, &new_item->sample)) {
+            sub->stats.suppressed++;
+            portEXIT_CRITICAL(&dispatch_lock);
+            continue;
+        }
+        bool full = (sub->stats.queued == sub->stats.depth);
+        if (full) {
+            sub->stats.dropped++;
+            if (sub->overflow == DATA_MANAGER_OVERFLOW_OVERWRITE_OLDEST) {
+                sub->head = (sub->head + 1) % sub->stats.depth;
+                sub->stats.queued--;
+                full = false;
+            }
+        }
+        if (!full) {
+            sub->items[(sub->head + sub->stats.queued) % sub->stats.depth] = *new_item;
+            sub->stats.queued++;
+            if (sub->stats.queued > sub->stats.high_water) {
+                sub->stats.high_water = sub->stats.queued;
+            }
+            // The deadband reference moves only with what the subscriber will see;
+            // a sample dropped as newest is compared against again next time
+            if (sub->reported != NULL) {
+                sub->reported[handle] = new_item->sample;
+                sub->reported_sources |= 1U << handle;
+            }
+            queued_any = true;
+        }
+        portEXIT_CRITICAL(&dispatch_lock);
+    }
+
+    if (queued_any) {
+        xTaskNotifyGive(dispatch_task_handle);
+    }
+}
+
+void data_dispatch_enqueue(data_manager_handle_t handle, const char *source, const sensor_sample_t *sample) {
+    dispatch_item_t item = { .source = source, .sample = *sample };
+    enqueue_level(0, handle, &item);
+}
+
+void data_dispatch_enqueue_rollup(const char *source, const data_manager_rollup_t *rollup) {
+    dispatch_item_t item = { .source = source, .rollup = *rollup };
+    enqueue_level(rollup->level, DATA_MANAGER_INVALID_HANDLE, &item);
+}
+
+esp_err_t data_manager_subscribe(const data_manager_subscriber_config_t *config, size_t *id) {
+    if (config == NULL || config->name == NULL || config->rollup_level > DATA_MANAGER_ROLLUP_LEVELS ||
+        (config->rollup_level == 0 && config->callback == NULL) ||
+        (config->rollup_level != 0 && config->rollup_callback == NULL)) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Invalid subscriber");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t depth = config->queue_depth ? config->queue_depth : CONFIG_ENVILOG_DISPATCH_QUEUE_DEPTH;
+    dispatch_item_t *items = calloc(depth, sizeof(dispatch_item_t));
+    sensor_sample_t *reported = NULL;
+    if (config->rollup_level == 0 && config->deadband.enabled) {
+        reported = calloc(DATA_MANAGER_MAX_SOURCES, sizeof(sensor_sample_t));
+    }
+    if (items == NULL || (config->rollup_level == 0 && config->deadband.enabled && reported == NULL)) {
+        free(items);
+        free(reported);
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM,
+            "No memory for %s queue", config->name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t slot = DATA_MANAGER_MAX_SUBSCRIBERS;
+    portENTER_CRITICAL(&dispatch_lock);
+    if (subscriber_count < DATA_MANAGER_MAX_SUBSCRIBERS) {
+        slot = subscriber_count;
+        subscriber_t *sub = &subscribers[slot];
+        memset(sub, 0, sizeof(*sub));
+        sub->rollup_level = config->rollup_level;
+        sub->callback = config->callback;
+        sub->rollup_callback = config->rollup_callback;
+        sub->overflow = config->overflow;
+        sub->deadband = config->deadband;
+        sub->skip_unsent = config->skip_unsent;
+        sub->reported = reported;
+        sub->items = items;
+        sub->stats.depth = depth;
+        strlcpy(sub->stats.name, config->name, sizeof(sub->stats.name));
+        subscriber_count++;     // Visible to publishers only once complete
+    }
+    portEXIT_CRITICAL(&dispatch_lock);
+
+    if (slot == DATA_MANAGER_MAX_SUBSCRIBERS) {
+        free(items);
+        free(reported);
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NO_MEM, ERROR_CAT_VALIDATION,
+            "Subscriber registry full, rejecting %s", config->name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (id != NULL) {
+        *id = slot;
+    }
+    ESP_LOGI(TAG, "Subscribed %s to level %u (queue %u, %s)", config->name, config->rollup_level, depth,
+             config->overflow == DATA_MANAGER_OVERFLOW_OVERWRITE_OLDEST ? "overwrite oldest" : "drop newest");
+    return ESP_OK;
+}
+
+size_t data_manager_get_subscriber_count(void) {
+    return subscriber_count;
+}
+
+esp_err_t data_manager_get_subscriber_stats(size_t id, data_manager_subscriber_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (id >= subscriber_count) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    portENTER_CRITICAL(&dispatch_lock);
+    *stats = subscribers[id].stats;
+    portEXIT_CRITICAL(&dispatch_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "esp_err.h"
+#include "data_manager.h"
+
+/**
+ * @brief Start the dispatcher task delivering queued samples to subscribers
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_dispatch_start(void);
+
+/**
+ * @brief Queue a sample for every subscriber and wake the dispatcher
+ *
+ * Never blocks and does no subscriber work. Subscribers with a deadband
+ * skip samples that do not pass it. source must stay valid for the
+ * lifetime of the data manager.
+ *
+ * @param handle Source handle
+ * @param source Sensor source name
+ * @param sample Sample to deliver
+ */
+void data_dispatch_enqueue(data_manager_handle_t handle, const char *source, const sensor_sample_t *sample);
+
+/**
+ * @brief Queue a closed rollup bucket for the subscribers of its level
+ *
+ * @param source Sensor source name, same lifetime rule as samples
+ * @param rollup Closed bucket
+ */
+void data_dispatch_enqueue_rollup(const char *source, const data_manager_rollup_t *rollup);
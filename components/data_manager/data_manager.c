@@ -1,15 +1,145 @@
+#include <stdatomic.h>
 #include <string.h>
 #include "data_manager.h"
+#include "sample_ring.h"
+#include "data_dispatch.h"
+#include "rollup.h"
+#include "ts_archive.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "error_handler.h"
 
 static const char *TAG = "data_manager";
 
+#define LATEST_READ_SPINS    8      // Retries before yielding to a preempted writer
+
+// Registered source; entries are never removed, so handles and names stay valid
+typedef struct {
+    char name[SENSOR_SOURCE_NAME_LEN];
+    const sensor_channel_desc_t *channels;
+    sensor_sample_t latest;
+    _Atomic uint32_t latest_seq;    // Odd while latest is being written, generation = seq / 2
+    sensor_cadence_stats_t cadence;
+    _Atomic uint32_t cadence_seq;   // Seqlock over cadence, same protocol as latest_seq
+    sensor_timing_stats_t timing;
+    _Atomic uint32_t timing_seq;    // Seqlock over timing
+    sample_ring_t history;          // Written only by the task publishing the source
+    rollup_level_t rollups[DATA_MANAGER_ROLLUP_LEVELS];  // Open buckets, guarded by rollup_mutex
+    data_manager_rollup_t last_rollups[DATA_MANAGER_ROLLUP_LEVELS];  // Last closed, guarded by rollup_mutex
+    ts_archive_t archive;           // Compressed long-term history, blocks NULL when disabled
+} source_entry_t;
+
+// Bucket length of each rollup level, 0 when disabled
+static const uint32_t rollup_resolution_ms[DATA_MANAGER_ROLLUP_LEVELS] = {
+    CONFIG_ENVILOG_ROLLUP_LEVEL1_S * 1000U,
+    CONFIG_ENVILOG_ROLLUP_LEVEL2_S * 1000U,
+    CONFIG_ENVILOG_ROLLUP_LEVEL3_S * 1000U,
+};
+
+// Channels of sources registered without their own description
+static const sensor_channel_desc_t default_channels[SENSOR_SAMPLE_CHANNELS] = {
+    { .name = "temperature", .unit = "°C", .scale = 100 },
+    { .name = "humidity", .unit = "%RH", .scale = 100 },
+};
+
 // Internal state
 static data_manager_config_t config = {0};
-static dht11_reading_t latest_dht11_reading = {0};
+static source_entry_t sources[DATA_MANAGER_MAX_SOURCES];
+static volatile size_t source_count = 0;
+static portMUX_TYPE sources_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t rollup_mutex = NULL;
+static uint32_t history_capacity = 0;
 static bool initialized = false;
 
+static data_manager_handle_t find_source(const char *source) {
+    for (size_t i = 0; i < source_count; i++) {
+        if (strcmp(sources[i].name, source) == 0) {
+            return (data_manager_handle_t)i;
+        }
+    }
+    return DATA_MANAGER_INVALID_HANDLE;
+}
+
+// Hot-path handle check, constant time regardless of the number of sources
+static source_entry_t *get_entry(data_manager_handle_t handle) {
+    if (handle < 0 || (size_t)handle >= source_count) {
+        return NULL;
+    }
+    return &sources[handle];
+}
+
+// Largest power of two that fits both the configured size and the heap budget
+static uint32_t size_history(void) {
+    uint32_t budget = esp_get_free_heap_size() / 100 * CONFIG_ENVILOG_HISTORY_HEAP_PERCENT;
+    uint32_t fit = budget / DATA_MANAGER_MAX_SOURCES / sizeof(sensor_sample_t);
+    uint32_t limit = (fit < CONFIG_ENVILOG_HISTORY_CAPACITY) ? fit : CONFIG_ENVILOG_HISTORY_CAPACITY;
+
+    uint32_t capacity = 2;
+    while (capacity <= limit / 2) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Seqlock write; only the task publishing the source calls this
+static void store_latest(source_entry_t *entry, const sensor_sample_t *sample) {
+    uint32_t seq = atomic_load_explicit(&entry->latest_seq, memory_order_relaxed);
+
+    atomic_store_explicit(&entry->latest_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry->latest = *sample;
+    atomic_store_explicit(&entry->latest_seq, seq + 2, memory_order_release);
+}
+
+// Seqlock read; retries instead of blocking the writer, returns the generation copied
+static uint32_t load_latest(source_entry_t *entry, sensor_sample_t *sample) {
+    for (uint32_t attempt = 1; ; attempt++) {
+        uint32_t before = atomic_load_explicit(&entry->latest_seq, memory_order_acquire);
+        if ((before & 1) == 0) {
+            *sample = entry->latest;
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&entry->latest_seq, memory_order_relaxed) == before) {
+                return before / 2;
+            }
+        }
+        // A lower-priority writer preempted mid-copy needs CPU time to finish
+        if (attempt % LATEST_READ_SPINS == 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+// Seqlock write of a statistics block; only the task publishing the source calls this
+static void store_stats(_Atomic uint32_t *seq, void *dst, const void *src, size_t len) {
+    uint32_t current = atomic_load_explicit(seq, memory_order_relaxed);
+
+    atomic_store_explicit(seq, current + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(dst, src, len);
+    atomic_store_explicit(seq, current + 2, memory_order_release);
+}
+
+// Seqlock read of a statistics block, retrying like load_latest
+static void load_stats(_Atomic uint32_t *seq, void *dst, const void *src, size_t len) {
+    for (uint32_t attempt = 1; ; attempt++) {
+        uint32_t before = atomic_load_explicit(seq, memory_order_acquire);
+        if ((before & 1) == 0) {
+            memcpy(dst, src, len);
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(seq, memory_order_relaxed) == before) {
+                return;
+            }
+        }
+        if (attempt % LATEST_READ_SPINS == 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
 esp_err_t data_manager_init(const data_manager_config_t *cfg) {
     if (cfg == NULL) {
         ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Configuration cannot be NULL");
@@ -18,36 +148,187 @@ esp_err_t data_manager_init(const data_manager_config_t *cfg) {
 
     // Store configuration
     config = *cfg;
+    history_capacity = size_history();
+
+    // A mutex, not a spinlock: the quantile markers are float work that
+    // should not run with interrupts off on every published sample
+    if (rollup_mutex == NULL) {
+        rollup_mutex = xSemaphoreCreateMutex();
+        if (rollup_mutex == NULL) {
+            ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "No memory for rollup mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t ret = data_dispatch_start();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (config.mqtt_callback != NULL) {
+        // Telemetry wants the freshest samples, so a backlog sheds its oldest
+        data_manager_subscriber_config_t mqtt_subscriber = {
+            .name = "mqtt",
+            .callback = config.mqtt_callback,
+            .queue_depth = 0,
+            .overflow = DATA_MANAGER_OVERFLOW_OVERWRITE_OLDEST,
+            .deadband = config.mqtt_deadband,
+            .skip_unsent = true,    // The forwarder sends those from the sample store
+        };
+        ret = data_manager_subscribe(&mqtt_subscriber, NULL);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
     initialized = true;
     
-    ESP_LOGI(TAG, "Data manager initialized successfully");
+    ESP_LOGI(TAG, "Data manager initialized, history %lu samples per source", history_capacity);
     return ESP_OK;
 }
 
-esp_err_t data_manager_publish_sensor_data(const char *source, const dht11_reading_t *reading) {
+esp_err_t data_manager_register_source(const char *name, const sensor_channel_desc_t *channels,
+                                       data_manager_handle_t *handle) {
     if (!initialized) {
         ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_STATE, ERROR_CAT_SYSTEM, "Data manager not initialized");
         return ESP_ERR_INVALID_STATE;
     }
-    
-    if (source == NULL || reading == NULL) {
+
+    if (name == NULL || handle == NULL || name[0] == '\0' || strlen(name) >= SENSOR_SOURCE_NAME_LEN) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Invalid source name");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *handle = find_source(name);
+    if (*handle != DATA_MANAGER_INVALID_HANDLE) {
+        return ESP_OK;
+    }
+
+    // Allocate outside the lock; a history-less source still serves latest data
+    sample_ring_t history = {0};
+    if (sample_ring_init(&history, history_capacity) != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM,
+            "No memory for %s history", name);
+    }
+    ts_archive_t archive = {0};
+    if (CONFIG_ENVILOG_ARCHIVE_BLOCKS > 0 && ts_archive_init(&archive, CONFIG_ENVILOG_ARCHIVE_BLOCKS) != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM,
+            "No memory for %s archive", name);
+    }
+
+    portENTER_CRITICAL(&sources_lock);
+    *handle = find_source(name);
+    if (*handle == DATA_MANAGER_INVALID_HANDLE && source_count < DATA_MANAGER_MAX_SOURCES) {
+        source_entry_t *entry = &sources[source_count];
+        strlcpy(entry->name, name, sizeof(entry->name));
+        entry->channels = channels ? channels : default_channels;
+        for (uint8_t level = 0; level < DATA_MANAGER_ROLLUP_LEVELS; level++) {
+            rollup_init(&entry->rollups[level], level + 1, rollup_resolution_ms[level]);
+        }
+        entry->history = history;
+        history.slots = NULL;
+        entry->archive = archive;
+        archive.blocks = NULL;
+        *handle = (data_manager_handle_t)source_count;
+        source_count++;     // Publish only once the entry is complete
+    }
+    portEXIT_CRITICAL(&sources_lock);
+
+    if (history.slots != NULL) {
+        sample_ring_deinit(&history);   // Lost the race or no room
+    }
+    if (archive.blocks != NULL) {
+        ts_archive_deinit(&archive);
+    }
+    if (*handle == DATA_MANAGER_INVALID_HANDLE) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NO_MEM, ERROR_CAT_VALIDATION,
+            "Source table full, cannot register %s", name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Registered source %s as handle %d", name, *handle);
+    return ESP_OK;
+}
+
+esp_err_t data_manager_find_source(const char *name, data_manager_handle_t *handle) {
+    if (name == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *handle = find_source(name);
+    return (*handle == DATA_MANAGER_INVALID_HANDLE) ? ESP_ERR_NOT_FOUND : ESP_OK;
+}
+
+size_t data_manager_get_source_count(void) {
+    return source_count;
+}
+
+esp_err_t data_manager_get_source_info(data_manager_handle_t handle, data_manager_source_info_t *info) {
+    if (info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    info->handle = handle;
+    info->name = entry->name;
+    info->channels = entry->channels;
+    info->channel_count = SENSOR_SAMPLE_CHANNELS;
+    info->generation = atomic_load_explicit(&entry->latest_seq, memory_order_acquire) / 2;
+    return ESP_OK;
+}
+
+esp_err_t data_manager_publish(data_manager_handle_t handle, const sensor_sample_t *sample) {
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL || sample == NULL) {
         ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Invalid parameters");
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Handle DHT11 data
-    if (strcmp(source, "dht11") == 0) {
-        // Store latest reading
-        latest_dht11_reading = *reading;
-        
-        ESP_LOGI(TAG, "Received DHT11 data: %.1f°C, %.1f%%RH", 
-                 reading->temperature, reading->humidity);
-        
-        // Notify MQTT callback if configured
-        if (config.mqtt_callback != NULL) {
-            esp_err_t ret = config.mqtt_callback(reading);
-            if (ret != ESP_OK) {
-                ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_COMMUNICATION, "MQTT callback failed");
+    // Mark samples the live uplink cannot take; the store keeps them for forwarding
+    sensor_sample_t unsent;
+    if (config.uplink_connected != NULL && !config.uplink_connected()) {
+        unsent = *sample;
+        unsent.flags |= SENSOR_SAMPLE_UNSENT;
+        sample = &unsent;
+    }
+
+    // Store latest sample and append it to the history
+    store_latest(entry, sample);
+    if (entry->history.slots != NULL) {
+        sample_ring_push(&entry->history, sample);
+    }
+    if (entry->archive.blocks != NULL) {
+        ts_archive_append(&entry->archive, sample);
+    }
+    
+    ESP_LOGD(TAG, "Received %s data: " SENSOR_CENTI_FMT "°C, " SENSOR_CENTI_FMT "%%RH", entry->name,
+             SENSOR_CENTI_ARGS(sample->temperature), SENSOR_CENTI_ARGS(sample->humidity));
+    
+    // Subscribers run on the dispatcher task, not here
+    data_dispatch_enqueue(handle, entry->name, sample);
+
+    // Each level costs one comparison, an accumulate and the quantile markers;
+    // closed buckets go out like samples once the mutex is released
+    if (sensor_sample_is_valid(sample)) {
+        uint64_t time_ms = sensor_sample_time_ms(sample, esp_timer_get_time() / 1000);
+        data_manager_rollup_t closed[DATA_MANAGER_ROLLUP_LEVELS];
+        bool emitted[DATA_MANAGER_ROLLUP_LEVELS];
+
+        xSemaphoreTake(rollup_mutex, portMAX_DELAY);
+        for (uint8_t level = 0; level < DATA_MANAGER_ROLLUP_LEVELS; level++) {
+            emitted[level] = rollup_add(&entry->rollups[level], time_ms, sample, &closed[level]);
+            if (emitted[level]) {
+                entry->last_rollups[level] = closed[level];
+            }
+        }
+        xSemaphoreGive(rollup_mutex);
+
+        for (uint8_t level = 0; level < DATA_MANAGER_ROLLUP_LEVELS; level++) {
+            if (emitted[level]) {
+                data_dispatch_enqueue_rollup(entry->name, &closed[level]);
             }
         }
     }
@@ -55,23 +336,173 @@ esp_err_t data_manager_publish_sensor_data(const char *source, const dht11_readi
     return ESP_OK;
 }
 
-esp_err_t data_manager_get_latest_data(const char *source, dht11_reading_t *reading) {
-    if (!initialized) {
-        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_STATE, ERROR_CAT_SYSTEM, "Data manager not initialized");
-        return ESP_ERR_INVALID_STATE;
+esp_err_t data_manager_publish_sensor_data(const char *source, const sensor_sample_t *sample) {
+    data_manager_handle_t handle;
+    esp_err_t ret = data_manager_register_source(source, NULL, &handle);
+    if (ret != ESP_OK) {
+        return ret;
     }
-    
-    if (source == NULL || reading == NULL) {
-        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Invalid parameters");
+    return data_manager_publish(handle, sample);
+}
+
+esp_err_t data_manager_get_latest_data(const char *source, sensor_sample_t *sample) {
+    data_manager_handle_t handle;
+    if (source == NULL || data_manager_find_source(source, &handle) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return data_manager_get_latest(handle, sample, NULL);
+}
+
+esp_err_t data_manager_get_latest(data_manager_handle_t handle, sensor_sample_t *sample, uint32_t *generation) {
+    if (sample == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Handle DHT11 data request
-    if (strcmp(source, "dht11") == 0) {
-        *reading = latest_dht11_reading;
-        return ESP_OK;
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t seen = load_latest(entry, sample);
+    if (generation != NULL) {
+        *generation = seen;
+    }
+    return ESP_OK;
+}
+
+esp_err_t data_manager_get_generation(data_manager_handle_t handle, uint32_t *generation) {
+    if (generation == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // A write in progress still reports the previous generation
+    *generation = atomic_load_explicit(&entry->latest_seq, memory_order_acquire) / 2;
+    return ESP_OK;
+}
+
+esp_err_t data_manager_get_history(data_manager_handle_t handle, uint64_t from_ms, uint64_t to_ms,
+                                   sensor_sample_t *samples, size_t max_points, size_t *count) {
+    if (samples == NULL || count == NULL || max_points == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *count = 0;
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (entry->history.slots == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint64_t now_ms = esp_timer_get_time() / 1000;
+    *count = sample_ring_read_range(&entry->history, from_ms, to_ms, now_ms, samples, max_points);
+    return ESP_OK;
+}
+
+uint32_t data_manager_get_history_capacity(void) {
+    return history_capacity;
+}
+
+esp_err_t data_manager_read_archive(data_manager_handle_t handle, uint32_t *cursor,
+                                    uint8_t *block, size_t *len) {
+    if (cursor == NULL || block == NULL || len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (entry->archive.blocks == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
 
-    ERROR_LOG_WARNING(TAG, ESP_ERR_NOT_FOUND, ERROR_CAT_VALIDATION, "Unknown sensor source: %s", source);
-    return ESP_ERR_NOT_FOUND;
+    return ts_archive_read(&entry->archive, cursor, block, len);
+}
+
+esp_err_t data_manager_get_rollup(data_manager_handle_t handle, uint8_t level,
+                                  data_manager_rollup_t *open, data_manager_rollup_t *closed) {
+    if (level == 0 || level > DATA_MANAGER_ROLLUP_LEVELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Copy under the mutex, summarize outside it
+    rollup_level_t state;
+    xSemaphoreTake(rollup_mutex, portMAX_DELAY);
+    state = entry->rollups[level - 1];
+    if (closed != NULL) {
+        *closed = entry->last_rollups[level - 1];
+    }
+    xSemaphoreGive(rollup_mutex);
+
+    if (open != NULL) {
+        rollup_snapshot(&state, open);
+    }
+    return ESP_OK;
+}
+
+uint32_t data_manager_get_rollup_resolution(uint8_t level) {
+    if (level == 0 || level > DATA_MANAGER_ROLLUP_LEVELS) {
+        return 0;
+    }
+    return rollup_resolution_ms[level - 1];
+}
+
+esp_err_t data_manager_update_cadence_stats(data_manager_handle_t handle, const sensor_cadence_stats_t *stats) {
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    store_stats(&entry->cadence_seq, &entry->cadence, stats, sizeof(*stats));
+    return ESP_OK;
+}
+
+esp_err_t data_manager_get_cadence_stats(data_manager_handle_t handle, sensor_cadence_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    load_stats(&entry->cadence_seq, stats, &entry->cadence, sizeof(*stats));
+    return ESP_OK;
+}
+
+esp_err_t data_manager_update_timing_stats(data_manager_handle_t handle, const sensor_timing_stats_t *stats) {
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    store_stats(&entry->timing_seq, &entry->timing, stats, sizeof(*stats));
+    return ESP_OK;
+}
+
+esp_err_t data_manager_get_timing_stats(data_manager_handle_t handle, sensor_timing_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    source_entry_t *entry = get_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    load_stats(&entry->timing_seq, stats, &entry->timing, sizeof(*stats));
+    return ESP_OK;
 }
@@ -1,20 +1,116 @@
 #pragma once
 
 #include "esp_err.h"
-#include "dht11_sensor.h"
+#include "sensor_driver.h"
+#include "ts_block.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+#define DATA_MANAGER_MAX_SOURCES    SENSOR_MAX_SOURCES
+#define DATA_MANAGER_MAX_SUBSCRIBERS        6
+#define DATA_MANAGER_SUBSCRIBER_NAME_LEN    16
+#define DATA_MANAGER_INVALID_HANDLE         (-1)
+#define DATA_MANAGER_ROLLUP_LEVELS          3
+#define DATA_MANAGER_QUANTILES              3
+#define DATA_MANAGER_QUANTILE_PERCENTS      { 5, 50, 95 }
+
+// Compact source id handed out at registration, 0 .. source count - 1
+typedef int data_manager_handle_t;
+
+// Summary of one channel over a rollup bucket, centi-units
+typedef struct {
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+    int16_t quantiles[DATA_MANAGER_QUANTILES];  // Streaming estimates at DATA_MANAGER_QUANTILE_PERCENTS
+} data_manager_channel_summary_t;
+
+/**
+ * @brief Rollup bucket of one source
+ */
+typedef struct {
+    uint64_t start_ms;                       // Bucket start, ms since boot, multiple of resolution_ms
+    uint32_t resolution_ms;                  // Bucket length
+    uint32_t count;                          // Valid samples aggregated
+    uint8_t level;                           // 1 .. DATA_MANAGER_ROLLUP_LEVELS
+    data_manager_channel_summary_t temperature;
+    data_manager_channel_summary_t humidity;
+} data_manager_rollup_t;
+
 // Data consumer callback types
-typedef esp_err_t (*sensor_data_callback_t)(const dht11_reading_t *reading);
-typedef esp_err_t (*sensor_data_getter_t)(dht11_reading_t *reading);
+typedef esp_err_t (*sensor_data_callback_t)(const char *source, const sensor_sample_t *sample);
+typedef esp_err_t (*sensor_rollup_callback_t)(const char *source, const data_manager_rollup_t *rollup);
+typedef esp_err_t (*sensor_data_getter_t)(sensor_sample_t *sample);
+
+// What a subscriber queue does with a new sample when it is full
+typedef enum {
+    DATA_MANAGER_OVERFLOW_DROP_NEWEST = 0,   // Keep the queued samples, drop the new one
+    DATA_MANAGER_OVERFLOW_OVERWRITE_OLDEST   // Drop the oldest queued sample
+} data_manager_overflow_t;
+
+/**
+ * @brief Report-by-exception policy of a raw-sample subscriber
+ *
+ * When enabled, a sample is delivered only if a channel moved further
+ * from the last delivered sample of its source than absolute or percent
+ * of that value (either threshold, when set), its validity changed, or
+ * heartbeat_ms passed since the last delivery. With both thresholds 0,
+ * only repeated identical values are suppressed.
+ */
+typedef struct {
+    bool enabled;
+    uint16_t absolute;                       // Centi-units, 0 to ignore
+    uint8_t percent;                         // Of the last delivered value, 0 to ignore
+    uint32_t heartbeat_ms;                   // Longest silence per source, 0 for none
+} data_manager_deadband_t;
+
+/**
+ * @brief Subscriber registration
+ */
+typedef struct {
+    const char *name;                        // Short name used in statistics
+    uint8_t rollup_level;                    // 0 for raw samples, else the rollup level to receive
+    sensor_data_callback_t callback;         // Raw samples, called from the dispatcher task
+    sensor_rollup_callback_t rollup_callback;  // Closed buckets when rollup_level is set
+    uint16_t queue_depth;                    // Items buffered, 0 for the Kconfig default
+    data_manager_overflow_t overflow;        // Policy when the queue is full
+    data_manager_deadband_t deadband;        // Raw samples only
+    bool skip_unsent;                        // Raw samples only; never queue SENSOR_SAMPLE_UNSENT ones
+} data_manager_subscriber_config_t;
+
+/**
+ * @brief Delivery counters of one subscriber
+ */
+typedef struct {
+    char name[DATA_MANAGER_SUBSCRIBER_NAME_LEN];
+    uint32_t delivered;                      // Callback returned ESP_OK
+    uint32_t failed;                         // Callback returned an error
+    uint32_t dropped;                        // Lost to a full queue
+    uint32_t suppressed;                     // Withheld by the deadband, never queued
+    uint16_t depth;                          // Queue capacity
+    uint16_t queued;                         // Samples waiting now
+    uint16_t high_water;                     // Most samples ever waiting
+} data_manager_subscriber_stats_t;
+
+/**
+ * @brief Description of a registered source
+ */
+typedef struct {
+    data_manager_handle_t handle;
+    const char *name;                        // Valid for the lifetime of the data manager
+    const sensor_channel_desc_t *channels;   // channel_count entries, in sample order
+    uint8_t channel_count;
+    uint32_t generation;                     // Samples published so far
+} data_manager_source_info_t;
 
 /**
  * @brief Data manager configuration
  */
 typedef struct {
-    sensor_data_callback_t mqtt_callback;    // Called when new sensor data arrives
+    sensor_data_callback_t mqtt_callback;    // Subscribed as "mqtt" when not NULL
+    data_manager_deadband_t mqtt_deadband;   // Report-by-exception policy of "mqtt"
     sensor_data_getter_t http_getter;        // Called by HTTP to get latest data
+    bool (*uplink_connected)(void);          // Optional; samples published while false get SENSOR_SAMPLE_UNSENT
 } data_manager_config_t;
 
 /**
@@ -25,20 +121,223 @@ typedef struct {
  */
 esp_err_t data_manager_init(const data_manager_config_t *config);
 
+/**
+ * @brief Register a consumer of new sensor data
+ *
+ * Each subscriber gets its own bounded queue. Samples are delivered in
+ * order by a single dispatcher task, so a slow callback delays the
+ * others but never the publishing sensor task. A subscriber receives
+ * either raw samples or the closed buckets of one rollup level.
+ * 
+ * @param config Subscriber registration
+ * @param id Optional pointer to store the subscriber id
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the registry is full
+ */
+esp_err_t data_manager_subscribe(const data_manager_subscriber_config_t *config, size_t *id);
+
+/**
+ * @brief Get the number of registered subscribers; ids run from 0 to count - 1
+ */
+size_t data_manager_get_subscriber_count(void);
+
+/**
+ * @brief Get delivery counters of a subscriber
+ * 
+ * @param id Subscriber id
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for unknown ids
+ */
+esp_err_t data_manager_get_subscriber_stats(size_t id, data_manager_subscriber_stats_t *stats);
+
+/**
+ * @brief Register a source, or get the handle of an already registered one
+ *
+ * Producers and consumers register once and use the handle afterwards,
+ * so per-sample calls do not search the source table.
+ * 
+ * @param name Source name (e.g., "dht11"), shorter than SENSOR_SOURCE_NAME_LEN
+ * @param channels SENSOR_SAMPLE_CHANNELS static descriptors, NULL for temperature/humidity
+ * @param handle Pointer to store the source handle
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t data_manager_register_source(const char *name, const sensor_channel_desc_t *channels,
+                                       data_manager_handle_t *handle);
+
+/**
+ * @brief Look up the handle of a registered source
+ * 
+ * @param name Source name (e.g., "dht11")
+ * @param handle Pointer to store the source handle
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if not registered
+ */
+esp_err_t data_manager_find_source(const char *name, data_manager_handle_t *handle);
+
+/**
+ * @brief Get the number of registered sources; handles run from 0 to count - 1
+ */
+size_t data_manager_get_source_count(void);
+
+/**
+ * @brief Get the name, channels and generation of a source
+ * 
+ * @param handle Source handle
+ * @param info Pointer to store the description
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for unknown handles
+ */
+esp_err_t data_manager_get_source_info(data_manager_handle_t handle, data_manager_source_info_t *info);
+
 /**
  * @brief Process new sensor data (called by sensors)
+ *
+ * Stores the sample and queues it for every subscriber; no subscriber
+ * work runs on the caller's task.
+ * 
+ * @param handle Source handle from data_manager_register_source()
+ * @param sample Fixed-point sensor sample
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_manager_publish(data_manager_handle_t handle, const sensor_sample_t *sample);
+
+/**
+ * @brief Register the source by name if needed and publish a sample
+ *
+ * Convenience for producers without a handle; searches the source table
+ * on every call.
  * 
  * @param source Sensor source name (e.g., "dht11")
- * @param reading Sensor reading data
+ * @param sample Fixed-point sensor sample
  * @return esp_err_t ESP_OK on success
  */
-esp_err_t data_manager_publish_sensor_data(const char *source, const dht11_reading_t *reading);
+esp_err_t data_manager_publish_sensor_data(const char *source, const sensor_sample_t *sample);
 
 /**
- * @brief Get latest sensor data (called by HTTP server)
+ * @brief Get latest sensor data by source name
  * 
  * @param source Sensor source name (e.g., "dht11")
- * @param reading Pointer to store latest reading
+ * @param sample Pointer to store latest sample
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if not registered
+ */
+esp_err_t data_manager_get_latest_data(const char *source, sensor_sample_t *sample);
+
+/**
+ * @brief Get latest sensor data together with its generation
+ *
+ * The copy is never torn and never blocks the publishing task. The
+ * generation starts at 0 and increases by one per published sample.
+ * 
+ * @param handle Source handle
+ * @param sample Pointer to store latest sample
+ * @param generation Pointer to store the generation of the sample, may be NULL
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_manager_get_latest(data_manager_handle_t handle, sensor_sample_t *sample, uint32_t *generation);
+
+/**
+ * @brief Get the generation of the latest sample without copying it
+ *
+ * Cheap check of whether a source published since a previous read.
+ * 
+ * @param handle Source handle
+ * @param generation Pointer to store the current generation
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_manager_get_generation(data_manager_handle_t handle, uint32_t *generation);
+
+/**
+ * @brief Read the recorded samples of a source within a time range
+ *
+ * Safe from any task while the source keeps publishing; readers never
+ * block the publisher. When more than max_points samples match they are
+ * evenly decimated, always keeping the newest.
+ * 
+ * @param handle Source handle
+ * @param from_ms Oldest sample time to include, ms since boot (0 for all)
+ * @param to_ms Newest sample time to include, ms since boot (UINT64_MAX for all)
+ * @param samples Buffer receiving samples, oldest first
+ * @param max_points Capacity of samples
+ * @param count Number of samples written
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for unknown handles
+ */
+esp_err_t data_manager_get_history(data_manager_handle_t handle, uint64_t from_ms, uint64_t to_ms,
+                                   sensor_sample_t *samples, size_t max_points, size_t *count);
+
+/**
+ * @brief Get the number of samples kept per source
+ */
+uint32_t data_manager_get_history_capacity(void);
+
+/**
+ * @brief Copy one compressed archive block of a source
+ *
+ * Blocks use the ts_block.h format and are self-contained, so they can be
+ * sent to clients unchanged. Start with a cursor of 0 and call until
+ * ESP_ERR_NOT_FOUND to walk the archive oldest first; the last block is
+ * the one still being filled. Blocks evicted between calls are skipped.
+ *
+ * @param handle Source handle
+ * @param cursor Archive position, advanced past the block copied
+ * @param block Buffer of TS_BLOCK_SIZE bytes
+ * @param len Filled with the block length
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for unknown handles or
+ *         past the newest block, ESP_ERR_NOT_SUPPORTED when the source has no archive
+ */
+esp_err_t data_manager_read_archive(data_manager_handle_t handle, uint32_t *cursor,
+                                    uint8_t *block, size_t *len);
+
+/**
+ * @brief Read the open and the last closed bucket of a rollup level
+ *
+ * Quantiles of the open bucket are the estimates so far.
+ *
+ * @param handle Source handle
+ * @param level Rollup level, 1 .. DATA_MANAGER_ROLLUP_LEVELS
+ * @param open Filled with the open bucket, count 0 when empty (NULL to skip)
+ * @param closed Filled with the last closed bucket, count 0 before the first (NULL to skip)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for unknown handles
+ */
+esp_err_t data_manager_get_rollup(data_manager_handle_t handle, uint8_t level,
+                                  data_manager_rollup_t *open, data_manager_rollup_t *closed);
+
+/**
+ * @brief Get the bucket length of a rollup level
+ * 
+ * @param level Rollup level, 1 .. DATA_MANAGER_ROLLUP_LEVELS
+ * @return uint32_t Bucket length in ms, 0 if the level is disabled or invalid
+ */
+uint32_t data_manager_get_rollup_resolution(uint8_t level);
+
+/**
+ * @brief Update sampling cadence statistics (called by sensors)
+ * 
+ * @param handle Source handle
+ * @param stats Latest cadence statistics of the source
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_manager_update_cadence_stats(data_manager_handle_t handle, const sensor_cadence_stats_t *stats);
+
+/**
+ * @brief Get sampling cadence statistics of a source
+ * 
+ * @param handle Source handle
+ * @param stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_manager_get_cadence_stats(data_manager_handle_t handle, sensor_cadence_stats_t *stats);
+
+/**
+ * @brief Update acquisition timing histograms (called by sensors)
+ * 
+ * @param handle Source handle
+ * @param stats Latest timing statistics of the source
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t data_manager_update_timing_stats(data_manager_handle_t handle, const sensor_timing_stats_t *stats);
+
+/**
+ * @brief Get acquisition timing histograms of a source
+ * 
+ * @param handle Source handle
+ * @param stats Pointer to store the statistics
  * @return esp_err_t ESP_OK on success
  */
-esp_err_t data_manager_get_latest_data(const char *source, dht11_reading_t *reading);
+esp_err_t data_manager_get_timing_stats(data_manager_handle_t handle, sensor_timing_stats_t *stats);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sensor_driver.h"
+
+/**
+ * @brief Fixed-capacity sample history, one writer and any number of readers
+ *
+ * The writer never blocks or retries. Readers copy without locking and
+ * then drop whatever the writer overwrote while they were copying, so a
+ * read returns a consistent, in-order subset of the history.
+ */
+typedef struct {
+    sensor_sample_t *slots;
+    uint32_t mask;                 // capacity - 1, capacity is a power of two
+    _Atomic uint32_t head;         // Samples appended so far, wraps at 2^32
+    _Atomic bool filled;           // Set once every slot has been written
+} sample_ring_t;
+
+/**
+ * @brief Allocate the slots of a ring
+ *
+ * @param ring Ring to initialize
+ * @param capacity Requested capacity, rounded down to a power of two (minimum 2)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if allocation fails
+ */
+esp_err_t sample_ring_init(sample_ring_t *ring, uint32_t capacity);
+
+/**
+ * @brief Free the slots of a ring; no reader or writer may use it afterwards
+ */
+void sample_ring_deinit(sample_ring_t *ring);
+
+/**
+ * @brief Append a sample, overwriting the oldest when full (wait-free, writer only)
+ */
+void sample_ring_push(sample_ring_t *ring, const sensor_sample_t *sample);
+
+/**
+ * @brief Number of samples currently held
+ */
+uint32_t sample_ring_count(const sample_ring_t *ring);
+
+/**
+ * @brief Copy the samples whose time falls in [from_ms, to_ms]
+ *
+ * Samples must be appended in time order. If more than max_points
+ * samples match they are evenly decimated across the range.
+ *
+ * @param ring Ring to read
+ * @param from_ms Oldest time to include, ms since boot
+ * @param to_ms Newest time to include, ms since boot
+ * @param now_ms Current time, used to widen the 32-bit sample timestamps
+ * @param out Output buffer, oldest first
+ * @param max_points Capacity of out
+ * @return size_t Number of samples written to out
+ */
+size_t sample_ring_read_range(sample_ring_t *ring, uint64_t from_ms, uint64_t to_ms, uint64_t now_ms,
+                              sensor_sample_t *out, size_t max_points);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sensor_driver.h"
+
+/*
+ * Compressed time-series block, self-contained and sent to clients as is.
+ *
+ * Header, little endian:
+ *   0      version (TS_BLOCK_VERSION)
+ *   1      flags of the first sample
+ *   2..3   sample count
+ *   4..7   timestamp_ms of the first sample
+ *   8..9   temperature of the first sample, centi-units
+ *   10..11 humidity of the first sample, centi-units
+ *   12..13 payload length in bits
+ *   14..15 reserved, 0
+ *
+ * The payload follows, MSB first. Every later sample is encoded as:
+ *   timestamp  delta-of-delta d in ms, z = zigzag(d)
+ *              '0' d == 0 | '10' z:7 | '110' z:12 | '1110' z:20 | '1111' z:32
+ *   temperature, humidity  change v from the previous sample, z = zigzag(v)
+ *              '0' v == 0 | '10' z:6 | '110' z:10 | '111' z:17
+ *   flags      '0' unchanged | '1' flags:8
+ *
+ * A block occupies TS_BLOCK_HEADER_SIZE + ceil(bits / 8) bytes, at most
+ * the buffer size it was started with (TS_BLOCK_SIZE by default). Only raw
+ * values are kept; decoded samples carry filtered = raw and no filter.
+ */
+#define TS_BLOCK_VERSION        1
+#define TS_BLOCK_SIZE           256
+#define TS_BLOCK_HEADER_SIZE    16
+
+/**
+ * @brief Appends samples to one block
+ */
+typedef struct {
+    uint8_t *block;
+    uint16_t size;                 // Buffer size, bytes
+    uint16_t bits;                 // Payload bits written
+    uint16_t count;
+    uint32_t prev_timestamp;
+    int32_t prev_delta;
+    int16_t prev_temperature;
+    int16_t prev_humidity;
+    uint8_t prev_flags;
+} ts_block_encoder_t;
+
+/**
+ * @brief Reads samples back from one block
+ */
+typedef struct {
+    const uint8_t *block;
+    uint16_t bits;                 // Payload bits available
+    uint16_t bit_pos;
+    uint16_t count;
+    uint16_t index;                // Samples returned so far
+    uint32_t prev_timestamp;
+    int32_t prev_delta;
+    int16_t prev_temperature;
+    int16_t prev_humidity;
+    uint8_t prev_flags;
+} ts_block_decoder_t;
+
+/**
+ * @brief Start an empty block
+ *
+ * @param encoder Encoder state
+ * @param block Buffer receiving the block
+ * @param size Buffer size, TS_BLOCK_HEADER_SIZE + 16 up to TS_BLOCK_SIZE
+ */
+void ts_block_begin(ts_block_encoder_t *encoder, uint8_t *block, uint16_t size);
+
+/**
+ * @brief Append a sample; the header is kept current so the block is readable at any time
+ *
+ * @return true if appended, false if the block is full
+ */
+bool ts_block_append(ts_block_encoder_t *encoder, const sensor_sample_t *sample);
+
+/**
+ * @brief Bytes used by a block, header included
+ */
+size_t ts_block_size(const uint8_t *block);
+
+/**
+ * @brief Prepare to decode a block
+ *
+ * @param decoder Decoder state
+ * @param block Block bytes
+ * @param len Bytes available
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_SIZE / ESP_ERR_INVALID_VERSION for bad blocks
+ */
+esp_err_t ts_block_decoder_init(ts_block_decoder_t *decoder, const uint8_t *block, size_t len);
+
+/**
+ * @brief Decode the next sample
+ *
+ * @return true if a sample was decoded, false at the end of the block
+ */
+bool ts_block_decode_next(ts_block_decoder_t *decoder, sensor_sample_t *sample);
@@ -0,0 +1,71 @@
+#include "p2_quantile.h"
+
+// Piecewise-parabolic prediction of marker i moved by d (+1 or -1)
+static float parabolic(const p2_quantile_t *e, int i, int d) {
+    const float *q = e->height;
+    const int32_t *n = e->position;
+    return q[i] + (float)d / (n[i + 1] - n[i - 1]) *
+           ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+}
+
+static float linear(const p2_quantile_t *e, int i, int d) {
+    return e->height[i] + d * (e->height[i + d] - e->height[i]) / (e->position[i + d] - e->position[i]);
+}
+
+void p2_quantile_add(p2_quantile_t *e, uint32_t count, float p, float value) {
+    if (count < 5) {
+        // Insertion sort of the first five values, which become the markers
+        int i = count;
+        while (i > 0 && e->height[i - 1] > value) {
+            e->height[i] = e->height[i - 1];
+            i--;
+        }
+        e->height[i] = value;
+        e->position[count] = count + 1;
+        return;
+    }
+
+    int k;
+    if (value < e->height[0]) {
+        e->height[0] = value;
+        k = 0;
+    } else if (value >= e->height[4]) {
+        e->height[4] = value;
+        k = 3;
+    } else {
+        k = 0;
+        while (value >= e->height[k + 1]) {
+            k++;
+        }
+    }
+    for (int i = k + 1; i < 5; i++) {
+        e->position[i]++;
+    }
+
+    // Desired positions follow from the count, so they are not stored
+    const float fraction[5] = { 0.0f, p / 2, p, (1 + p) / 2, 1.0f };
+    for (int i = 1; i < 4; i++) {
+        float desired = 1 + count * fraction[i];
+        float delta = desired - e->position[i];
+        if ((delta >= 1 && e->position[i + 1] - e->position[i] > 1) ||
+            (delta <= -1 && e->position[i - 1] - e->position[i] < -1)) {
+            int d = delta > 0 ? 1 : -1;
+            float height = parabolic(e, i, d);
+            if (height <= e->height[i - 1] || height >= e->height[i + 1]) {
+                height = linear(e, i, d);
+            }
+            e->height[i] = height;
+            e->position[i] += d;
+        }
+    }
+}
+
+float p2_quantile_get(const p2_quantile_t *e, uint32_t count, float p) {
+    if (count >= 5) {
+        return e->height[2];
+    }
+    // Nearest rank over the sorted values seen so far
+    uint32_t rank = (uint32_t)((count - 1) * p + 0.5f);
+    return e->height[rank];
+}
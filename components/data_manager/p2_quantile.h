@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * P-square streaming quantile estimate (Jain & Chlamtac, 1985): five
+ * markers track the minimum, p/2, p, (1+p)/2 and the maximum, adjusted by
+ * piecewise-parabolic interpolation. Constant memory and time per sample;
+ * the caller keeps the sample count, shared by all estimators of a bucket.
+ */
+typedef struct {
+    float height[5];
+    int32_t position[5];
+} p2_quantile_t;
+
+/**
+ * @brief Add a value
+ *
+ * @param estimator Estimator state, zeroed before the first value
+ * @param count Values added before this one
+ * @param p Quantile tracked, 0 < p < 1
+ * @param value Value to add
+ */
+void p2_quantile_add(p2_quantile_t *estimator, uint32_t count, float p, float value);
+
+/**
+ * @brief Current estimate, exact while fewer than five values were added
+ *
+ * @param estimator Estimator state
+ * @param count Values added, at least 1
+ * @param p Quantile tracked
+ */
+float p2_quantile_get(const p2_quantile_t *estimator, uint32_t count, float p);
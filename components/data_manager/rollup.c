@@ -0,0 +1,79 @@
+#include <string.h>
+#include "rollup.h"
+
+static const uint8_t quantile_percents[DATA_MANAGER_QUANTILES] = DATA_MANAGER_QUANTILE_PERCENTS;
+
+static void channel_add(data_manager_channel_summary_t *summary, int64_t *sum, p2_quantile_t *quantiles,
+                        uint32_t count, int16_t value) {
+    if (count == 0 || value < summary->min) {
+        summary->min = value;
+    }
+    if (count == 0 || value > summary->max) {
+        summary->max = value;
+    }
+    *sum += value;
+    for (int i = 0; i < DATA_MANAGER_QUANTILES; i++) {
+        p2_quantile_add(&quantiles[i], count, quantile_percents[i] / 100.0f, value);
+    }
+}
+
+// Mean rounded half away from zero
+static int16_t channel_mean(int64_t sum, uint32_t count) {
+    int64_t half = count / 2;
+    return (int16_t)((sum + (sum < 0 ? -half : half)) / (int64_t)count);
+}
+
+static void channel_finish(data_manager_channel_summary_t *summary, int64_t sum,
+                           const p2_quantile_t *quantiles, uint32_t count) {
+    summary->mean = channel_mean(sum, count);
+    for (int i = 0; i < DATA_MANAGER_QUANTILES; i++) {
+        float estimate = p2_quantile_get(&quantiles[i], count, quantile_percents[i] / 100.0f);
+        summary->quantiles[i] = (int16_t)(estimate < 0 ? estimate - 0.5f : estimate + 0.5f);
+    }
+}
+
+void rollup_init(rollup_level_t *level, uint8_t index, uint32_t resolution_ms) {
+    memset(level, 0, sizeof(*level));
+    level->bucket.level = index;
+    level->bucket.resolution_ms = resolution_ms;
+}
+
+bool rollup_add(rollup_level_t *level, uint64_t time_ms, const sensor_sample_t *sample,
+                data_manager_rollup_t *closed) {
+    data_manager_rollup_t *bucket = &level->bucket;
+    if (bucket->resolution_ms == 0) {
+        return false;
+    }
+
+    bool emitted = false;
+    uint64_t start_ms = time_ms - (time_ms % bucket->resolution_ms);
+    if (bucket->count > 0 && start_ms != bucket->start_ms) {
+        rollup_snapshot(level, closed);
+        emitted = true;
+        bucket->count = 0;
+    }
+
+    if (bucket->count == 0) {
+        bucket->start_ms = start_ms;
+        level->temperature_sum = 0;
+        level->humidity_sum = 0;
+        memset(level->temperature_quantiles, 0, sizeof(level->temperature_quantiles));
+        memset(level->humidity_quantiles, 0, sizeof(level->humidity_quantiles));
+    }
+    channel_add(&bucket->temperature, &level->temperature_sum, level->temperature_quantiles,
+                bucket->count, sample->temperature);
+    channel_add(&bucket->humidity, &level->humidity_sum, level->humidity_quantiles,
+                bucket->count, sample->humidity);
+    bucket->count++;
+    return emitted;
+}
+
+bool rollup_snapshot(const rollup_level_t *level, data_manager_rollup_t *bucket) {
+    *bucket = level->bucket;
+    if (bucket->count == 0) {
+        return false;
+    }
+    channel_finish(&bucket->temperature, level->temperature_sum, level->temperature_quantiles, bucket->count);
+    channel_finish(&bucket->humidity, level->humidity_sum, level->humidity_quantiles, bucket->count);
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "data_manager.h"
+#include "p2_quantile.h"
+
+// Open bucket of one rollup level
+typedef struct {
+    data_manager_rollup_t bucket;
+    int64_t temperature_sum;
+    int64_t humidity_sum;
+    p2_quantile_t temperature_quantiles[DATA_MANAGER_QUANTILES];
+    p2_quantile_t humidity_quantiles[DATA_MANAGER_QUANTILES];
+} rollup_level_t;
+
+/**
+ * @brief Prepare a level with no open bucket
+ *
+ * @param level Level state
+ * @param index Level number reported in emitted buckets
+ * @param resolution_ms Bucket length, 0 disables the level
+ */
+void rollup_init(rollup_level_t *level, uint8_t index, uint32_t resolution_ms);
+
+/**
+ * @brief Add a valid sample in constant time
+ *
+ * Samples must arrive in time order. A sample past the open bucket
+ * closes it; buckets without samples are never emitted.
+ *
+ * @param level Level state
+ * @param time_ms Sample time, ms since boot
+ * @param sample Valid sample
+ * @param closed Filled with the bucket this sample closed
+ * @return true if a bucket was closed
+ */
+bool rollup_add(rollup_level_t *level, uint64_t time_ms, const sensor_sample_t *sample,
+                data_manager_rollup_t *closed);
+
+/**
+ * @brief Summarize the open bucket so far
+ *
+ * @param level Level state
+ * @param bucket Filled with the open bucket
+ * @return true if the open bucket has samples
+ */
+bool rollup_snapshot(const rollup_level_t *level, data_manager_rollup_t *bucket);
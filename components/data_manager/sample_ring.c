@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sample_ring.h"
+
+esp_err_t sample_ring_init(sample_ring_t *ring, uint32_t capacity) {
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Power of two so slot indices stay continuous when head wraps
+    uint32_t size = 2;
+    while (size <= capacity / 2) {
+        size *= 2;
+    }
+
+    ring->slots = calloc(size, sizeof(sensor_sample_t));
+    if (ring->slots == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->filled, false);
+    return ESP_OK;
+}
+
+void sample_ring_deinit(sample_ring_t *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+    ring->mask = 0;
+}
+
+void sample_ring_push(sample_ring_t *ring, const sensor_sample_t *sample) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    ring->slots[head & ring->mask] = *sample;
+    if (head == ring->mask) {
+        atomic_store_explicit(&ring->filled, true, memory_order_relaxed);
+    }
+    // Publish the slot before readers can see the new head
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+uint32_t sample_ring_count(const sample_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    bool filled = atomic_load_explicit(&ring->filled, memory_order_relaxed);
+    return filled ? ring->mask + 1 : head;
+}
+
+static uint64_t slot_time(const sample_ring_t *ring, uint32_t seq, uint64_t now_ms) {
+    return sensor_sample_time_ms(&ring->slots[seq & ring->mask], now_ms);
+}
+
+// First offset in [lo, hi) whose sample time is above limit (or at/above when inclusive)
+static uint32_t search_time(const sample_ring_t *ring, uint32_t oldest, uint32_t lo, uint32_t hi,
+                            uint64_t limit, bool inclusive, uint64_t now_ms) {
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint64_t t = slot_time(ring, oldest + mid, now_ms);
+        if (inclusive ? (t < limit) : (t <= limit)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+size_t sample_ring_read_range(sample_ring_t *ring, uint64_t from_ms, uint64_t to_ms, uint64_t now_ms,
+                              sensor_sample_t *out, size_t max_points) {
+    if (ring->slots == NULL || out == NULL || max_points == 0 || from_ms > to_ms) {
+        return 0;
+    }
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    bool filled = atomic_load_explicit(&ring->filled, memory_order_relaxed);
+    uint32_t available = filled ? ring->mask + 1 : head;
+    uint32_t oldest = head - available;
+
+    // Samples are in time order, so the range is found by binary search
+    uint32_t first = search_time(ring, oldest, 0, available, from_ms, true, now_ms);
+    uint32_t end = search_time(ring, oldest, first, available, to_ms, false, now_ms);
+    uint32_t matched = end - first;
+    if (matched == 0) {
+        return 0;
+    }
+
+    // Decimate evenly, always keeping the newest sample in range
+    uint32_t stride = (matched + max_points - 1) / max_points;
+    uint32_t points = (matched + stride - 1) / stride;
+    uint32_t start = oldest + end - 1 - (points - 1) * stride;
+    for (uint32_t i = 0; i < points; i++) {
+        out[i] = ring->slots[(start + i * stride) & ring->mask];
+    }
+
+    // Anything the writer reached while we copied may be torn; drop it from the old end
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t head_after = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t skip = 0;
+    while (skip < points && head_after - (start + skip * stride) > ring->mask) {
+        skip++;
+    }
+    if (skip > 0) {
+        memmove(out, out + skip, (points - skip) * sizeof(sensor_sample_t));
+    }
+    return points - skip;
+}
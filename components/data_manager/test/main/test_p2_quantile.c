@@ -0,0 +1,160 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "unity.h"
+#include "p2_quantile.h"
+
+/*
+ * P-square estimates against exact quantiles over one day of 2 s samples
+ * (43200 values, the longest rollup window in use). Error is measured in
+ * rank: the distance, as a fraction of the count, between p and the range
+ * of ranks the estimate occupies in the sorted data, so 0 means the
+ * estimate is a valid p-quantile. Traces are in centi-units, as rollups
+ * see them, and estimates are rounded to that step before ranking.
+ */
+
+#define TRACE_SAMPLES       43200
+
+typedef enum {
+    TRACE_DIURNAL,          // DHT11 resolution: 0.1 C / 1 %RH steps over a daily swing
+    TRACE_SINE,             // sensor_sim default: sine plus noise
+    TRACE_BIMODAL,          // Heater cycling between two levels
+    TRACE_RANDOM_WALK,      // Slow drift, P-square's weak case
+} trace_t;
+
+static const struct {
+    const char *name;
+    float max_rank_error;
+} traces[] = {
+    [TRACE_DIURNAL] = { "diurnal DHT11", 0.02f },
+    [TRACE_SINE] = { "sine plus noise", 0.01f },
+    [TRACE_BIMODAL] = { "bimodal heater", 0.01f },
+    [TRACE_RANDOM_WALK] = { "random walk", 0.05f },
+};
+
+static const float quantiles[] = { 0.05f, 0.5f, 0.95f };
+
+static double noise(double amplitude) {
+    return ((rand() % 1000) / 1000.0 - 0.5) * amplitude;
+}
+
+static void make_trace(trace_t trace, float *values, size_t count) {
+    srand(7 + trace);
+    double walk = 0;
+    for (size_t i = 0; i < count; i++) {
+        double phase = 2 * M_PI * i / count;
+        double value;
+        switch (trace) {
+            case TRACE_DIURNAL:
+                value = round((22 + 4 * sin(phase) + noise(0.6)) * 10) / 10;
+                break;
+            case TRACE_SINE:
+                value = 24 + 3 * sin(2 * M_PI * i / 1800) + noise(0.4);
+                break;
+            case TRACE_BIMODAL:
+                value = ((i / 600) % 2) ? 26 + noise(0.5) : 19 + noise(0.5);
+                break;
+            case TRACE_RANDOM_WALK:
+            default:
+                walk += noise(0.1);
+                value = 23 + walk;
+                break;
+        }
+        values[i] = (float)lround(value * 100);
+    }
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Distance from p to the ranks the estimate takes in sorted values, as a fraction of the count
+static float rank_error(const float *sorted, size_t count, float p, float estimate) {
+    size_t below = 0;
+    size_t at_or_below = 0;
+    for (size_t i = 0; i < count; i++) {
+        float value = sorted[i];
+        below += (value < roundf(estimate));
+        at_or_below += (value <= roundf(estimate));
+    }
+    float target = p * count;
+    if (target < below) {
+        return (below - target) / count;
+    }
+    if (target > at_or_below) {
+        return (target - at_or_below) / count;
+    }
+    return 0.0f;
+}
+
+TEST_CASE("fewer than five values give the exact nearest rank", "[p2_quantile]") {
+    const float values[] = { 30.0f, 10.0f, 40.0f, 20.0f };
+    p2_quantile_t estimator = {0};
+    for (uint32_t count = 0; count < 4; count++) {
+        p2_quantile_add(&estimator, count, 0.5f, values[count]);
+    }
+    // Sorted 10 20 30 40: rank (4 - 1) * p rounded
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, p2_quantile_get(&estimator, 4, 0.5f));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, p2_quantile_get(&estimator, 4, 0.05f));
+    TEST_ASSERT_EQUAL_FLOAT(40.0f, p2_quantile_get(&estimator, 4, 0.95f));
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, p2_quantile_get(&estimator, 1, 0.5f));
+}
+
+TEST_CASE("a constant input is estimated exactly", "[p2_quantile]") {
+    p2_quantile_t estimator = {0};
+    for (uint32_t count = 0; count < 1000; count++) {
+        p2_quantile_add(&estimator, count, 0.95f, 2150.0f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(2150.0f, p2_quantile_get(&estimator, 1000, 0.95f));
+}
+
+TEST_CASE("estimates track exact quantiles over a day of samples", "[p2_quantile]") {
+    float *values = malloc(TRACE_SAMPLES * sizeof(float));
+    TEST_ASSERT_NOT_NULL(values);
+
+    for (trace_t trace = 0; trace < sizeof(traces) / sizeof(traces[0]); trace++) {
+        make_trace(trace, values, TRACE_SAMPLES);
+
+        p2_quantile_t estimators[3] = {0};
+        for (uint32_t count = 0; count < TRACE_SAMPLES; count++) {
+            for (size_t q = 0; q < 3; q++) {
+                p2_quantile_add(&estimators[q], count, quantiles[q], values[count]);
+            }
+        }
+
+        qsort(values, TRACE_SAMPLES, sizeof(float), compare_floats);
+        for (size_t q = 0; q < 3; q++) {
+            float estimate = p2_quantile_get(&estimators[q], TRACE_SAMPLES, quantiles[q]);
+            float exact = values[(size_t)((TRACE_SAMPLES - 1) * quantiles[q] + 0.5f)];
+            float error = rank_error(values, TRACE_SAMPLES, quantiles[q], estimate);
+            printf("  %-16s p%-2d estimate %7.2f exact %7.2f rank error %.4f\n", traces[trace].name,
+                   (int)(quantiles[q] * 100 + 0.5f), estimate / 100, exact / 100, error);
+            TEST_ASSERT_TRUE_MESSAGE(error <= traces[trace].max_rank_error, traces[trace].name);
+        }
+    }
+    free(values);
+}
+
+TEST_CASE("update time per value", "[p2_quantile][bench]") {
+    float *values = malloc(TRACE_SAMPLES * sizeof(float));
+    TEST_ASSERT_NOT_NULL(values);
+    make_trace(TRACE_DIURNAL, values, TRACE_SAMPLES);
+
+    p2_quantile_t estimators[3] = {0};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t count = 0; count < TRACE_SAMPLES; count++) {
+        for (size_t q = 0; q < 3; q++) {
+            p2_quantile_add(&estimators[q], count, quantiles[q], values[count]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("p2_quantile_add: %.1f ns per value and quantile (p50 %.2f)\n",
+           ns / (TRACE_SAMPLES * 3.0), p2_quantile_get(&estimators[1], TRACE_SAMPLES, 0.5f) / 100);
+    free(values);
+}
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "ts_block.h"
+
+#define RATIO_SAMPLES       40000
+#define RATIO_INTERVAL_MS   2000
+
+static sensor_sample_t make_sample(uint32_t timestamp_ms, int16_t temperature, int16_t humidity, uint8_t flags) {
+    return (sensor_sample_t) {
+        .temperature = temperature,
+        .humidity = humidity,
+        .temperature_filtered = temperature,
+        .humidity_filtered = humidity,
+        .timestamp_ms = timestamp_ms,
+        .flags = flags,
+    };
+}
+
+static void assert_same_sample(const sensor_sample_t *expected, const sensor_sample_t *actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected->timestamp_ms, actual->timestamp_ms);
+    TEST_ASSERT_EQUAL_INT16(expected->temperature, actual->temperature);
+    TEST_ASSERT_EQUAL_INT16(expected->humidity, actual->humidity);
+    TEST_ASSERT_EQUAL_UINT8(expected->flags, actual->flags);
+    // Only raw values are kept
+    TEST_ASSERT_EQUAL_INT16(actual->temperature, actual->temperature_filtered);
+    TEST_ASSERT_EQUAL_INT16(actual->humidity, actual->humidity_filtered);
+    TEST_ASSERT_EQUAL_UINT8(0, actual->filter);
+}
+
+// Decode a whole block and compare it with the samples appended
+static void assert_block_holds(const uint8_t *block, const sensor_sample_t *samples, size_t count) {
+    ts_block_decoder_t decoder;
+    TEST_ASSERT_EQUAL(ESP_OK, ts_block_decoder_init(&decoder, block, ts_block_size(block)));
+
+    sensor_sample_t sample;
+    size_t decoded = 0;
+    while (ts_block_decode_next(&decoder, &sample)) {
+        TEST_ASSERT_LESS_THAN(count, decoded);
+        assert_same_sample(&samples[decoded], &sample);
+        decoded++;
+    }
+    TEST_ASSERT_EQUAL(count, decoded);
+}
+
+TEST_CASE("every code width round-trips", "[ts_block]") {
+    // Timestamp delta-of-deltas from 0 up to the 32-bit code, across the uint32 wrap;
+    // value changes from 0 up to the 17-bit code, both signs
+    const sensor_sample_t samples[] = {
+        make_sample(0xFFFFF000u, 2350, 4500, SENSOR_SAMPLE_VALID),
+        make_sample(0xFFFFF7D0u, 2350, 4500, SENSOR_SAMPLE_VALID),      // dod 2000 - 0
+        make_sample(0xFFFFFFA0u, 2351, 4490, SENSOR_SAMPLE_VALID),      // dod 0
+        make_sample(0x00000770u, 2330, 4600, SENSOR_SAMPLE_VALID),      // dod 0, wraps
+        make_sample(0x00000F4Au, 2380, 4100, 0),                        // dod +10, flags change
+        make_sample(0x00001718u, -1200, 9000, 0),                       // dod -12
+        make_sample(0x00001F00u, INT16_MAX, INT16_MIN, SENSOR_SAMPLE_VALID),
+        make_sample(0x00002800u, INT16_MIN, INT16_MAX, SENSOR_SAMPLE_VALID),
+        make_sample(0x00372800u, 0, 0, SENSOR_SAMPLE_VALID | SENSOR_SAMPLE_UNSENT),  // One hour gap
+        make_sample(0x00373000u, 0, 0, SENSOR_SAMPLE_VALID | SENSOR_SAMPLE_UNSENT),
+        make_sample(0x00373000u, 5, -5, SENSOR_SAMPLE_VALID),           // Same timestamp
+    };
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+
+    uint8_t block[TS_BLOCK_SIZE];
+    ts_block_encoder_t encoder;
+    ts_block_begin(&encoder, block, sizeof(block));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(ts_block_append(&encoder, &samples[i]));
+        // The header is kept current, so the block reads back after every append
+        assert_block_holds(block, samples, i + 1);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(block), ts_block_size(block));
+}
+
+TEST_CASE("unchanged samples cost one bit per field", "[ts_block]") {
+    uint8_t block[TS_BLOCK_SIZE];
+    ts_block_encoder_t encoder;
+    ts_block_begin(&encoder, block, sizeof(block));
+
+    sensor_sample_t sample = make_sample(1000, 2200, 5000, SENSOR_SAMPLE_VALID);
+    TEST_ASSERT_TRUE(ts_block_append(&encoder, &sample));
+    for (int i = 0; i < 100; i++) {
+        sample.timestamp_ms += RATIO_INTERVAL_MS;
+        TEST_ASSERT_TRUE(ts_block_append(&encoder, &sample));
+    }
+    // The first delta-of-delta is the interval itself, 12-bit code
+    TEST_ASSERT_EQUAL_UINT16((3 + 12) + 3 + 99 * 4, encoder.bits);
+}
+
+TEST_CASE("a full block refuses samples and stays readable", "[ts_block]") {
+    const uint16_t sizes[] = { TS_BLOCK_HEADER_SIZE + 16, 64, TS_BLOCK_SIZE };
+    static sensor_sample_t samples[4096];
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint8_t block[TS_BLOCK_SIZE + 8];
+        memset(block, 0xA5, sizeof(block));
+        ts_block_encoder_t encoder;
+        ts_block_begin(&encoder, block, sizes[s]);
+
+        // Noisy values so samples take the wider codes
+        srand(7);
+        size_t count = 0;
+        uint32_t timestamp = 500;
+        while (count < 4096) {
+            timestamp += RATIO_INTERVAL_MS + (rand() % 401) - 200;
+            samples[count] = make_sample(timestamp, (int16_t)(rand() % 5000), (int16_t)(rand() % 10000),
+                                         SENSOR_SAMPLE_VALID);
+            if (!ts_block_append(&encoder, &samples[count])) {
+                break;
+            }
+            count++;
+        }
+        TEST_ASSERT_GREATER_THAN(1, count);
+        TEST_ASSERT_LESS_THAN(4096, count);
+
+        // Still full for the next sample, and the bytes past the buffer were never touched
+        TEST_ASSERT_FALSE(ts_block_append(&encoder, &samples[count]));
+        TEST_ASSERT_LESS_OR_EQUAL(sizes[s], ts_block_size(block));
+        TEST_ASSERT_EQUAL_HEX8(0xA5, block[sizes[s]]);
+        assert_block_holds(block, samples, count);
+    }
+}
+
+TEST_CASE("bad blocks are rejected", "[ts_block]") {
+    uint8_t block[TS_BLOCK_SIZE];
+    ts_block_encoder_t encoder;
+    ts_block_decoder_t decoder;
+    ts_block_begin(&encoder, block, sizeof(block));
+    for (uint32_t i = 0; i < 20; i++) {
+        sensor_sample_t sample = make_sample(i * RATIO_INTERVAL_MS, (int16_t)(2000 + i * 37), 4000, SENSOR_SAMPLE_VALID);
+        ts_block_append(&encoder, &sample);
+    }
+    size_t size = ts_block_size(block);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ts_block_decoder_init(&decoder, block, TS_BLOCK_HEADER_SIZE - 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ts_block_decoder_init(&decoder, block, size - 1));
+    block[0] = TS_BLOCK_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, ts_block_decoder_init(&decoder, block, size));
+    block[0] = TS_BLOCK_VERSION;
+
+    // A count beyond the payload ends decoding at the last whole sample
+    block[2] = 200;
+    TEST_ASSERT_EQUAL(ESP_OK, ts_block_decoder_init(&decoder, block, size));
+    sensor_sample_t sample;
+    int decoded = 0;
+    while (ts_block_decode_next(&decoder, &sample)) {
+        decoded++;
+    }
+    TEST_ASSERT_EQUAL(20, decoded);
+}
+
+// DHT11-like trace: 0.1 C and 1 %RH steps, occasional invalid reads, timestamp jitter in ms
+static void make_trace(sensor_sample_t *samples, size_t count, int jitter_ms) {
+    srand(1);
+    uint32_t timestamp = 4294900000u;   // Wraps during the trace
+    int16_t temperature = 2350;
+    int16_t humidity = 4500;
+    for (size_t i = 0; i < count; i++) {
+        timestamp += RATIO_INTERVAL_MS + (jitter_ms ? (rand() % (2 * jitter_ms + 1)) - jitter_ms : 0);
+        if (rand() % 20 == 0) {
+            temperature += (rand() % 2) ? 10 : -10;
+        }
+        if (rand() % 20 == 0) {
+            humidity += (rand() % 2) ? 100 : -100;
+        }
+        samples[i] = make_sample(timestamp, temperature, humidity, (rand() % 500 == 0) ? 0 : SENSOR_SAMPLE_VALID);
+    }
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+TEST_CASE("compression ratio of DHT11-like traces", "[ts_block][bench]") {
+    const int jitters[] = { 0, 2, 20 };
+    sensor_sample_t *samples = malloc(RATIO_SAMPLES * sizeof(sensor_sample_t));
+    uint8_t *blocks = malloc((RATIO_SAMPLES / 8) * TS_BLOCK_SIZE);
+    TEST_ASSERT_NOT_NULL(samples);
+    TEST_ASSERT_NOT_NULL(blocks);
+
+    printf("%d samples at %d ms, %u-byte blocks\n", RATIO_SAMPLES, RATIO_INTERVAL_MS, TS_BLOCK_SIZE);
+    for (size_t j = 0; j < sizeof(jitters) / sizeof(jitters[0]); j++) {
+        make_trace(samples, RATIO_SAMPLES, jitters[j]);
+
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        ts_block_encoder_t encoder;
+        size_t block_count = 1;
+        ts_block_begin(&encoder, blocks, TS_BLOCK_SIZE);
+        for (size_t i = 0; i < RATIO_SAMPLES; i++) {
+            if (!ts_block_append(&encoder, &samples[i])) {
+                ts_block_begin(&encoder, blocks + block_count * TS_BLOCK_SIZE, TS_BLOCK_SIZE);
+                block_count++;
+                TEST_ASSERT_TRUE(ts_block_append(&encoder, &samples[i]));
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        size_t bytes = 0;
+        size_t decoded = 0;
+        for (size_t b = 0; b < block_count; b++) {
+            const uint8_t *block = blocks + b * TS_BLOCK_SIZE;
+            ts_block_decoder_t decoder;
+            TEST_ASSERT_EQUAL(ESP_OK, ts_block_decoder_init(&decoder, block, TS_BLOCK_SIZE));
+            bytes += ts_block_size(block);
+            sensor_sample_t sample;
+            while (ts_block_decode_next(&decoder, &sample)) {
+                TEST_ASSERT_EQUAL_UINT32(samples[decoded].timestamp_ms, sample.timestamp_ms);
+                TEST_ASSERT_EQUAL_INT16(samples[decoded].temperature, sample.temperature);
+                TEST_ASSERT_EQUAL_INT16(samples[decoded].humidity, sample.humidity);
+                TEST_ASSERT_EQUAL_UINT8(samples[decoded].flags, sample.flags);
+                decoded++;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        TEST_ASSERT_EQUAL(RATIO_SAMPLES, decoded);
+
+        printf("  jitter +/-%2d ms: %zu blocks, %.2f bytes/sample (%.1fx vs %zu-byte samples), "
+               "encode %.0f ns/sample, decode+check %.0f ns/sample\n",
+               jitters[j], block_count, (double)bytes / RATIO_SAMPLES,
+               (double)sizeof(sensor_sample_t) * RATIO_SAMPLES / bytes, sizeof(sensor_sample_t),
+               elapsed_ns(&t0, &t1) / RATIO_SAMPLES, elapsed_ns(&t1, &t2) / RATIO_SAMPLES);
+    }
+
+    free(blocks);
+    free(samples);
+}
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ts_archive.h"
+
+static uint8_t *block_at(ts_archive_t *archive, uint32_t seq) {
+    return archive->blocks + (size_t)(seq % archive->capacity) * TS_BLOCK_SIZE;
+}
+
+esp_err_t ts_archive_init(ts_archive_t *archive, uint16_t capacity) {
+    if (archive == NULL || capacity < 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(archive, 0, sizeof(*archive));
+    archive->blocks = malloc((size_t)capacity * TS_BLOCK_SIZE);
+    if (archive->blocks == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    archive->capacity = capacity;
+    portMUX_INITIALIZE(&archive->lock);
+    ts_block_begin(&archive->encoder, block_at(archive, 0), TS_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+void ts_archive_deinit(ts_archive_t *archive) {
+    free(archive->blocks);
+    archive->blocks = NULL;
+}
+
+void ts_archive_append(ts_archive_t *archive, const sensor_sample_t *sample) {
+    portENTER_CRITICAL(&archive->lock);
+    if (!ts_block_append(&archive->encoder, sample)) {
+        archive->open_seq++;
+        if (archive->open_seq - archive->first_seq >= archive->capacity) {
+            archive->first_seq++;
+        }
+        ts_block_begin(&archive->encoder, block_at(archive, archive->open_seq), TS_BLOCK_SIZE);
+        ts_block_append(&archive->encoder, sample);
+    }
+    portEXIT_CRITICAL(&archive->lock);
+}
+
+esp_err_t ts_archive_read(ts_archive_t *archive, uint32_t *cursor, uint8_t *block, size_t *len) {
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&archive->lock);
+    uint32_t seq = *cursor;
+    if (seq < archive->first_seq) {
+        seq = archive->first_seq;
+    }
+    if (seq < archive->open_seq || (seq == archive->open_seq && archive->encoder.count > 0)) {
+        const uint8_t *src = block_at(archive, seq);
+        *len = ts_block_size(src);
+        memcpy(block, src, *len);
+        *cursor = seq + 1;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&archive->lock);
+    return ret;
+}
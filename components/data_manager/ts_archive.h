@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "ts_block.h"
+
+// Chain of compressed blocks of one source, the oldest evicted when full
+typedef struct {
+    uint8_t *blocks;                // capacity * TS_BLOCK_SIZE bytes
+    uint16_t capacity;
+    uint32_t first_seq;             // Oldest block still held
+    uint32_t open_seq;              // Block being appended to, slot open_seq % capacity
+    ts_block_encoder_t encoder;
+    portMUX_TYPE lock;              // Held for one append or one block copy
+} ts_archive_t;
+
+/**
+ * @brief Allocate an archive
+ *
+ * @param archive Archive to initialize
+ * @param capacity Blocks to keep, at least 2
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t ts_archive_init(ts_archive_t *archive, uint16_t capacity);
+
+/**
+ * @brief Free an archive's blocks
+ */
+void ts_archive_deinit(ts_archive_t *archive);
+
+/**
+ * @brief Append a sample, sealing the open block and evicting the oldest as needed
+ */
+void ts_archive_append(ts_archive_t *archive, const sensor_sample_t *sample);
+
+/**
+ * @brief Copy the block at a cursor and advance it
+ *
+ * A cursor of 0, or one pointing at an evicted block, starts at the oldest
+ * block held. The open block is copied as filled so far.
+ *
+ * @param archive Archive to read
+ * @param cursor Sequence number to read, advanced past the block copied
+ * @param block TS_BLOCK_SIZE bytes
+ * @param len Filled with the bytes copied
+ * @return esp_err_t ESP_OK, or ESP_ERR_NOT_FOUND once past the newest sample
+ */
+esp_err_t ts_archive_read(ts_archive_t *archive, uint32_t *cursor, uint8_t *block, size_t *len);
@@ -0,0 +1,207 @@
+#include <string.h>
+#include "ts_block.h"
+
+#define TS_SAMPLE_MAX_BITS      (4 + 32 + 2 * (3 + 17) + 1 + 8)
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = value & 0xff;
+    p[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void write_bits(ts_block_encoder_t *encoder, uint32_t value, uint8_t width) {
+    uint8_t *payload = encoder->block + TS_BLOCK_HEADER_SIZE;
+    while (width > 0) {
+        width--;
+        if ((value >> width) & 1) {
+            payload[encoder->bits / 8] |= 0x80 >> (encoder->bits % 8);
+        }
+        encoder->bits++;
+    }
+}
+
+static uint32_t read_bits(ts_block_decoder_t *decoder, uint8_t width) {
+    const uint8_t *payload = decoder->block + TS_BLOCK_HEADER_SIZE;
+    uint32_t value = 0;
+    while (width > 0) {
+        width--;
+        value = (value << 1) | ((payload[decoder->bit_pos / 8] >> (7 - decoder->bit_pos % 8)) & 1);
+        decoder->bit_pos++;
+    }
+    return value;
+}
+
+// Count leading 1 bits of a prefix code, at most max
+static uint8_t read_prefix(ts_block_decoder_t *decoder, uint8_t max) {
+    uint8_t ones = 0;
+    while (ones < max && read_bits(decoder, 1)) {
+        ones++;
+    }
+    return ones;
+}
+
+static void write_timestamp(ts_block_encoder_t *encoder, int32_t dod) {
+    uint32_t z = zigzag(dod);
+    if (dod == 0) {
+        write_bits(encoder, 0x0, 1);
+    } else if (z < (1u << 7)) {
+        write_bits(encoder, 0x2, 2);
+        write_bits(encoder, z, 7);
+    } else if (z < (1u << 12)) {
+        write_bits(encoder, 0x6, 3);
+        write_bits(encoder, z, 12);
+    } else if (z < (1u << 20)) {
+        write_bits(encoder, 0xe, 4);
+        write_bits(encoder, z, 20);
+    } else {
+        write_bits(encoder, 0xf, 4);
+        write_bits(encoder, z, 32);
+    }
+}
+
+static int32_t read_timestamp(ts_block_decoder_t *decoder) {
+    static const uint8_t widths[] = { 0, 7, 12, 20, 32 };
+    uint8_t prefix = read_prefix(decoder, 4);
+    return prefix ? unzigzag(read_bits(decoder, widths[prefix])) : 0;
+}
+
+static void write_value(ts_block_encoder_t *encoder, int32_t change) {
+    uint32_t z = zigzag(change);
+    if (change == 0) {
+        write_bits(encoder, 0x0, 1);
+    } else if (z < (1u << 6)) {
+        write_bits(encoder, 0x2, 2);
+        write_bits(encoder, z, 6);
+    } else if (z < (1u << 10)) {
+        write_bits(encoder, 0x6, 3);
+        write_bits(encoder, z, 10);
+    } else {
+        write_bits(encoder, 0x7, 3);
+        write_bits(encoder, z, 17);
+    }
+}
+
+static int32_t read_value(ts_block_decoder_t *decoder) {
+    static const uint8_t widths[] = { 0, 6, 10, 17 };
+    uint8_t prefix = read_prefix(decoder, 3);
+    return prefix ? unzigzag(read_bits(decoder, widths[prefix])) : 0;
+}
+
+void ts_block_begin(ts_block_encoder_t *encoder, uint8_t *block, uint16_t size) {
+    memset(encoder, 0, sizeof(*encoder));
+    memset(block, 0, size);
+    encoder->block = block;
+    encoder->size = size;
+    block[0] = TS_BLOCK_VERSION;
+}
+
+bool ts_block_append(ts_block_encoder_t *encoder, const sensor_sample_t *sample) {
+    uint8_t *block = encoder->block;
+
+    if (encoder->count == 0) {
+        block[1] = sample->flags;
+        memcpy(&block[4], &sample->timestamp_ms, sizeof(uint32_t));
+        put_u16(&block[8], (uint16_t)sample->temperature);
+        put_u16(&block[10], (uint16_t)sample->humidity);
+        encoder->prev_delta = 0;
+    } else {
+        uint32_t payload_bits = (encoder->size - TS_BLOCK_HEADER_SIZE) * 8;
+        if (encoder->bits + TS_SAMPLE_MAX_BITS > payload_bits || encoder->count == UINT16_MAX) {
+            return false;
+        }
+
+        int32_t delta = (int32_t)(sample->timestamp_ms - encoder->prev_timestamp);
+        write_timestamp(encoder, delta - encoder->prev_delta);
+        write_value(encoder, (int32_t)sample->temperature - encoder->prev_temperature);
+        write_value(encoder, (int32_t)sample->humidity - encoder->prev_humidity);
+        if (sample->flags == encoder->prev_flags) {
+            write_bits(encoder, 0, 1);
+        } else {
+            write_bits(encoder, 1, 1);
+            write_bits(encoder, sample->flags, 8);
+        }
+        encoder->prev_delta = delta;
+    }
+
+    encoder->prev_timestamp = sample->timestamp_ms;
+    encoder->prev_temperature = sample->temperature;
+    encoder->prev_humidity = sample->humidity;
+    encoder->prev_flags = sample->flags;
+    encoder->count++;
+    put_u16(&block[2], encoder->count);
+    put_u16(&block[12], encoder->bits);
+    return true;
+}
+
+size_t ts_block_size(const uint8_t *block) {
+    return TS_BLOCK_HEADER_SIZE + (get_u16(&block[12]) + 7) / 8;
+}
+
+esp_err_t ts_block_decoder_init(ts_block_decoder_t *decoder, const uint8_t *block, size_t len) {
+    if (decoder == NULL || block == NULL || len < TS_BLOCK_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (block[0] != TS_BLOCK_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (ts_block_size(block) > len || ts_block_size(block) > TS_BLOCK_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->block = block;
+    decoder->bits = get_u16(&block[12]);
+    decoder->count = get_u16(&block[2]);
+    return ESP_OK;
+}
+
+bool ts_block_decode_next(ts_block_decoder_t *decoder, sensor_sample_t *sample) {
+    if (decoder->index >= decoder->count) {
+        return false;
+    }
+
+    const uint8_t *block = decoder->block;
+    if (decoder->index == 0) {
+        memcpy(&decoder->prev_timestamp, &block[4], sizeof(uint32_t));
+        decoder->prev_temperature = (int16_t)get_u16(&block[8]);
+        decoder->prev_humidity = (int16_t)get_u16(&block[10]);
+        decoder->prev_flags = block[1];
+    } else {
+        // A truncated or corrupt payload ends the block rather than reading past it
+        if (decoder->bit_pos >= decoder->bits) {
+            return false;
+        }
+        int32_t delta = decoder->prev_delta + read_timestamp(decoder);
+        decoder->prev_timestamp += (uint32_t)delta;
+        decoder->prev_delta = delta;
+        decoder->prev_temperature = (int16_t)(decoder->prev_temperature + read_value(decoder));
+        decoder->prev_humidity = (int16_t)(decoder->prev_humidity + read_value(decoder));
+        if (read_bits(decoder, 1)) {
+            decoder->prev_flags = (uint8_t)read_bits(decoder, 8);
+        }
+        if (decoder->bit_pos > decoder->bits) {
+            return false;
+        }
+    }
+
+    memset(sample, 0, sizeof(*sample));
+    sample->timestamp_ms = decoder->prev_timestamp;
+    sample->temperature = decoder->prev_temperature;
+    sample->humidity = decoder->prev_humidity;
+    sample->temperature_filtered = sample->temperature;
+    sample->humidity_filtered = sample->humidity;
+    sample->flags = decoder->prev_flags;
+    decoder->index++;
+    return true;
+}
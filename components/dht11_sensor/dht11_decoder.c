@@ -0,0 +1,152 @@
+#include <string.h>
+#include "dht11_decoder.h"
+
+static const dht11_decoder_config_t default_config = DHT11_DECODER_DEFAULT_CONFIG();
+
+// Iterator over the pulse list that folds glitches into the surrounding level
+typedef struct {
+    const dht11_pulse_t *pulses;
+    size_t count;
+    size_t pos;
+    uint16_t glitch_max_us;
+} pulse_reader_t;
+
+static bool next_pulse(pulse_reader_t *reader, dht11_pulse_t *out) {
+    if (reader->pos >= reader->count) {
+        return false;
+    }
+
+    *out = reader->pulses[reader->pos++];
+    while (reader->pos < reader->count) {
+        const dht11_pulse_t *next = &reader->pulses[reader->pos];
+        if (next->level == out->level) {
+            out->duration_us += next->duration_us;
+            reader->pos++;
+        } else if (next->duration_us <= reader->glitch_max_us && reader->pos + 1 < reader->count) {
+            // Absorb the glitch and the pulse after it, which continues our level
+            out->duration_us += next->duration_us + reader->pulses[reader->pos + 1].duration_us;
+            reader->pos += 2;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+dht11_decode_result_t dht11_decode_frame(const dht11_pulse_t *pulses, size_t count,
+                                         const dht11_decoder_config_t *config, uint8_t data[5],
+                                         dht11_frame_timing_t *timing) {
+    dht11_frame_timing_t scratch;
+    if (config == NULL) {
+        config = &default_config;
+    }
+    if (timing == NULL) {
+        timing = &scratch;
+    }
+    memset(data, 0, 5);
+    memset(timing, 0, sizeof(*timing));
+    timing->min_bit_margin_us = UINT8_MAX;
+
+    pulse_reader_t reader = {
+        .pulses = pulses,
+        .count = pulses ? count : 0,
+        .pos = 0,
+        .glitch_max_us = config->glitch_max_us
+    };
+    dht11_pulse_t low, high;
+
+    // Skip the host release until the sensor response (low 80us, high 80us)
+    do {
+        if (!next_pulse(&reader, &low)) {
+            return DHT11_DECODE_NO_RESPONSE;
+        }
+    } while (low.level != 0 || low.duration_us < config->response_min_us);
+    timing->response_low_us = low.duration_us;
+
+    if (!next_pulse(&reader, &high)) {
+        return DHT11_DECODE_TRUNCATED;
+    }
+    timing->response_high_us = high.duration_us;
+    if (high.duration_us < config->response_min_us) {
+        return DHT11_DECODE_NO_RESPONSE;
+    }
+
+    // Each bit is a ~50us low followed by a 26-28us (0) or 70us (1) high
+    for (int bit = 0; bit < DHT11_FRAME_BITS; bit++) {
+        if (!next_pulse(&reader, &low) || !next_pulse(&reader, &high)) {
+            return DHT11_DECODE_TRUNCATED;
+        }
+        if (low.duration_us > config->bit_low_max_us || high.duration_us > config->bit_high_max_us) {
+            return DHT11_DECODE_BAD_PULSE;
+        }
+
+        int distance = (int)high.duration_us - config->bit_threshold_us;
+        uint8_t margin = (uint8_t)(distance < 0 ? -distance : distance);
+        timing->bit_margin_us[timing->bits++] = margin;
+        if (margin < timing->min_bit_margin_us) {
+            timing->min_bit_margin_us = margin;
+        }
+        if (distance >= -(int)config->bit_margin_us && distance <= (int)config->bit_margin_us) {
+            return DHT11_DECODE_AMBIGUOUS_BIT;
+        }
+        if (distance > 0) {
+            data[bit / 8] |= (1 << (7 - (bit % 8)));
+        }
+    }
+
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+        return DHT11_DECODE_CHECKSUM;
+    }
+
+    return DHT11_DECODE_OK;
+}
+
+dht11_decode_result_t dht11_decode_reading(const dht11_pulse_t *pulses, size_t count,
+                                           const dht11_decoder_config_t *config,
+                                           dht11_reading_t *reading,
+                                           dht11_frame_timing_t *timing) {
+    uint8_t data[5];
+    dht11_decode_result_t result = dht11_decode_frame(pulses, count, config, data, timing);
+
+    reading->valid = (result == DHT11_DECODE_OK);
+    if (result != DHT11_DECODE_OK) {
+        return result;
+    }
+
+    reading->humidity = (float)data[0] + (float)data[1]/10.0f;
+    reading->temperature = (float)data[2] + (float)data[3]/10.0f;
+    return DHT11_DECODE_OK;
+}
+
+dht11_decode_result_t dht11_decode_sample(const dht11_pulse_t *pulses, size_t count,
+                                          const dht11_decoder_config_t *config,
+                                          sensor_sample_t *sample,
+                                          dht11_frame_timing_t *timing) {
+    uint8_t data[5];
+    dht11_decode_result_t result = dht11_decode_frame(pulses, count, config, data, timing);
+
+    sample->flags = 0;
+    if (result != DHT11_DECODE_OK) {
+        return result;
+    }
+
+    sample->humidity = (int16_t)(data[0] * 100 + data[1] * 10);
+    sample->temperature = (int16_t)(data[2] * 100 + data[3] * 10);
+    sample->humidity_filtered = sample->humidity;
+    sample->temperature_filtered = sample->temperature;
+    sample->filter = 0;
+    sample->flags = SENSOR_SAMPLE_VALID;
+    return DHT11_DECODE_OK;
+}
+
+const char *dht11_decode_result_name(dht11_decode_result_t result) {
+    switch (result) {
+        case DHT11_DECODE_OK:               return "OK";
+        case DHT11_DECODE_NO_RESPONSE:      return "NO_RESPONSE";
+        case DHT11_DECODE_TRUNCATED:        return "TRUNCATED";
+        case DHT11_DECODE_BAD_PULSE:        return "BAD_PULSE";
+        case DHT11_DECODE_AMBIGUOUS_BIT:    return "AMBIGUOUS_BIT";
+        case DHT11_DECODE_CHECKSUM:         return "CHECKSUM";
+        default:                            return "UNKNOWN";
+    }
+}
@@ -1,12 +1,19 @@
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "dht11_sensor.h"
+#include "dht11_decoder.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
-#include "rom/ets_sys.h"
-#include "envilog_mqtt.h"
+#include "esp_attr.h"
+#if CONFIG_DHT11_CAPTURE_RMT
+#include "driver/rmt_rx.h"
+#include "soc/soc_caps.h"
+#endif
 #include "cJSON.h"
 #include "error_handler.h"
 #include "data_manager.h"
@@ -15,211 +22,976 @@ static const char *TAG = "dht11";
 
 // DHT11 datasheet specifications
 #define DHT11_MIN_INTERVAL_MS    2000   // Minimum 2 seconds between reads
-#define DHT11_TEMP_MIN           0      // 0°C minimum operating temperature  
+#define DHT11_TEMP_MIN           0      // 0°C minimum operating temperature
 #define DHT11_TEMP_MAX           50     // 50°C maximum operating temperature
 #define DHT11_HUM_MIN            20     // 20%RH minimum at 25°C
 #define DHT11_HUM_MAX            90     // 90%RH maximum at 25°C
 
-static uint8_t dht_gpio;
+// DHT11 frame timing
+#define DHT11_START_PULSE_US     20000  // Host start signal, >18ms low
+#define DHT11_FRAME_TIMEOUT_MS   30     // Start pulse + ~5ms frame + margin
+#define DHT11_MAX_EDGES          84     // Release, response, 40 bits, end-of-frame low
+#define DHT11_MAX_PULSES         (DHT11_MAX_EDGES + 4)
+
+// Sampling clock
+#define DHT11_RETRY_DELAY_MS     DHT11_MIN_INTERVAL_MS  // Sensor needs the full rest time before a retry
+#define DHT11_MAX_RETRIES        2      // Retries per slot, only while they fit before the next slot
+#define DHT11_SLOT_GUARD_US      100000 // Keep retries this far clear of the next slot
+#define DHT11_TRIGGER_TIMEOUT_MS (2 * DHT11_MIN_INTERVAL_MS)  // Rest time and a frame, with room for a read in progress
+
+// Adaptive sampling: a change beyond these (0.01 units) since the last change drops to the floor
+#define DHT11_ADAPTIVE_TEMP_DELTA    CONFIG_DHT11_ADAPTIVE_TEMP_DELTA
+#define DHT11_ADAPTIVE_HUM_DELTA     CONFIG_DHT11_ADAPTIVE_HUM_DELTA
+#define DHT11_ADAPTIVE_STABLE_READS  CONFIG_DHT11_ADAPTIVE_STABLE_READS  // Per probe, before each doubling
+#define DHT11_ADAPTIVE_FLOOR_US      (DHT11_MIN_INTERVAL_MS * 1000LL + DHT11_SLOT_GUARD_US)  // Slots clear the rest time despite jitter
+
+// Timing histogram ranges (offset, bucket width) in microseconds
+#define DHT11_HIST_LATENCY       20000, 1000    // Start pulse + frame is ~25ms
+#define DHT11_HIST_RESPONSE      60, 4          // Nominal 80us
+#define DHT11_HIST_BIT_MARGIN    0, 4           // Nominal ~22us either side of the threshold
+
+// RMT capture configuration
+#define DHT11_RMT_RESOLUTION_HZ  1000000  // 1MHz, 1 tick = 1us
+#define DHT11_RMT_SYMBOLS        SOC_RMT_MEM_WORDS_PER_CHANNEL  // One RX block (48 on ESP32-S3), a full frame is ~43 symbols
+#define DHT11_RMT_GLITCH_NS      1000     // Ignore pulses shorter than 1us
+#define DHT11_RMT_IDLE_NS        200000   // Line idle for 200us ends the frame
+
+// Per-probe driver state
+struct dht11_sensor {
+    sensor_driver_t base;               // Generic driver interface, must stay first
+    uint8_t gpio;
+    char source[DHT11_SOURCE_NAME_LEN];
+    data_manager_handle_t data_handle;  // Registered at creation, or later by the reading task
+    sensor_sample_t last_sample;        // Last valid sample, fixed point
+    int64_t last_read_time;
+    int64_t next_due_us;                // Scheduler slot for the next read
+    int64_t retry_due_us;               // Pending retry inside the current period, 0 if none
+    uint8_t slot_retries;               // Retries already spent on the current slot
+    uint64_t jitter_total_us;           // Sum of |start - slot| for the mean
+    sensor_sample_t change_anchor;      // Sample at the last significant change, adaptive sampling only
+    dht11_cadence_stats_t cadence;
+    dht11_timing_stats_t timing;        // Per-read latency and pulse-width histograms
+    sensor_filter_t filter;             // Owned by the reading task
+    sensor_filter_config_t pending_filter;  // Written under sensors_lock
+    uint32_t filter_generation;         // Bumped on every pending_filter change
+    uint32_t applied_filter_generation;
+#if CONFIG_DHT11_CAPTURE_RMT
+    rmt_channel_handle_t rx_channel;
+#endif
+};
+
+static dht11_handle_t sensors[DHT11_MAX_SENSORS];
+static size_t sensor_count = 0;
+static dht11_handle_t default_sensor = NULL;
+static portMUX_TYPE sensors_lock = portMUX_INITIALIZER_UNLOCKED;
+
 static TaskHandle_t dht11_task_handle = NULL;
-static dht11_reading_t last_reading = {0};
 static bool sensor_running = false;
-static int64_t last_read_time = -2000000;
+static const dht11_decoder_config_t decoder_config = DHT11_DECODER_DEFAULT_CONFIG();
+
+// Sampling clock: a one-shot esp_timer armed for absolute slot times
+static esp_timer_handle_t sample_clock_timer = NULL;
+static SemaphoreHandle_t sample_clock_sem = NULL;
+
+// Runtime config slot; writers bump the generation, the task picks it up at the next boundary
+static dht11_runtime_config_t pending_config = {
+    .read_interval_ms = DHT11_MIN_INTERVAL_MS,
+    .enabled = true
+};
+static volatile uint32_t config_generation = 0;
+
+// Reads requested outside the schedule, served by the reading task
+static SemaphoreHandle_t trigger_mutex = NULL;      // One request in flight
+static SemaphoreHandle_t trigger_done = NULL;
+static volatile dht11_handle_t trigger_sensor = NULL;   // Requested probe, written under sensors_lock
+static esp_err_t trigger_result = ESP_OK;
+
+// Capture state shared by all probes; only one frame is in flight at a time
+static SemaphoreHandle_t capture_mutex = NULL;
+static dht11_handle_t active_sensor = NULL;
+static TaskHandle_t capture_task = NULL;
+static esp_timer_handle_t start_pulse_timer = NULL;
+#if CONFIG_DHT11_CAPTURE_RMT
+static rmt_symbol_word_t rx_symbols[DHT11_RMT_SYMBOLS];
+#else
+typedef struct {
+    int64_t time_us;
+    uint8_t level;
+} dht11_edge_t;
 
-// Basic statistics tracking for reliability monitoring
-static uint32_t total_reads = 0;
-static uint32_t failed_reads = 0;
+static dht11_edge_t edges[DHT11_MAX_EDGES];
+static volatile size_t edge_count = 0;
+#endif
 
-// Validate sensor reading against datasheet specifications
-static bool validate_dht11_reading(const dht11_reading_t *reading) {
+// Validate sensor sample against datasheet specifications
+static bool validate_dht11_sample(const sensor_sample_t *sample) {
     // Validate temperature range from datasheet
-    if (reading->temperature < DHT11_TEMP_MIN || reading->temperature > DHT11_TEMP_MAX) {
-        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_RESPONSE, ERROR_CAT_VALIDATION, 
-                 "Temperature out of range: %.1f°C (valid: %d-%d°C)", 
-                 reading->temperature, DHT11_TEMP_MIN, DHT11_TEMP_MAX);
+    if (sample->temperature < DHT11_TEMP_MIN * 100 || sample->temperature > DHT11_TEMP_MAX * 100) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_RESPONSE, ERROR_CAT_VALIDATION,
+                 "Temperature out of range: " SENSOR_CENTI_FMT "°C (valid: %d-%d°C)",
+                 SENSOR_CENTI_ARGS(sample->temperature), DHT11_TEMP_MIN, DHT11_TEMP_MAX);
         return false;
     }
-    
+
     // Validate humidity range from datasheet
-    if (reading->humidity < DHT11_HUM_MIN || reading->humidity > DHT11_HUM_MAX) {
-        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_RESPONSE, ERROR_CAT_VALIDATION, 
-                 "Humidity out of range: %.1f%% (valid: %d-%d%%)", 
-                 reading->humidity, DHT11_HUM_MIN, DHT11_HUM_MAX);
+    if (sample->humidity < DHT11_HUM_MIN * 100 || sample->humidity > DHT11_HUM_MAX * 100) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_RESPONSE, ERROR_CAT_VALIDATION,
+                 "Humidity out of range: " SENSOR_CENTI_FMT "%% (valid: %d-%d%%)",
+                 SENSOR_CENTI_ARGS(sample->humidity), DHT11_HUM_MIN, DHT11_HUM_MAX);
         return false;
     }
-    
+
     return true;
 }
 
-// Helper function for timing-based reading
-static int wait_or_timeout(uint16_t microSeconds, int level) {
-    int micros_ticks = 0;
-    while(gpio_get_level(dht_gpio) == level) { 
-        if(micros_ticks++ > microSeconds) {
-            ERROR_LOG_WARNING(TAG, ESP_ERR_TIMEOUT, ERROR_CAT_SENSOR, 
-                 "Timeout waiting for level %d after %d microseconds", level, micros_ticks);
-            return ESP_ERR_TIMEOUT;
-        }
-        ets_delay_us(1);
-    }
-    return micros_ticks;
-}
-
-static esp_err_t read_raw_data(uint8_t data[5]) {
-    memset(data, 0, 5);
-    
-    // Start signal
-    gpio_set_direction(dht_gpio, GPIO_MODE_OUTPUT);
-    gpio_set_level(dht_gpio, 0);
-    ets_delay_us(20000);    // 20ms low
-    gpio_set_level(dht_gpio, 1);
-    ets_delay_us(40);       // 40us high
-    gpio_set_direction(dht_gpio, GPIO_MODE_INPUT);
-    
-    ESP_LOGD(TAG, "Waiting for DHT11 response");
-    
-    // Check response (low 80us, high 80us)
-    if(wait_or_timeout(80, 0) == ESP_ERR_TIMEOUT) return ESP_ERR_TIMEOUT;
-    if(wait_or_timeout(80, 1) == ESP_ERR_TIMEOUT) return ESP_ERR_TIMEOUT;
-    
-    // Read 40 bits (5 bytes)
-    for(int i = 0; i < 40; i++) {
-        if(wait_or_timeout(50, 0) == ESP_ERR_TIMEOUT) return ESP_ERR_TIMEOUT;
-        
-        int high_duration = wait_or_timeout(70, 1);
-        if(high_duration == ESP_ERR_TIMEOUT) return ESP_ERR_TIMEOUT;
-        
-        if(high_duration > 28) {
-            data[i/8] |= (1 << (7-(i%8)));
-        }
+// Release the start pulse; runs from the esp_timer task once the 20ms low has elapsed
+static void start_pulse_timer_callback(void *arg) {
+    dht11_handle_t sensor = active_sensor;
+#if CONFIG_DHT11_CAPTURE_RMT
+    rmt_receive_config_t rx_config = {
+        .signal_range_min_ns = DHT11_RMT_GLITCH_NS,
+        .signal_range_max_ns = DHT11_RMT_IDLE_NS,
+    };
+    if (rmt_receive(sensor->rx_channel, rx_symbols, sizeof(rx_symbols), &rx_config) != ESP_OK) {
+        // Still end the start pulse; the line idles high until the next read
+        gpio_set_level(sensor->gpio, 1);
+        xTaskNotify(capture_task, 0, eSetValueWithOverwrite);
+        return;
+    }
+#else
+    // The release itself is the first captured edge
+    edge_count = 0;
+    gpio_intr_enable(sensor->gpio);
+#endif
+    gpio_set_level(sensor->gpio, 1);
+}
+
+#if CONFIG_DHT11_CAPTURE_RMT
+static bool IRAM_ATTR rmt_rx_done_callback(rmt_channel_handle_t channel,
+                                           const rmt_rx_done_event_data_t *edata, void *user_ctx) {
+    BaseType_t high_task_wakeup = pdFALSE;
+    xTaskNotifyFromISR(capture_task, edata->num_symbols, eSetValueWithOverwrite, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+}
+
+// Flatten RMT symbols (two level/duration pairs each) into a pulse list
+static size_t collect_pulses(size_t num_symbols, dht11_pulse_t *pulses, size_t max_pulses) {
+    size_t count = 0;
+    for (size_t i = 0; i < num_symbols && count + 1 < max_pulses; i++) {
+        if (rx_symbols[i].duration0 == 0) break;
+        pulses[count++] = (dht11_pulse_t){ .duration_us = rx_symbols[i].duration0, .level = rx_symbols[i].level0 };
+        if (rx_symbols[i].duration1 == 0) break;
+        pulses[count++] = (dht11_pulse_t){ .duration_us = rx_symbols[i].duration1, .level = rx_symbols[i].level1 };
     }
-    
-    ESP_LOGD(TAG, "Read complete: %02x %02x %02x %02x %02x", 
-             data[0], data[1], data[2], data[3], data[4]);
-             
-    // Verify checksum
-    if(data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_CRC, ERROR_CAT_SENSOR, "Checksum failed");
-        return ESP_ERR_INVALID_CRC;
+    return count;
+}
+
+static esp_err_t capture_init(dht11_handle_t sensor) {
+    rmt_rx_channel_config_t rx_chan_config = {
+        .gpio_num = sensor->gpio,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = DHT11_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = DHT11_RMT_SYMBOLS,
+    };
+    esp_err_t ret = rmt_new_rx_channel(&rx_chan_config, &sensor->rx_channel);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_HARDWARE, "Failed to create RMT RX channel");
+        return ret;
     }
-    
+
+    rmt_rx_event_callbacks_t cbs = {
+        .on_recv_done = rmt_rx_done_callback,
+    };
+    ret = rmt_rx_register_event_callbacks(sensor->rx_channel, &cbs, NULL);
+    if (ret == ESP_OK) {
+        ret = rmt_enable(sensor->rx_channel);
+    }
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_HARDWARE, "Failed to set up RMT RX channel");
+        rmt_del_channel(sensor->rx_channel);
+        sensor->rx_channel = NULL;
+        return ret;
+    }
+
+    // The RX channel routes the pad as input only; restore open-drain output for the start pulse
+    gpio_set_direction(sensor->gpio, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(sensor->gpio, GPIO_PULLUP_ONLY);
     return ESP_OK;
 }
 
-static esp_err_t publish_reading(const dht11_reading_t *reading) {
-    if (!reading->valid) {
+static void capture_abort(dht11_handle_t sensor) {
+    // Cycling the channel drops a receive that never saw the end of frame
+    rmt_disable(sensor->rx_channel);
+    rmt_enable(sensor->rx_channel);
+}
+#else
+static void IRAM_ATTR gpio_edge_isr(void *arg) {
+    dht11_handle_t sensor = (dht11_handle_t)arg;
+    if (edge_count < DHT11_MAX_EDGES) {
+        edges[edge_count].time_us = esp_timer_get_time();
+        edges[edge_count].level = gpio_get_level(sensor->gpio);
+        edge_count++;
+    }
+    if (edge_count == DHT11_MAX_EDGES) {
+        BaseType_t high_task_wakeup = pdFALSE;
+        gpio_intr_disable(sensor->gpio);
+        xTaskNotifyFromISR(capture_task, edge_count, eSetValueWithOverwrite, &high_task_wakeup);
+        portYIELD_FROM_ISR(high_task_wakeup);
+    }
+}
+
+// Convert edge timestamps into a pulse list
+static size_t collect_pulses(size_t num_edges, dht11_pulse_t *pulses, size_t max_pulses) {
+    size_t count = 0;
+    for (size_t i = 0; i + 1 < num_edges && count < max_pulses; i++) {
+        pulses[count++] = (dht11_pulse_t){
+            .duration_us = (uint16_t)(edges[i + 1].time_us - edges[i].time_us),
+            .level = edges[i].level
+        };
+    }
+    return count;
+}
+
+static esp_err_t capture_init(dht11_handle_t sensor) {
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_HARDWARE, "Failed to install GPIO ISR service");
+        return ret;
+    }
+
+    gpio_set_intr_type(sensor->gpio, GPIO_INTR_ANYEDGE);
+    gpio_intr_disable(sensor->gpio);
+    ret = gpio_isr_handler_add(sensor->gpio, gpio_edge_isr, sensor);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_HARDWARE, "Failed to add GPIO ISR handler");
+    }
+    return ret;
+}
+
+static void capture_abort(dht11_handle_t sensor) {
+    gpio_intr_disable(sensor->gpio);
+}
+#endif
+
+// Create the capture resources shared by every probe
+static esp_err_t capture_shared_init(void) {
+    if (capture_mutex != NULL) {
+        return ESP_OK;
+    }
+
+    capture_mutex = xSemaphoreCreateMutex();
+    if (capture_mutex == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to create capture mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = start_pulse_timer_callback,
+        .name = "dht11_start"
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &start_pulse_timer);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SYSTEM, "Failed to create start pulse timer");
+        vSemaphoreDelete(capture_mutex);
+        capture_mutex = NULL;
+    }
+    return ret;
+}
+
+// Run one start pulse/capture cycle; caller holds capture_mutex
+static esp_err_t capture_frame(dht11_handle_t sensor, dht11_pulse_t *pulses, size_t *count) {
+    *count = 0;
+    active_sensor = sensor;
+    capture_task = xTaskGetCurrentTaskHandle();
+    xTaskNotifyStateClear(NULL);
+
+    // Start signal: hold the line low, the timer releases it and arms the capture
+    gpio_set_level(sensor->gpio, 0);
+    esp_err_t ret = esp_timer_start_once(start_pulse_timer, DHT11_START_PULSE_US);
+    if (ret != ESP_OK) {
+        gpio_set_level(sensor->gpio, 1);
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "Failed to start DHT11 start pulse timer");
+        return ret;
+    }
+
+    ESP_LOGD(TAG, "Waiting for %s frame", sensor->source);
+
+    uint32_t captured = 0;
+    if (xTaskNotifyWait(0, ULONG_MAX, &captured, pdMS_TO_TICKS(DHT11_FRAME_TIMEOUT_MS)) != pdTRUE) {
+        capture_abort(sensor);
+#if CONFIG_DHT11_CAPTURE_GPIO_ISR
+        // A short frame never fills the edge buffer; let the decoder report what is missing
+        captured = edge_count;
+#else
+        ERROR_LOG_WARNING(TAG, ESP_ERR_TIMEOUT, ERROR_CAT_SENSOR,
+            "Timeout waiting for %s frame", sensor->source);
+        return ESP_ERR_TIMEOUT;
+#endif
+    }
+
+    if (captured == 0) {
+        // The receive was never armed or saw no edge, which is no frame at all
+        ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_SENSOR,
+            "No %s frame captured", sensor->source);
+        return ESP_FAIL;
+    }
+
+    *count = collect_pulses(captured, pulses, DHT11_MAX_PULSES);
+    return ESP_OK;
+}
+
+// Map decoder failures onto the error codes callers already handle
+static esp_err_t decode_result_to_err(dht11_decode_result_t result) {
+    switch (result) {
+        case DHT11_DECODE_OK:           return ESP_OK;
+        case DHT11_DECODE_NO_RESPONSE:
+        case DHT11_DECODE_TRUNCATED:    return ESP_ERR_TIMEOUT;
+        case DHT11_DECODE_CHECKSUM:     return ESP_ERR_INVALID_CRC;
+        default:                        return ESP_ERR_INVALID_RESPONSE;
+    }
+}
+
+// Probes may be created before the data manager, so register on first use
+static bool data_handle_ready(dht11_handle_t sensor) {
+    if (sensor->data_handle == DATA_MANAGER_INVALID_HANDLE) {
+        data_manager_handle_t handle;
+        if (data_manager_register_source(sensor->source, NULL, &handle) == ESP_OK) {
+            sensor->data_handle = handle;
+        }
+    }
+    return sensor->data_handle != DATA_MANAGER_INVALID_HANDLE;
+}
+
+static esp_err_t publish_sample(dht11_handle_t sensor, const sensor_sample_t *sample) {
+    if (!sensor_sample_is_valid(sample)) {
         return ESP_FAIL;
     }
+    if (!data_handle_ready(sensor)) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
     // Send to data manager instead of MQTT directly
-    esp_err_t ret = data_manager_publish_sensor_data("dht11", reading);
+    esp_err_t ret = data_manager_publish(sensor->data_handle, sample);
     if (ret != ESP_OK) {
-        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "Failed to publish sensor data");
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "Failed to publish %s data", sensor->source);
     }
 
     return ret;
 }
 
-esp_err_t dht11_init(uint8_t gpio_num) {
-    dht_gpio = gpio_num;
-    
+static esp_err_t read_sample(dht11_handle_t sensor, sensor_sample_t *sample);
+static esp_err_t request_read(dht11_handle_t sensor);
+
+// Filter selected in menuconfig for new probes
+static sensor_filter_config_t default_filter_config(void) {
+    sensor_filter_config_t config = SENSOR_FILTER_DEFAULT_CONFIG();
+#if CONFIG_DHT11_FILTER_MEDIAN
+    config.type = SENSOR_FILTER_MEDIAN;
+    config.median_window = CONFIG_DHT11_FILTER_MEDIAN_WINDOW | 1;   // Window must be odd
+#elif CONFIG_DHT11_FILTER_EWMA
+    config.type = SENSOR_FILTER_EWMA;
+#elif CONFIG_DHT11_FILTER_KALMAN
+    config.type = SENSOR_FILTER_KALMAN;
+#endif
+    return config;
+}
+
+// Pick up a filter change for this probe; history restarts with the new filter
+static void apply_pending_filter(dht11_handle_t sensor) {
+    sensor_filter_config_t config;
+    bool changed = false;
+
+    taskENTER_CRITICAL(&sensors_lock);
+    if (sensor->filter_generation != sensor->applied_filter_generation) {
+        config = sensor->pending_filter;
+        sensor->applied_filter_generation = sensor->filter_generation;
+        changed = true;
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+
+    if (changed) {
+        sensor_filter_init(&sensor->filter, &config);
+        ESP_LOGI(TAG, "%s filter: %s", sensor->source, sensor_filter_type_name(config.type));
+    }
+}
+
+// Feed the widths measured while decoding one frame into the probe's histograms
+static void record_frame_timing(dht11_handle_t sensor, int64_t latency_us, const dht11_frame_timing_t *frame) {
+    dht11_timing_stats_t *timing = &sensor->timing;
+
+    sensor_histogram_add(&timing->latency, (uint32_t)latency_us);
+    if (frame->response_low_us) {
+        sensor_histogram_add(&timing->response_low, frame->response_low_us);
+    }
+    if (frame->response_high_us) {
+        sensor_histogram_add(&timing->response_high, frame->response_high_us);
+    }
+    for (uint8_t i = 0; i < frame->bits; i++) {
+        sensor_histogram_add(&timing->bit_margin, frame->bit_margin_us[i]);
+    }
+    if (frame->bits) {
+        timing->last_min_margin_us = frame->min_bit_margin_us;
+    }
+}
+
+// Generic driver interface; trigger waits for the reading task to acquire, filter and publish a frame
+static esp_err_t dht11_driver_trigger(sensor_driver_t *driver) {
+    dht11_handle_t sensor = __containerof(driver, struct dht11_sensor, base);
+    return request_read(sensor);
+}
+
+static esp_err_t dht11_driver_read(sensor_driver_t *driver, sensor_reading_t *reading) {
+    dht11_handle_t sensor = __containerof(driver, struct dht11_sensor, base);
+    return dht11_get_sensor_last_reading(sensor, reading);
+}
+
+static void dht11_driver_get_capabilities(sensor_driver_t *driver, sensor_capabilities_t *caps) {
+    caps->channels = SENSOR_CHANNEL_TEMPERATURE | SENSOR_CHANNEL_HUMIDITY;
+    caps->min_interval_ms = DHT11_MIN_INTERVAL_MS;
+    caps->temperature_resolution = 0.1f;
+    caps->humidity_resolution = 1.0f;
+}
+
+esp_err_t dht11_new_sensor(const dht11_config_t *config, dht11_handle_t *ret_handle) {
+    if (config == NULL || config->source == NULL || ret_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (sensor_count >= DHT11_MAX_SENSORS) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_CONFIG,
+            "Maximum of %d DHT11 sensors reached", DHT11_MAX_SENSORS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = capture_shared_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    dht11_handle_t sensor = calloc(1, sizeof(struct dht11_sensor));
+    if (sensor == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to allocate DHT11 sensor");
+        return ESP_ERR_NO_MEM;
+    }
+    sensor->base.name = "dht11";
+    sensor->base.trigger = dht11_driver_trigger;
+    sensor->base.read = dht11_driver_read;
+    sensor->base.get_capabilities = dht11_driver_get_capabilities;
+    sensor->gpio = config->gpio_num;
+    strlcpy(sensor->source, config->source, sizeof(sensor->source));
+    sensor->data_handle = DATA_MANAGER_INVALID_HANDLE;
+    sensor->last_read_time = -(DHT11_MIN_INTERVAL_MS * 1000LL);
+    sensor->next_due_us = esp_timer_get_time();
+    sensor_histogram_init(&sensor->timing.latency, DHT11_HIST_LATENCY);
+    sensor_histogram_init(&sensor->timing.response_low, DHT11_HIST_RESPONSE);
+    sensor_histogram_init(&sensor->timing.response_high, DHT11_HIST_RESPONSE);
+    sensor_histogram_init(&sensor->timing.bit_margin, DHT11_HIST_BIT_MARGIN);
+    sensor->pending_filter = default_filter_config();
+    sensor_filter_init(&sensor->filter, &sensor->pending_filter);
+
     gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << dht_gpio),
-        .mode = GPIO_MODE_INPUT_OUTPUT,
+        .pin_bit_mask = (1ULL << sensor->gpio),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE
     };
-    
-    esp_err_t ret = gpio_config(&io_conf);
+
+    ret = gpio_config(&io_conf);
     if (ret != ESP_OK) {
         ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_HARDWARE, "Failed to configure GPIO");
+        free(sensor);
         return ret;
     }
 
     // Set initial state
-    gpio_set_level(dht_gpio, 1);
-    
-    ESP_LOGI(TAG, "DHT11 initialized on GPIO%d", dht_gpio);
+    gpio_set_level(sensor->gpio, 1);
+
+    ret = capture_init(sensor);
+    if (ret != ESP_OK) {
+        free(sensor);
+        return ret;
+    }
+
+    taskENTER_CRITICAL(&sensors_lock);
+    sensors[sensor_count++] = sensor;
+    taskEXIT_CRITICAL(&sensors_lock);
+    data_handle_ready(sensor);
+
+    *ret_handle = sensor;
+    ESP_LOGI(TAG, "DHT11 '%s' initialized on GPIO%d", sensor->source, sensor->gpio);
     return ESP_OK;
 }
 
-esp_err_t dht11_read(dht11_reading_t *reading) {
-    if (reading == NULL) return ESP_ERR_INVALID_ARG;
-    
+esp_err_t dht11_init(uint8_t gpio_num) {
+    dht11_config_t config = {
+        .gpio_num = gpio_num,
+        .source = "dht11"
+    };
+    return dht11_new_sensor(&config, &default_sensor);
+}
+
+// Acquire one fixed-point sample; the frame bytes are converted without float math.
+// ESP_ERR_INVALID_STATE without touching the sample while the probe rests from its last frame.
+static esp_err_t read_sample(dht11_handle_t sensor, sensor_sample_t *sample) {
     // Enforce datasheet timing requirement (minimum 2 seconds between reads)
     int64_t current_time = esp_timer_get_time();
-    if (current_time - last_read_time < (DHT11_MIN_INTERVAL_MS * 1000)) {
-        // Return cached reading if too soon
-        memcpy(reading, &last_reading, sizeof(dht11_reading_t));
-        ESP_LOGD(TAG, "Using cached reading (too soon for new read)");
-        return ESP_OK;
+    if (current_time - sensor->last_read_time < (DHT11_MIN_INTERVAL_MS * 1000)) {
+        ESP_LOGD(TAG, "%s read too soon after the last frame", sensor->source);
+        return ESP_ERR_INVALID_STATE;
     }
-    
-    uint8_t data[5] = {0};
-    esp_err_t ret = read_raw_data(data);
-    
+
+    dht11_pulse_t pulses[DHT11_MAX_PULSES];
+    size_t count = 0;
+    xSemaphoreTake(capture_mutex, portMAX_DELAY);
+    esp_err_t ret = capture_frame(sensor, pulses, &count);
+    xSemaphoreGive(capture_mutex);
+
     if (ret == ESP_OK) {
-        reading->humidity = (float)data[0] + (float)data[1]/10.0f;
-        reading->temperature = (float)data[2] + (float)data[3]/10.0f;
-        reading->timestamp = esp_timer_get_time() / 1000;  // microseconds to milliseconds
-        
+        dht11_frame_timing_t frame_timing;
+        dht11_decode_result_t result = dht11_decode_sample(pulses, count, &decoder_config,
+                                                           sample, &frame_timing);
+        record_frame_timing(sensor, esp_timer_get_time() - current_time, &frame_timing);
+        if (result != DHT11_DECODE_OK) {
+            ERROR_LOG_WARNING(TAG, decode_result_to_err(result), ERROR_CAT_SENSOR,
+                "%s frame decode failed: %s (%d pulses)", sensor->source,
+                dht11_decode_result_name(result), count);
+        }
+        ret = decode_result_to_err(result);
+    }
+
+    if (ret == ESP_OK) {
+        sample->timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);  // microseconds to milliseconds
+
         // Apply datasheet-based validation
-        if (validate_dht11_reading(reading)) {
-            reading->valid = true;
-            
+        if (validate_dht11_sample(sample)) {
+            sample->flags |= SENSOR_SAMPLE_VALID;
+
             // Update last reading
-            memcpy(&last_reading, reading, sizeof(dht11_reading_t));
-            last_read_time = current_time;
-            
-            ESP_LOGI(TAG, "DHT11: %.1f°C, %.1f%%RH", 
-                     reading->temperature, reading->humidity);
+            sensor->last_sample = *sample;
+            sensor->last_read_time = current_time;
+
+            ESP_LOGI(TAG, "%s: " SENSOR_CENTI_FMT "°C, " SENSOR_CENTI_FMT "%%RH", sensor->source,
+                     SENSOR_CENTI_ARGS(sample->temperature), SENSOR_CENTI_ARGS(sample->humidity));
         } else {
-            reading->valid = false;
+            sample->flags &= ~SENSOR_SAMPLE_VALID;
             ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_RESPONSE, ERROR_CAT_VALIDATION,
-                "DHT11 reading failed validation");
+                "%s reading failed validation", sensor->source);
             ret = ESP_ERR_INVALID_RESPONSE;
         }
     } else {
-        reading->valid = false;
-        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "DHT11 read failed");
+        sample->flags &= ~SENSOR_SAMPLE_VALID;
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "%s read failed", sensor->source);
     }
-    
+
+    return ret;
+}
+
+esp_err_t dht11_read_sensor(dht11_handle_t sensor, dht11_reading_t *reading) {
+    if (sensor == NULL || reading == NULL) return ESP_ERR_INVALID_ARG;
+
+    // With the reading task running, the frame must come from it
+    if (sensor_running) {
+        esp_err_t ret = request_read(sensor);
+        sensor_sample_to_reading(&sensor->last_sample, esp_timer_get_time() / 1000, reading);
+        reading->valid &= (ret == ESP_OK);
+        return ret;
+    }
+
+    sensor_sample_t sample = {0};
+    esp_err_t ret = read_sample(sensor, &sample);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        // Too soon for a new frame, report the last one
+        sample = sensor->last_sample;
+        ret = ESP_OK;
+    }
+    sensor_sample_to_reading(&sample, esp_timer_get_time() / 1000, reading);
+    return ret;
+}
+
+esp_err_t dht11_read(dht11_reading_t *reading) {
+    if (default_sensor == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return dht11_read_sensor(default_sensor, reading);
+}
+
+static void sample_clock_callback(void *arg) {
+    xSemaphoreGive(sample_clock_sem);
+}
+
+static esp_err_t sample_clock_init(void) {
+    if (sample_clock_timer != NULL) {
+        return ESP_OK;
+    }
+
+    sample_clock_sem = xSemaphoreCreateBinary();
+    if (sample_clock_sem == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to create sample clock semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_clock_callback,
+        .name = "dht11_clock"
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &sample_clock_timer);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SYSTEM, "Failed to create sample clock timer");
+        vSemaphoreDelete(sample_clock_sem);
+        sample_clock_sem = NULL;
+    }
+    return ret;
+}
+
+static esp_err_t trigger_init(void) {
+    if (trigger_mutex != NULL) {
+        return ESP_OK;
+    }
+
+    trigger_mutex = xSemaphoreCreateMutex();
+    trigger_done = xSemaphoreCreateBinary();
+    if (trigger_mutex == NULL || trigger_done == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to create trigger semaphores");
+        if (trigger_mutex != NULL) {
+            vSemaphoreDelete(trigger_mutex);
+            trigger_mutex = NULL;
+        }
+        if (trigger_done != NULL) {
+            vSemaphoreDelete(trigger_done);
+            trigger_done = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Hand a read of the probe to the reading task and wait for its result
+static esp_err_t request_read(dht11_handle_t sensor) {
+    if (!sensor_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(trigger_mutex, portMAX_DELAY);
+    xSemaphoreTake(trigger_done, 0);    // Result of an earlier request that timed out
+    taskENTER_CRITICAL(&sensors_lock);
+    trigger_sensor = sensor;
+    taskEXIT_CRITICAL(&sensors_lock);
+    xSemaphoreGive(sample_clock_sem);
+
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+    if (xSemaphoreTake(trigger_done, pdMS_TO_TICKS(DHT11_TRIGGER_TIMEOUT_MS)) == pdTRUE) {
+        ret = trigger_result;
+    } else {
+        taskENTER_CRITICAL(&sensors_lock);
+        trigger_sensor = NULL;
+        taskEXIT_CRITICAL(&sensors_lock);
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "Triggered %s read timed out", sensor->source);
+    }
+    xSemaphoreGive(trigger_mutex);
+    return ret;
+}
+
+// Take the probe of a pending read request, NULL if there is none
+static dht11_handle_t take_trigger(void) {
+    taskENTER_CRITICAL(&sensors_lock);
+    dht11_handle_t sensor = trigger_sensor;
+    trigger_sensor = NULL;
+    taskEXIT_CRITICAL(&sensors_lock);
+    return sensor;
+}
+
+// Block until an absolute esp_timer time; unlike tick delays this keeps microsecond phase.
+// Returns false if a config change or a read request arrived first.
+static bool sample_clock_wait_until(int64_t target_us, uint32_t applied_generation) {
+    xSemaphoreTake(sample_clock_sem, 0);
+    if (config_generation != applied_generation || trigger_sensor != NULL) {
+        return false;
+    }
+
+    int64_t wait_us = target_us - esp_timer_get_time();
+    if (wait_us <= 0) {
+        return true;
+    }
+
+    if (esp_timer_start_once(sample_clock_timer, wait_us) != ESP_OK) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+        return true;
+    }
+    xSemaphoreTake(sample_clock_sem, portMAX_DELAY);
+
+    if (esp_timer_get_time() < target_us) {
+        esp_timer_stop(sample_clock_timer);
+        return false;
+    }
+    return true;
+}
+
+// Copy the pending config if it changed since the last call
+static bool take_pending_config(dht11_runtime_config_t *active, uint32_t *applied_generation) {
+    bool changed = false;
+    taskENTER_CRITICAL(&sensors_lock);
+    if (config_generation != *applied_generation) {
+        *active = pending_config;
+        *applied_generation = config_generation;
+        changed = true;
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+    return changed;
+}
+
+// Spread the probes evenly over one period so their frames never overlap
+static void stagger_slots(int64_t interval_us, int64_t now) {
+    taskENTER_CRITICAL(&sensors_lock);
+    for (size_t i = 0; i < sensor_count; i++) {
+        sensors[i]->next_due_us = now + (interval_us * i) / sensor_count;
+        sensors[i]->retry_due_us = 0;
+        sensors[i]->slot_retries = 0;
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+}
+
+// Move every probe onto the grid of a new interval, measured from its last slot
+static void replan_slots(int64_t old_interval_us, int64_t new_interval_us, int64_t now) {
+    taskENTER_CRITICAL(&sensors_lock);
+    for (size_t i = 0; i < sensor_count; i++) {
+        dht11_handle_t sensor = sensors[i];
+        sensor->next_due_us += new_interval_us - old_interval_us;
+        if (sensor->next_due_us < now) {
+            sensor->next_due_us = now + (new_interval_us * i) / sensor_count;
+        }
+        if (sensor->retry_due_us + DHT11_SLOT_GUARD_US >= sensor->next_due_us) {
+            sensor->retry_due_us = 0;
+        }
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+}
+
+// Track whether a probe's filtered readings moved since its last significant change
+static bool sample_changed(dht11_handle_t sensor, const sensor_sample_t *sample) {
+    sensor_sample_t *anchor = &sensor->change_anchor;
+    if (!sensor_sample_is_valid(anchor) ||
+        abs(sample->temperature_filtered - anchor->temperature_filtered) > DHT11_ADAPTIVE_TEMP_DELTA ||
+        abs(sample->humidity_filtered - anchor->humidity_filtered) > DHT11_ADAPTIVE_HUM_DELTA) {
+        *anchor = *sample;
+        return true;
+    }
+    return false;
+}
+
+// Next adaptive interval: the floor on any change, doubled after enough stable reads of every probe.
+// Only fresh scheduled frames are counted; triggered reads and resting probes never get here.
+static int64_t adapt_interval(dht11_handle_t sensor, const sensor_sample_t *sample, int64_t interval_us,
+                              int64_t ceiling_us, uint32_t *stable_reads) {
+    if (sample_changed(sensor, sample)) {
+        *stable_reads = 0;
+        return (DHT11_ADAPTIVE_FLOOR_US < ceiling_us) ? DHT11_ADAPTIVE_FLOOR_US : ceiling_us;
+    }
+    if (++*stable_reads < DHT11_ADAPTIVE_STABLE_READS * sensor_count) {
+        return interval_us;
+    }
+    *stable_reads = 0;
+    return (interval_us * 2 < ceiling_us) ? interval_us * 2 : ceiling_us;
+}
+
+// Pick the probe whose slot or pending retry comes up first
+static dht11_handle_t next_due_sensor(int64_t *due_us, bool *is_retry) {
+    dht11_handle_t next = NULL;
+    taskENTER_CRITICAL(&sensors_lock);
+    for (size_t i = 0; i < sensor_count; i++) {
+        bool retry = sensors[i]->retry_due_us != 0;
+        int64_t due = retry ? sensors[i]->retry_due_us : sensors[i]->next_due_us;
+        if (next == NULL || due < *due_us) {
+            next = sensors[i];
+            *due_us = due;
+            *is_retry = retry;
+        }
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+    return next;
+}
+
+// Record how far the read started from its slot
+static void record_slot_start(dht11_handle_t sensor, int64_t slot_us, int64_t start_us) {
+    int32_t jitter = (int32_t)(start_us - slot_us);
+    dht11_cadence_stats_t *cadence = &sensor->cadence;
+
+    cadence->samples++;
+    cadence->jitter_last_us = jitter;
+    if (jitter > cadence->jitter_max_us) {
+        cadence->jitter_max_us = jitter;
+    }
+    sensor->jitter_total_us += (jitter < 0) ? -jitter : jitter;
+    cadence->jitter_mean_us = (uint32_t)(sensor->jitter_total_us / cadence->samples);
+}
+
+// Advance to the next slot on the fixed grid, counting any slots that already passed
+static void advance_slot(dht11_handle_t sensor, int64_t interval_us, int64_t now) {
+    sensor->next_due_us += interval_us;
+    while (sensor->next_due_us <= now) {
+        sensor->next_due_us += interval_us;
+        sensor->cadence.missed_slots++;
+    }
+    sensor->slot_retries = 0;
+}
+
+// Take a fresh frame and count it; a valid sample is filtered and published.
+// ESP_ERR_INVALID_STATE, uncounted, if the probe is still resting.
+static esp_err_t acquire_sample(dht11_handle_t sensor, sensor_sample_t *sample) {
+    esp_err_t ret = read_sample(sensor, sample);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    // Track basic statistics for monitoring
+    sensor->timing.reads++;
+    if (ret != ESP_OK || !sensor_sample_is_valid(sample)) {
+        sensor->timing.failed_reads++;
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "Failed to read %s", sensor->source);
+        return (ret != ESP_OK) ? ret : ESP_ERR_INVALID_RESPONSE;
+    }
+
+    // Filter every valid sample so the history is complete when publishing resumes
+    apply_pending_filter(sensor);
+    sensor_filter_apply(&sensor->filter, sample);
+    sensor->last_sample = *sample;
+
+    // Publish even while offline so history and the sample store have no gaps
+    publish_sample(sensor, sample);
+    return ESP_OK;
+}
+
+static void report_stats(dht11_handle_t sensor) {
+    if (data_handle_ready(sensor)) {
+        data_manager_update_cadence_stats(sensor->data_handle, &sensor->cadence);
+        data_manager_update_timing_stats(sensor->data_handle, &sensor->timing);
+    }
+
+    // Log statistics periodically for monitoring
+    const dht11_timing_stats_t *timing = &sensor->timing;
+    if (timing->reads % 50 == 0 && timing->reads > 0) {
+        float success_rate = (float)(timing->reads - timing->failed_reads) / timing->reads * 100;
+        ESP_LOGI(TAG, "%s stats: %lu total, %lu failed (%.1f%% success), jitter mean %lu us max %ld us, "
+                 "%lu missed slots, %lu retries", sensor->source,
+                 timing->reads, timing->failed_reads, success_rate,
+                 sensor->cadence.jitter_mean_us, sensor->cadence.jitter_max_us,
+                 sensor->cadence.missed_slots, sensor->cadence.retries);
+        ESP_LOGI(TAG, "%s timing: latency max %lu us, response %lu/%lu us, bit margin min %lu us (last frame %lu us)",
+                 sensor->source, timing->latency.max_us,
+                 timing->response_low.count ? (uint32_t)(timing->response_low.total_us / timing->response_low.count) : 0,
+                 timing->response_high.count ? (uint32_t)(timing->response_high.total_us / timing->response_high.count) : 0,
+                 timing->bit_margin.count ? timing->bit_margin.min_us : 0, timing->last_min_margin_us);
+    }
+}
+
+// Serve a read request: off the slot grid, so only the probe's rest time is waited out
+static esp_err_t triggered_read(dht11_handle_t sensor) {
+    int64_t rest_us = sensor->last_read_time + DHT11_MIN_INTERVAL_MS * 1000LL - esp_timer_get_time();
+    if (rest_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS(rest_us / 1000) + 1);
+    }
+
+    sensor_sample_t sample = {0};
+    esp_err_t ret = acquire_sample(sensor, &sample);
+    report_stats(sensor);
     return ret;
 }
 
 static void dht11_reading_task(void *pvParameters) {
-    uint32_t read_interval_ms = (uint32_t)pvParameters;
-    TickType_t last_wake_time = xTaskGetTickCount();
+    dht11_runtime_config_t active = {0};
+    uint32_t applied_generation = 0;
+    take_pending_config(&active, &applied_generation);
+    int64_t interval_us = (int64_t)active.read_interval_ms * 1000;
+    uint32_t stable_reads = 0;
+    stagger_slots(interval_us, esp_timer_get_time());
 
     while (1) {
-        // Read sensor
-        dht11_reading_t reading;
-        esp_err_t ret = dht11_read(&reading);
-
-        // Track basic statistics for monitoring
-        total_reads++;
-        if (ret != ESP_OK || !reading.valid) {
-            failed_reads++;
-            ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SENSOR, "Failed to read DHT11");
-            // Add delay between retries on error
-            vTaskDelay(pdMS_TO_TICKS(2000));
-        } else {
-            // Publish reading if connected
-            if (envilog_mqtt_is_connected()) {
-                publish_reading(&reading);
+        // Apply config changes at the sample boundary
+        bool was_enabled = active.enabled;
+        if (take_pending_config(&active, &applied_generation)) {
+            int64_t new_interval_us = (int64_t)active.read_interval_ms * 1000;
+            if (active.adaptive && interval_us < new_interval_us) {
+                // Keep the adapted rate, only a lower ceiling pulls it down
+                new_interval_us = interval_us;
             }
+            if (active.enabled && !was_enabled) {
+                stagger_slots(new_interval_us, esp_timer_get_time());
+            } else if (new_interval_us != interval_us) {
+                replan_slots(interval_us, new_interval_us, esp_timer_get_time());
+            }
+            interval_us = new_interval_us;
+            ESP_LOGI(TAG, "Applied config: interval %lu ms%s, %s", active.read_interval_ms,
+                     active.adaptive ? " (adaptive ceiling)" : "", active.enabled ? "enabled" : "disabled");
+        }
+
+        // Read requests go ahead of the schedule, even while disabled
+        dht11_handle_t triggered = take_trigger();
+        if (triggered != NULL) {
+            trigger_result = triggered_read(triggered);
+            xSemaphoreGive(trigger_done);
+            continue;
         }
-        
-        // Log statistics periodically for monitoring
-        if (total_reads % 50 == 0 && total_reads > 0) {
-            float success_rate = (float)(total_reads - failed_reads) / total_reads * 100;
-            ESP_LOGI(TAG, "DHT11 stats: %lu total, %lu failed (%.1f%% success)", 
-                     total_reads, failed_reads, success_rate);
+
+        if (!active.enabled) {
+            // Idle without a timer until the next config change or read request
+            xSemaphoreTake(sample_clock_sem, portMAX_DELAY);
+            continue;
+        }
+
+        int64_t due_us = 0;
+        bool is_retry = false;
+        dht11_handle_t sensor = next_due_sensor(&due_us, &is_retry);
+        if (sensor == NULL) {
+            sample_clock_wait_until(esp_timer_get_time() + interval_us, applied_generation);
+            continue;
+        }
+
+        // Wait for the probe's slot, and for its rest time if it was read off the grid
+        int64_t rested_us = sensor->last_read_time + DHT11_MIN_INTERVAL_MS * 1000LL;
+        if (!sample_clock_wait_until(due_us > rested_us ? due_us : rested_us, applied_generation)) {
+            continue;
         }
-        
-        // Wait for next reading interval
-        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(read_interval_ms));
+        int64_t start_us = esp_timer_get_time();
+        if (is_retry) {
+            sensor->retry_due_us = 0;
+            sensor->cadence.retries++;
+        } else {
+            record_slot_start(sensor, due_us, start_us);
+            advance_slot(sensor, interval_us, start_us);
+        }
+
+        // Read sensor; every read goes through this task, so the wait covered the rest time
+        sensor_sample_t sample = {0};
+        esp_err_t ret = acquire_sample(sensor, &sample);
+        if (ret == ESP_ERR_INVALID_STATE) {
+            continue;
+        }
+
+        if (ret != ESP_OK) {
+            // Retry in the slack of this period, never at the expense of the next slot
+            int64_t retry_us = esp_timer_get_time() + DHT11_RETRY_DELAY_MS * 1000LL;
+            if (sensor->slot_retries < DHT11_MAX_RETRIES &&
+                retry_us + DHT11_SLOT_GUARD_US < sensor->next_due_us) {
+                sensor->slot_retries++;
+                sensor->retry_due_us = retry_us;
+            }
+        } else {
+            if (is_retry) {
+                sensor->cadence.retry_successes++;
+            }
+
+            if (active.adaptive) {
+                int64_t new_interval_us = adapt_interval(sensor, &sample, interval_us,
+                                                         (int64_t)active.read_interval_ms * 1000, &stable_reads);
+                if (new_interval_us != interval_us) {
+                    replan_slots(interval_us, new_interval_us, esp_timer_get_time());
+                    ESP_LOGD(TAG, "Adaptive interval %lld ms after %s", new_interval_us / 1000, sensor->source);
+                    interval_us = new_interval_us;
+                }
+            }
+        }
+        sensor->cadence.interval_ms = (uint32_t)(interval_us / 1000);
+        report_stats(sensor);
     }
 }
 
@@ -230,16 +1002,33 @@ esp_err_t dht11_start_reading(uint32_t read_interval_ms) {
 
     // Enforce minimum interval from datasheet
     if (read_interval_ms < DHT11_MIN_INTERVAL_MS) {
-        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, 
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION,
                  "Read interval too short, using minimum %dms", DHT11_MIN_INTERVAL_MS);
         read_interval_ms = DHT11_MIN_INTERVAL_MS;
     }
 
+    esp_err_t err = sample_clock_init();
+    if (err == ESP_OK) {
+        err = trigger_init();
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    dht11_runtime_config_t config = {
+        .read_interval_ms = read_interval_ms,
+        .enabled = true,
+#if CONFIG_DHT11_ADAPTIVE_INTERVAL
+        .adaptive = true
+#endif
+    };
+    dht11_apply_config(&config);
+
     BaseType_t ret = xTaskCreate(
         dht11_reading_task,
         "dht11_task",
         4096,  // Stack size
-        (void*)read_interval_ms,
+        NULL,
         5,     // Priority
         &dht11_task_handle
     );
@@ -250,7 +1039,8 @@ esp_err_t dht11_start_reading(uint32_t read_interval_ms) {
     }
 
     sensor_running = true;
-    ESP_LOGI(TAG, "DHT11 reading task started with interval %lu ms", read_interval_ms);
+    ESP_LOGI(TAG, "DHT11 reading task started for %d sensor(s) with interval %lu ms",
+             sensor_count, read_interval_ms);
     return ESP_OK;
 }
 
@@ -259,19 +1049,128 @@ esp_err_t dht11_stop_reading(void) {
         return ESP_ERR_INVALID_STATE;
     }
 
+    // Never delete the task while it holds the capture resources
+    xSemaphoreTake(capture_mutex, portMAX_DELAY);
     vTaskDelete(dht11_task_handle);
+    xSemaphoreGive(capture_mutex);
     dht11_task_handle = NULL;
     sensor_running = false;
-    
+
     ESP_LOGI(TAG, "DHT11 reading task stopped");
     return ESP_OK;
 }
 
+esp_err_t dht11_apply_config(const dht11_runtime_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->read_interval_ms < DHT11_MIN_INTERVAL_MS) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION,
+                 "Read interval %lu ms below minimum %dms", config->read_interval_ms, DHT11_MIN_INTERVAL_MS);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&sensors_lock);
+    pending_config = *config;
+    config_generation++;
+    taskEXIT_CRITICAL(&sensors_lock);
+
+    // Wake the task so a shorter interval or re-enable does not wait out the old slot
+    if (sample_clock_sem != NULL) {
+        xSemaphoreGive(sample_clock_sem);
+    }
+    return ESP_OK;
+}
+
+esp_err_t dht11_get_config(dht11_runtime_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&sensors_lock);
+    *config = pending_config;
+    taskEXIT_CRITICAL(&sensors_lock);
+    return ESP_OK;
+}
+
+esp_err_t dht11_set_filter(const char *source, const sensor_filter_config_t *config) {
+    esp_err_t ret = sensor_filter_validate(config);
+    if (ret != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_VALIDATION, "Invalid filter configuration");
+        return ret;
+    }
+
+    size_t matched = 0;
+    taskENTER_CRITICAL(&sensors_lock);
+    for (size_t i = 0; i < sensor_count; i++) {
+        if (source == NULL || strcmp(sensors[i]->source, source) == 0) {
+            sensors[i]->pending_filter = *config;
+            sensors[i]->filter_generation++;
+            matched++;
+        }
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+
+    if (matched == 0) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NOT_FOUND, ERROR_CAT_VALIDATION, "Unknown DHT11 source: %s", source);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dht11_get_filter(const char *source, sensor_filter_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&sensors_lock);
+    for (size_t i = 0; i < sensor_count; i++) {
+        if (source == NULL || strcmp(sensors[i]->source, source) == 0) {
+            *config = sensors[i]->pending_filter;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&sensors_lock);
+    return ret;
+}
+
+esp_err_t dht11_get_sensor_last_reading(dht11_handle_t sensor, dht11_reading_t *reading) {
+    if (sensor == NULL || reading == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sensor_sample_to_reading(&sensor->last_sample, esp_timer_get_time() / 1000, reading);
+    return ESP_OK;
+}
+
 esp_err_t dht11_get_last_reading(dht11_reading_t *reading) {
-    if (reading == NULL) {
+    if (default_sensor == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return dht11_get_sensor_last_reading(default_sensor, reading);
+}
+
+esp_err_t dht11_get_cadence_stats(dht11_handle_t sensor, dht11_cadence_stats_t *stats) {
+    if (sensor == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *stats = sensor->cadence;
+    return ESP_OK;
+}
+
+esp_err_t dht11_get_timing_stats(dht11_handle_t sensor, dht11_timing_stats_t *stats) {
+    if (sensor == NULL || stats == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    memcpy(reading, &last_reading, sizeof(dht11_reading_t));
+    *stats = sensor->timing;
     return ESP_OK;
 }
+
+sensor_driver_t *dht11_get_driver(dht11_handle_t sensor) {
+    return sensor ? &sensor->base : NULL;
+}
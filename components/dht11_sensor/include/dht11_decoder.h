@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dht11_sensor.h"
+
+// Single captured line level and how long it was held
+typedef struct {
+    uint16_t duration_us;
+    uint8_t level;
+} dht11_pulse_t;
+
+// Why a pulse train could not be decoded
+typedef enum {
+    DHT11_DECODE_OK = 0,
+    DHT11_DECODE_NO_RESPONSE,      // No 80us low/high response from the sensor
+    DHT11_DECODE_TRUNCATED,        // Frame ended before all 40 bits were seen
+    DHT11_DECODE_BAD_PULSE,        // Bit low/high width outside the accepted window
+    DHT11_DECODE_AMBIGUOUS_BIT,    // Bit high width inside the threshold margin
+    DHT11_DECODE_CHECKSUM          // All bits decoded but the checksum does not match
+} dht11_decode_result_t;
+
+#define DHT11_FRAME_BITS    40
+
+// Pulse widths measured while decoding, for timing-margin health
+typedef struct {
+    uint16_t response_low_us;      // Sensor response low, 0 if no response was found
+    uint16_t response_high_us;     // Sensor response high, 0 if not reached
+    uint8_t bits;                  // Bits classified before the frame ended or failed
+    uint8_t bit_margin_us[DHT11_FRAME_BITS];  // |bit high - bit_threshold_us| per classified bit
+    uint8_t min_bit_margin_us;     // Smallest margin of the classified bits, UINT8_MAX if none
+} dht11_frame_timing_t;
+
+/**
+ * @brief Pulse classification limits, all in microseconds
+ */
+typedef struct {
+    uint16_t glitch_max_us;        // Pulses this short are merged into their neighbours
+    uint16_t response_min_us;      // Minimum width of the response low and high
+    uint16_t bit_low_max_us;       // Maximum width of the low preceding each bit
+    uint16_t bit_high_max_us;      // Maximum width of a '1' high
+    uint16_t bit_threshold_us;     // High widths above this decode as '1'
+    uint16_t bit_margin_us;        // Highs within +/- margin of the threshold are rejected
+} dht11_decoder_config_t;
+
+#define DHT11_DECODER_DEFAULT_CONFIG() { \
+    .glitch_max_us = 2,                  \
+    .response_min_us = 60,               \
+    .bit_low_max_us = 90,                \
+    .bit_high_max_us = 100,              \
+    .bit_threshold_us = 48,              \
+    .bit_margin_us = 6,                  \
+}
+
+/**
+ * @brief Decode a captured pulse train into the 5 raw DHT11 bytes
+ *
+ * Pure function with no hardware access, usable on the linux target.
+ *
+ * @param pulses Captured pulses in line order, starting anywhere before the response
+ * @param count Number of pulses
+ * @param config Classification limits, NULL for defaults
+ * @param data Output bytes: humidity int/dec, temperature int/dec, checksum
+ * @param timing Optional measured widths, filled as far as decoding got; may be NULL
+ * @return dht11_decode_result_t DHT11_DECODE_OK on success
+ */
+dht11_decode_result_t dht11_decode_frame(const dht11_pulse_t *pulses, size_t count,
+                                         const dht11_decoder_config_t *config, uint8_t data[5],
+                                         dht11_frame_timing_t *timing);
+
+/**
+ * @brief Decode a captured pulse train into a reading
+ *
+ * Fills temperature, humidity and valid; the timestamp is left to the caller.
+ *
+ * @param pulses Captured pulses in line order
+ * @param count Number of pulses
+ * @param config Classification limits, NULL for defaults
+ * @param reading Output reading
+ * @param timing Optional measured widths, may be NULL
+ * @return dht11_decode_result_t DHT11_DECODE_OK on success
+ */
+dht11_decode_result_t dht11_decode_reading(const dht11_pulse_t *pulses, size_t count,
+                                           const dht11_decoder_config_t *config,
+                                           dht11_reading_t *reading,
+                                           dht11_frame_timing_t *timing);
+
+/**
+ * @brief Decode a captured pulse train into a fixed-point sample
+ *
+ * Converts the integer/decimal frame bytes straight to centi-units.
+ * Fills temperature, humidity (raw and filtered) and the valid flag;
+ * the timestamp is left to the caller.
+ *
+ * @param pulses Captured pulses in line order
+ * @param count Number of pulses
+ * @param config Classification limits, NULL for defaults
+ * @param sample Output sample
+ * @param timing Optional measured widths, may be NULL
+ * @return dht11_decode_result_t DHT11_DECODE_OK on success
+ */
+dht11_decode_result_t dht11_decode_sample(const dht11_pulse_t *pulses, size_t count,
+                                          const dht11_decoder_config_t *config,
+                                          sensor_sample_t *sample,
+                                          dht11_frame_timing_t *timing);
+
+/**
+ * @brief Get decode result name string
+ */
+const char *dht11_decode_result_name(dht11_decode_result_t result);
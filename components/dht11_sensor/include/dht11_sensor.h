@@ -3,17 +3,70 @@
 #include "esp_err.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include "sensor_driver.h"
+#include "sensor_filter.h"
 
 // DHT11 data structure
+typedef sensor_reading_t dht11_reading_t;
+
+// Sampling cadence statistics for one probe
+typedef sensor_cadence_stats_t dht11_cadence_stats_t;
+
+// Acquisition latency and pulse-width histograms for one probe
+typedef sensor_timing_stats_t dht11_timing_stats_t;
+
+// Runtime settings of the reading task, applied at the next sample boundary
+typedef struct {
+    uint32_t read_interval_ms; // Interval between reads of each probe, the ceiling when adaptive
+    bool enabled;              // Reading task samples only while enabled
+    bool adaptive;             // Read at the 2 s floor while readings change, back off while stable
+} dht11_runtime_config_t;
+
+#define DHT11_MAX_SENSORS        SENSOR_MAX_SOURCES     // Probes served by the shared reading task
+#define DHT11_SOURCE_NAME_LEN    SENSOR_SOURCE_NAME_LEN // Data manager source id, including terminator
+
+// Opaque handle to one DHT11 probe
+typedef struct dht11_sensor *dht11_handle_t;
+
+// DHT11 probe configuration
 typedef struct {
-    float temperature;     // Temperature in Celsius
-    float humidity;        // Humidity percentage
-    uint64_t timestamp;    // Reading timestamp
-    bool valid;           // Data validity flag
-} dht11_reading_t;
+    uint8_t gpio_num;      // GPIO connected to the probe data line
+    const char *source;    // Source id used when publishing to the data manager
+} dht11_config_t;
+
+/**
+ * @brief Create a DHT11 probe and add it to the reading task's schedule
+ * 
+ * @param config Probe configuration
+ * @param ret_handle Returned probe handle
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_new_sensor(const dht11_config_t *config, dht11_handle_t *ret_handle);
 
 /**
- * @brief Initialize DHT11 sensor
+ * @brief Read data from a specific DHT11 probe
+ * 
+ * While the reading task runs, the read is handed to it and the filtered
+ * reading is returned once the probe's 2 s rest time allows a frame.
+ * Otherwise, within the rest time the last reading is returned.
+ * 
+ * @param sensor Probe handle
+ * @param reading Pointer to store sensor reading
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_read_sensor(dht11_handle_t sensor, dht11_reading_t *reading);
+
+/**
+ * @brief Get the last valid reading of a specific DHT11 probe
+ * 
+ * @param sensor Probe handle
+ * @param reading Pointer to store the last reading
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_get_sensor_last_reading(dht11_handle_t sensor, dht11_reading_t *reading);
+
+/**
+ * @brief Initialize the default DHT11 sensor (source "dht11")
  * 
  * @param gpio_num GPIO pin number connected to DHT11
  * @return esp_err_t ESP_OK on success
@@ -21,7 +74,7 @@ typedef struct {
 esp_err_t dht11_init(uint8_t gpio_num);
 
 /**
- * @brief Read data from DHT11 sensor
+ * @brief Read data from the default DHT11 sensor
  * 
  * @param reading Pointer to store sensor reading
  * @return esp_err_t ESP_OK on success
@@ -31,11 +84,56 @@ esp_err_t dht11_read(dht11_reading_t *reading);
 /**
  * @brief Start the DHT11 reading task
  * 
+ * One task serves every probe created so far, staggering their reads
+ * evenly across the interval. With CONFIG_DHT11_ADAPTIVE_INTERVAL the
+ * interval is the ceiling of adaptive sampling.
+ * 
  * @param read_interval_ms Reading interval in milliseconds
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t dht11_start_reading(uint32_t read_interval_ms);
 
+/**
+ * @brief Reconfigure the running DHT11 reading task
+ * 
+ * Stores the config in a slot the task picks up at its next sample
+ * boundary; the task is not restarted and no memory is allocated.
+ * 
+ * @param config New runtime configuration
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_apply_config(const dht11_runtime_config_t *config);
+
+/**
+ * @brief Get the most recently applied runtime configuration
+ * 
+ * @param config Pointer to store the configuration
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_get_config(dht11_runtime_config_t *config);
+
+/**
+ * @brief Select the filter applied to a probe's readings before publishing
+ * 
+ * Raw and filtered values are published side by side. The reading task
+ * switches filters at its next sample of the probe and restarts the
+ * filter history.
+ * 
+ * @param source Probe source id, NULL for every probe
+ * @param config Filter configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no probe matches
+ */
+esp_err_t dht11_set_filter(const char *source, const sensor_filter_config_t *config);
+
+/**
+ * @brief Get the filter selected for a probe
+ * 
+ * @param source Probe source id, NULL for the first probe
+ * @param config Pointer to store the configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no probe matches
+ */
+esp_err_t dht11_get_filter(const char *source, sensor_filter_config_t *config);
+
 /**
  * @brief Stop the DHT11 reading task
  * 
@@ -44,9 +142,40 @@ esp_err_t dht11_start_reading(uint32_t read_interval_ms);
 esp_err_t dht11_stop_reading(void);
 
 /**
- * @brief Get the last valid reading
+ * @brief Get the last valid reading of the default DHT11 sensor
  * 
  * @param reading Pointer to store the last reading
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t dht11_get_last_reading(dht11_reading_t *reading);
+
+/**
+ * @brief Get sampling cadence statistics of a specific DHT11 probe
+ * 
+ * @param sensor Probe handle
+ * @param stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_get_cadence_stats(dht11_handle_t sensor, dht11_cadence_stats_t *stats);
+
+/**
+ * @brief Get acquisition timing histograms of a specific DHT11 probe
+ * 
+ * Response widths and bit margins drifting towards the decoder limits
+ * point at a failing sensor or a marginal cable before reads fail.
+ * 
+ * @param sensor Probe handle
+ * @param stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t dht11_get_timing_stats(dht11_handle_t sensor, dht11_timing_stats_t *stats);
+
+/**
+ * @brief Get the generic sensor driver interface of a DHT11 probe
+ * 
+ * trigger() performs a full read, read() returns the last valid reading.
+ * 
+ * @param sensor Probe handle
+ * @return sensor_driver_t* Driver interface, NULL if the handle is NULL
+ */
+sensor_driver_t *dht11_get_driver(dht11_handle_t sensor);
@@ -0,0 +1,175 @@
+#include "dht11_frames.h"
+
+#define FRAME(name, result, bits, ...) \
+    { #name, name, sizeof(name) / sizeof(name[0]), result, bits, __VA_ARGS__ }
+
+// 24 C / 55 %RH, nominal widths
+static const uint16_t room[] = {
+    30, 80, 82, 53, 29, 54, 29, 53, 70, 54, 73, 49, 24, 54, 70, 48,
+    67, 53, 69, 48, 23, 54, 29, 46, 27, 52, 26, 48, 27, 46, 29, 54,
+    23, 46, 23, 49, 24, 46, 29, 53, 25, 53, 71, 49, 71, 49, 28, 50,
+    26, 46, 28, 47, 26, 50, 26, 54, 29, 47, 28, 50, 25, 49, 27, 50,
+    23, 47, 27, 47, 26, 47, 73, 50, 26, 47, 23, 46, 68, 49, 67, 53,
+    70, 52, 70, 50
+};
+
+// 23.7 C / 41 %RH, temperature decimal byte set
+static const uint16_t decimals[] = {
+    30, 80, 82, 49, 29, 50, 25, 47, 69, 51, 23, 52, 73, 47, 24, 49,
+    28, 47, 67, 46, 26, 53, 24, 54, 24, 53, 27, 49, 28, 48, 26, 52,
+    23, 52, 26, 49, 23, 50, 29, 50, 23, 49, 68, 52, 29, 47, 67, 48,
+    68, 53, 69, 46, 29, 51, 29, 50, 26, 47, 23, 47, 24, 49, 67, 51,
+    69, 53, 68, 53, 29, 48, 73, 52, 24, 48, 25, 49, 29, 49, 72, 49,
+    68, 54, 68, 55
+};
+
+// 2.3 C / 95 %RH
+static const uint16_t cold_humid[] = {
+    30, 80, 82, 52, 26, 47, 70, 46, 23, 47, 67, 54, 69, 49, 72, 52,
+    69, 52, 73, 53, 25, 54, 24, 47, 24, 49, 26, 54, 28, 47, 25, 49,
+    24, 46, 23, 50, 26, 53, 24, 46, 23, 48, 25, 51, 27, 48, 23, 51,
+    68, 53, 25, 54, 27, 48, 27, 46, 23, 53, 25, 50, 23, 46, 27, 47,
+    70, 47, 72, 50, 25, 48, 67, 47, 70, 54, 25, 46, 28, 48, 73, 51,
+    25, 47, 28, 53
+};
+
+// Long lows and highs, warm sensor on a long cable
+static const uint16_t slow_sensor[] = {
+    30, 88, 90, 55, 32, 55, 32, 59, 29, 59, 77, 58, 33, 55, 78, 55,
+    29, 55, 29, 57, 32, 57, 32, 59, 32, 58, 32, 59, 29, 59, 33, 55,
+    31, 59, 29, 58, 29, 56, 29, 58, 78, 58, 76, 55, 31, 57, 30, 59,
+    30, 59, 75, 57, 32, 58, 30, 57, 32, 57, 30, 58, 75, 56, 32, 56,
+    33, 57, 75, 56, 30, 58, 76, 55, 29, 57, 30, 55, 77, 58, 76, 56,
+    77, 58, 33, 53
+};
+
+// Short lows and highs
+static const uint16_t fast_sensor[] = {
+    30, 74, 76, 45, 24, 46, 22, 43, 62, 45, 66, 43, 64, 47, 64, 45,
+    66, 43, 63, 46, 23, 44, 20, 45, 21, 44, 20, 43, 23, 43, 24, 45,
+    20, 44, 21, 46, 22, 44, 20, 46, 24, 43, 63, 44, 22, 45, 24, 47,
+    66, 47, 21, 46, 21, 43, 23, 46, 21, 46, 23, 44, 20, 46, 24, 47,
+    24, 45, 65, 45, 21, 43, 62, 44, 21, 46, 62, 45, 24, 45, 22, 43,
+    64, 47, 20, 50
+};
+
+// Every high 7 us from the threshold, just outside the margin
+static const uint16_t margin_pass[] = {
+    30, 80, 82, 53, 41, 54, 41, 50, 55, 46, 41, 47, 41, 46, 41, 54,
+    41, 48, 55, 48, 41, 53, 41, 49, 41, 54, 41, 54, 41, 54, 41, 50,
+    41, 49, 41, 48, 41, 53, 41, 52, 41, 54, 55, 52, 41, 54, 55, 54,
+    41, 54, 55, 53, 41, 48, 41, 54, 41, 52, 41, 50, 41, 53, 55, 48,
+    41, 52, 55, 54, 41, 47, 41, 52, 55, 50, 55, 46, 55, 49, 41, 49,
+    55, 50, 55, 55
+};
+
+// 1 us spike in a bit low and 2 us dip in a bit high, merged
+static const uint16_t glitch_merged[] = {
+    30, 80, 82, 51, 24, 53, 23, 53, 72, 47, 73, 54, 27, 30, 1, 19,
+    28, 49, 28, 54, 26, 46, 26, 52, 29, 54, 27, 48, 27, 49, 14, 2,
+    13, 54, 28, 49, 27, 49, 29, 54, 27, 48, 24, 51, 24, 51, 71, 51,
+    24, 49, 73, 49, 67, 48, 24, 48, 28, 47, 25, 52, 23, 52, 29, 52,
+    27, 48, 68, 52, 28, 46, 23, 49, 27, 51, 73, 51, 23, 54, 28, 51,
+    71, 49, 29, 47, 70, 47, 23, 50
+};
+
+// 3 us spike splits the response low, no 60 us low left
+static const uint16_t glitch_split_response[] = {
+    30, 40, 3, 37, 82, 54, 27, 54, 27, 53, 68, 49, 68, 47, 24, 48,
+    29, 48, 25, 47, 27, 46, 24, 53, 23, 47, 25, 52, 26, 52, 27, 51,
+    26, 49, 27, 51, 23, 46, 29, 49, 24, 52, 26, 51, 72, 51, 26, 49,
+    71, 48, 67, 54, 29, 46, 25, 47, 29, 52, 27, 49, 27, 51, 29, 50,
+    69, 47, 28, 48, 29, 52, 24, 51, 71, 51, 29, 52, 29, 48, 70, 49,
+    28, 48, 67, 51, 25, 53
+};
+
+// Bit 9 high at 44 us, 4 us from the threshold
+static const uint16_t margin_ambiguous[] = {
+    30, 80, 82, 47, 23, 51, 28, 46, 68, 50, 72, 50, 25, 49, 72, 52,
+    27, 48, 27, 47, 26, 54, 44, 49, 28, 47, 29, 52, 27, 46, 23, 47,
+    28, 49, 25, 53, 26, 54, 23, 49, 28, 52, 67, 47, 69, 50, 25, 51,
+    27, 54, 71, 52, 27, 47, 28, 53, 29, 47, 27, 46, 26, 48, 26, 53,
+    24, 53, 27, 46, 26, 53, 70, 50, 27, 52, 27, 50, 69, 54, 69, 53,
+    28, 50, 71, 52
+};
+
+// Bit 30 high at 54 us, exactly on the margin
+static const uint16_t margin_edge[] = {
+    30, 80, 82, 50, 23, 46, 29, 49, 71, 46, 72, 48, 26, 52, 67, 51,
+    28, 52, 23, 51, 23, 49, 26, 53, 25, 49, 23, 54, 23, 53, 24, 49,
+    27, 47, 23, 52, 26, 47, 24, 46, 25, 54, 68, 47, 69, 53, 24, 52,
+    26, 50, 72, 52, 25, 54, 29, 48, 25, 48, 24, 53, 23, 54, 25, 54,
+    54, 51, 25, 50, 27, 49, 72, 50, 29, 49, 24, 49, 71, 49, 72, 46,
+    28, 46, 67, 52
+};
+
+// Last checksum bit flipped
+static const uint16_t checksum[] = {
+    30, 80, 82, 50, 26, 46, 27, 46, 67, 49, 71, 50, 67, 47, 72, 48,
+    27, 49, 28, 51, 26, 53, 25, 49, 25, 51, 26, 48, 29, 47, 29, 47,
+    26, 49, 26, 52, 28, 50, 26, 48, 25, 48, 72, 51, 69, 54, 29, 48,
+    70, 51, 27, 47, 26, 51, 23, 54, 23, 52, 27, 53, 29, 53, 25, 46,
+    23, 50, 24, 47, 28, 50, 70, 51, 25, 48, 68, 51, 28, 51, 69, 47,
+    69, 53, 70, 54
+};
+
+// Capture ends after 30 bits
+static const uint16_t truncated[] = {
+    30, 80, 82, 50, 26, 54, 29, 50, 70, 51, 68, 52, 72, 54, 68, 47,
+    25, 51, 23, 51, 28, 52, 27, 52, 29, 49, 28, 51, 29, 52, 27, 48,
+    29, 48, 24, 47, 29, 53, 29, 50, 29, 46, 68, 54, 67, 54, 24, 50,
+    67, 52, 23, 54, 25, 54, 23, 51, 23, 50, 28, 47, 25, 47, 23
+};
+
+// Bit 17 low held for 120 us
+static const uint16_t bad_low[] = {
+    30, 80, 82, 46, 26, 51, 29, 46, 73, 52, 73, 47, 70, 54, 72, 46,
+    27, 51, 28, 46, 29, 47, 26, 52, 24, 49, 28, 48, 28, 52, 28, 48,
+    25, 49, 26, 52, 27, 120, 25, 46, 26, 50, 72, 47, 69, 48, 29, 48,
+    67, 53, 23, 53, 29, 46, 25, 47, 24, 48, 25, 49, 27, 49, 27, 53,
+    27, 54, 24, 53, 24, 50, 70, 48, 29, 50, 72, 54, 29, 54, 70, 50,
+    70, 52, 25, 55
+};
+
+// Response high only 40 us
+static const uint16_t short_response[] = {
+    30, 80, 40, 54, 29, 47, 26, 49, 70, 46, 68, 48, 73, 52, 71, 54,
+    29, 50, 29, 46, 28, 49, 23, 53, 25, 53, 29, 49, 28, 52, 27, 48,
+    26, 48, 29, 51, 24, 50, 29, 54, 24, 50, 71, 54, 67, 48, 27, 48,
+    67, 49, 29, 48, 29, 48, 23, 51, 25, 54, 23, 53, 28, 53, 23, 54,
+    29, 54, 25, 46, 29, 49, 70, 49, 28, 47, 73, 53, 24, 46, 71, 52,
+    71, 53, 24, 56
+};
+
+// Host release with no sensor answer
+static const uint16_t no_response[] = {
+    30, 12, 5, 3
+};
+
+const dht11_test_frame_t dht11_test_frames[] = {
+    FRAME(room, DHT11_DECODE_OK, 40, { 0x37, 0x00, 0x18, 0x00, 0x4F }),
+    FRAME(decimals, DHT11_DECODE_OK, 40, { 0x29, 0x00, 0x17, 0x07, 0x47 }),
+    FRAME(cold_humid, DHT11_DECODE_OK, 40, { 0x5F, 0x00, 0x02, 0x03, 0x64 }),
+    FRAME(slow_sensor, DHT11_DECODE_OK, 40, { 0x14, 0x00, 0x31, 0x09, 0x4E }),
+    FRAME(fast_sensor, DHT11_DECODE_OK, 40, { 0x3F, 0x00, 0x12, 0x01, 0x52 }),
+    FRAME(margin_pass, DHT11_DECODE_OK, 40, { 0x21, 0x00, 0x15, 0x05, 0x3B }),
+    FRAME(glitch_merged, DHT11_DECODE_OK, 40, { 0x30, 0x00, 0x16, 0x04, 0x4A }),
+    FRAME(glitch_split_response, DHT11_DECODE_NO_RESPONSE, 0, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+    FRAME(margin_ambiguous, DHT11_DECODE_AMBIGUOUS_BIT, 10, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+    FRAME(margin_edge, DHT11_DECODE_AMBIGUOUS_BIT, 31, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+    FRAME(checksum, DHT11_DECODE_CHECKSUM, 40, { 0x3C, 0x00, 0x1A, 0x00, 0x57 }),
+    FRAME(truncated, DHT11_DECODE_TRUNCATED, 30, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+    FRAME(bad_low, DHT11_DECODE_BAD_PULSE, 17, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+    FRAME(short_response, DHT11_DECODE_NO_RESPONSE, 0, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+    FRAME(no_response, DHT11_DECODE_NO_RESPONSE, 0, { 0x00, 0x00, 0x00, 0x00, 0x00 }),
+};
+
+const size_t dht11_test_frame_count = sizeof(dht11_test_frames) / sizeof(dht11_test_frames[0]);
+
+size_t dht11_test_frame_pulses(const dht11_test_frame_t *frame, dht11_pulse_t *pulses) {
+    for (size_t i = 0; i < frame->count; i++) {
+        pulses[i].duration_us = frame->widths[i];
+        pulses[i].level = (i % 2 == 0) ? 1 : 0;
+    }
+    return frame->count;
+}
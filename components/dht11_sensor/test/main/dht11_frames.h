@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dht11_decoder.h"
+
+/*
+ * Pulse trains as the capture backends hand them to the decoder: 1 us
+ * ticks, levels alternating and starting with the host release high.
+ * Widths carry per-pulse jitter around the datasheet timing; the glitch
+ * and margin frames place single pulses on the decoder's limits.
+ */
+typedef struct {
+    const char *name;
+    const uint16_t *widths;
+    size_t count;
+    dht11_decode_result_t result;
+    uint8_t bits;               // Bits classified before the result, as in dht11_frame_timing_t
+    uint8_t data[5];            // Decoded bytes for OK and CHECKSUM frames
+} dht11_test_frame_t;
+
+extern const dht11_test_frame_t dht11_test_frames[];
+extern const size_t dht11_test_frame_count;
+
+/**
+ * @brief Expand a corpus frame into decoder pulses
+ *
+ * @param frame Corpus frame
+ * @param pulses Output, at least frame->count entries
+ * @return size_t Number of pulses written
+ */
+size_t dht11_test_frame_pulses(const dht11_test_frame_t *frame, dht11_pulse_t *pulses);
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "dht11_decoder.h"
+#include "dht11_frames.h"
+
+#define MAX_PULSES          128
+#define BENCH_ROUNDS        20000
+
+static const dht11_test_frame_t *find_frame(const char *name) {
+    for (size_t i = 0; i < dht11_test_frame_count; i++) {
+        if (strcmp(dht11_test_frames[i].name, name) == 0) {
+            return &dht11_test_frames[i];
+        }
+    }
+    TEST_FAIL_MESSAGE(name);
+    return NULL;
+}
+
+TEST_CASE("corpus frames decode to their expected result", "[dht11_decoder]") {
+    dht11_pulse_t pulses[MAX_PULSES];
+    uint8_t data[5];
+    dht11_frame_timing_t timing;
+
+    for (size_t i = 0; i < dht11_test_frame_count; i++) {
+        const dht11_test_frame_t *frame = &dht11_test_frames[i];
+        size_t count = dht11_test_frame_pulses(frame, pulses);
+
+        dht11_decode_result_t result = dht11_decode_frame(pulses, count, NULL, data, &timing);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(frame->result, result, frame->name);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(frame->bits, timing.bits, frame->name);
+        if (result == DHT11_DECODE_OK || result == DHT11_DECODE_CHECKSUM) {
+            TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(frame->data, data, 5, frame->name);
+        }
+    }
+}
+
+TEST_CASE("timing records the response and the closest bit", "[dht11_decoder]") {
+    dht11_pulse_t pulses[MAX_PULSES];
+    uint8_t data[5];
+    dht11_frame_timing_t timing;
+
+    const dht11_test_frame_t *frame = find_frame("margin_pass");
+    size_t count = dht11_test_frame_pulses(frame, pulses);
+    TEST_ASSERT_EQUAL(DHT11_DECODE_OK, dht11_decode_frame(pulses, count, NULL, data, &timing));
+    TEST_ASSERT_EQUAL_UINT16(80, timing.response_low_us);
+    TEST_ASSERT_EQUAL_UINT16(82, timing.response_high_us);
+    TEST_ASSERT_EQUAL_UINT8(7, timing.min_bit_margin_us);
+
+    frame = find_frame("margin_ambiguous");
+    count = dht11_test_frame_pulses(frame, pulses);
+    TEST_ASSERT_EQUAL(DHT11_DECODE_AMBIGUOUS_BIT, dht11_decode_frame(pulses, count, NULL, data, &timing));
+    TEST_ASSERT_EQUAL_UINT8(4, timing.bit_margin_us[9]);
+    TEST_ASSERT_EQUAL_UINT8(4, timing.min_bit_margin_us);
+}
+
+TEST_CASE("glitch and margin limits follow the config", "[dht11_decoder]") {
+    dht11_pulse_t pulses[MAX_PULSES];
+    uint8_t data[5];
+    dht11_decoder_config_t config = DHT11_DECODER_DEFAULT_CONFIG();
+
+    // Without merging, the 1 us spike splits a bit low and shifts every later pulse
+    const dht11_test_frame_t *frame = find_frame("glitch_merged");
+    size_t count = dht11_test_frame_pulses(frame, pulses);
+    config.glitch_max_us = 0;
+    TEST_ASSERT_NOT_EQUAL(DHT11_DECODE_OK, dht11_decode_frame(pulses, count, &config, data, NULL));
+
+    // A wider glitch limit puts the split response back together
+    frame = find_frame("glitch_split_response");
+    count = dht11_test_frame_pulses(frame, pulses);
+    config.glitch_max_us = 3;
+    TEST_ASSERT_EQUAL(DHT11_DECODE_OK, dht11_decode_frame(pulses, count, &config, data, NULL));
+
+    // With no margin, the 44 us high of a '0' falls on the right side of the threshold
+    frame = find_frame("margin_ambiguous");
+    count = dht11_test_frame_pulses(frame, pulses);
+    config = (dht11_decoder_config_t)DHT11_DECODER_DEFAULT_CONFIG();
+    config.bit_margin_us = 0;
+    TEST_ASSERT_EQUAL(DHT11_DECODE_OK, dht11_decode_frame(pulses, count, &config, data, NULL));
+    TEST_ASSERT_EQUAL_UINT8(52, data[0]);
+
+    // A wider margin rejects the frame whose highs sit 7 us out
+    frame = find_frame("margin_pass");
+    count = dht11_test_frame_pulses(frame, pulses);
+    config.bit_margin_us = 7;
+    TEST_ASSERT_EQUAL(DHT11_DECODE_AMBIGUOUS_BIT, dht11_decode_frame(pulses, count, &config, data, NULL));
+}
+
+TEST_CASE("sample and reading conversions", "[dht11_decoder]") {
+    dht11_pulse_t pulses[MAX_PULSES];
+    const dht11_test_frame_t *frame = find_frame("decimals");
+    size_t count = dht11_test_frame_pulses(frame, pulses);
+
+    sensor_sample_t sample;
+    TEST_ASSERT_EQUAL(DHT11_DECODE_OK, dht11_decode_sample(pulses, count, NULL, &sample, NULL));
+    TEST_ASSERT_EQUAL_INT16(2370, sample.temperature);
+    TEST_ASSERT_EQUAL_INT16(4100, sample.humidity);
+    TEST_ASSERT_EQUAL_INT16(2370, sample.temperature_filtered);
+    TEST_ASSERT_EQUAL_INT16(4100, sample.humidity_filtered);
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_SAMPLE_VALID, sample.flags);
+
+    dht11_reading_t reading;
+    TEST_ASSERT_EQUAL(DHT11_DECODE_OK, dht11_decode_reading(pulses, count, NULL, &reading, NULL));
+    TEST_ASSERT_TRUE(reading.valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.7f, reading.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 41.0f, reading.humidity);
+
+    frame = find_frame("checksum");
+    count = dht11_test_frame_pulses(frame, pulses);
+    TEST_ASSERT_EQUAL(DHT11_DECODE_CHECKSUM, dht11_decode_sample(pulses, count, NULL, &sample, NULL));
+    TEST_ASSERT_EQUAL_UINT8(0, sample.flags);
+    TEST_ASSERT_EQUAL(DHT11_DECODE_CHECKSUM, dht11_decode_reading(pulses, count, NULL, &reading, NULL));
+    TEST_ASSERT_FALSE(reading.valid);
+}
+
+TEST_CASE("empty capture has no response", "[dht11_decoder]") {
+    uint8_t data[5];
+    TEST_ASSERT_EQUAL(DHT11_DECODE_NO_RESPONSE, dht11_decode_frame(NULL, 0, NULL, data, NULL));
+    TEST_ASSERT_EQUAL_STRING("NO_RESPONSE", dht11_decode_result_name(DHT11_DECODE_NO_RESPONSE));
+    TEST_ASSERT_EQUAL_STRING("UNKNOWN", dht11_decode_result_name((dht11_decode_result_t)99));
+}
+
+TEST_CASE("decode time per frame", "[dht11_decoder][bench]") {
+    static dht11_pulse_t pulses[16][MAX_PULSES];
+    size_t counts[16];
+    size_t frames = 0;
+    for (size_t i = 0; i < dht11_test_frame_count && frames < 16; i++) {
+        if (dht11_test_frames[i].result == DHT11_DECODE_OK) {
+            counts[frames] = dht11_test_frame_pulses(&dht11_test_frames[i], pulses[frames]);
+            frames++;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0, frames);
+
+    uint8_t data[5];
+    unsigned checksum = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t f = 0; f < frames; f++) {
+            checksum += dht11_decode_frame(pulses[f], counts[f], NULL, data, NULL);
+            checksum += data[4];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("dht11_decode_frame: %.1f ns/frame over %d frames (checksum %u)\n",
+           ns / ((double)BENCH_ROUNDS * frames), BENCH_ROUNDS * (int)frames, checksum);
+}
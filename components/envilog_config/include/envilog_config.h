@@ -27,4 +27,25 @@
 // MQTT queue configuration
 #define ENVILOG_MQTT_OUTBOX_SIZE       CONFIG_ENVILOG_MQTT_OUTBOX_SIZE
 #define ENVILOG_MQTT_TIMEOUT_MS        CONFIG_ENVILOG_MQTT_TIMEOUT_MS
-#define ENVILOG_MQTT_RETRY_TIMEOUT_MS  CONFIG_ENVILOG_MQTT_RETRY_TIMEOUT_MS
+#define ENVILOG_MQTT_RETRY_TIMEOUT_MS  CONFIG_ENVILOG_MQTT_RETRY_TIMEOUT_MS   // Reconnect attempt timeout
+
+// Reconnect backoff, attempt n waits up to min(max, base * 2^n)
+#define ENVILOG_MQTT_BACKOFF_BASE_MS   CONFIG_ENVILOG_MQTT_BACKOFF_BASE_MS
+#define ENVILOG_MQTT_BACKOFF_MAX_MS    CONFIG_ENVILOG_MQTT_BACKOFF_MAX_MS
+
+// MQTT 5 and sample delivery
+#define ENVILOG_MQTT_SAMPLE_QOS        CONFIG_ENVILOG_MQTT_SAMPLE_QOS
+#if CONFIG_ENVILOG_MQTT_PROTOCOL_5
+#define ENVILOG_MQTT_MESSAGE_EXPIRY_S  CONFIG_ENVILOG_MQTT_MESSAGE_EXPIRY_S
+#else
+#define ENVILOG_MQTT_MESSAGE_EXPIRY_S  0
+#endif
+
+// MQTT sample batching, a batch closes on whichever limit is reached first
+#define ENVILOG_MQTT_BATCH_SAMPLES     CONFIG_ENVILOG_MQTT_BATCH_SAMPLES
+#define ENVILOG_MQTT_BATCH_BYTES       CONFIG_ENVILOG_MQTT_BATCH_BYTES
+#define ENVILOG_MQTT_BATCH_LATENCY_MS  CONFIG_ENVILOG_MQTT_BATCH_LATENCY_MS
+
+// Store-and-forward drain after an outage
+#define ENVILOG_MQTT_FORWARD_RATE      CONFIG_ENVILOG_MQTT_FORWARD_RATE
+#define ENVILOG_MQTT_FORWARD_BYTES     CONFIG_ENVILOG_MQTT_FORWARD_BYTES
@@ -1,6 +1,14 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "freertos/semphr.h"
 #include "mqtt_client.h"
 #include "envilog_mqtt.h"
 #include "network_manager.h"
@@ -9,15 +17,148 @@
 #include "task_manager.h"
 #include "cJSON.h"
 #include "dht11_sensor.h"
+#include "sensor_filter.h"
 #include "error_handler.h"
 #include "data_manager.h"
+#include "mqtt_payload.h"
+#include "mqtt_forward.h"
+#include "mqtt_publish.h"
+#include "mqtt_batch.h"
+#include "mqtt_reconnect.h"
 
 static const char *TAG = "envilog_mqtt";
 
 static EventGroupHandle_t mqtt_event_group = NULL;
 static esp_mqtt_client_handle_t mqtt_client = NULL;
-static bool immediate_retry = true;
-static int retry_count = 0;
+static volatile size_t announced_sources = 0;   // Sources in the last retained source list
+static volatile uint8_t sample_format = MQTT_PAYLOAD_JSON;  // mqtt_payload_format_t per data topic
+static volatile uint8_t rollup_format = MQTT_PAYLOAD_JSON;
+
+#define BATCHING_ENABLED    (ENVILOG_MQTT_BATCH_SAMPLES > 1)
+#if CONFIG_ENVILOG_MQTT_PROTOCOL_5
+#define PROTOCOL_5_ENABLED  true
+#else
+#define PROTOCOL_5_ENABLED  false
+#endif
+#define SAMPLE_JSON_MAX     160     // One sample object with filtered values
+
+static SemaphoreHandle_t batch_mutex = NULL;    // Serializes the mqtt_batch calls
+static TaskHandle_t batch_task_handle = NULL;
+
+// Notification bits of the reconnect task, which drives mqtt_reconnect.c
+#define RECONNECT_EVT_LINK          BIT0    // Link went up or down, see link_up
+#define RECONNECT_EVT_SESSION       BIT1    // MQTT connected or disconnected
+#define RECONNECT_EVT_RECONFIGURE   BIT2    // Saved MQTT config changed, recreate the client
+#define RECONNECT_EVT_ARCHIVE       BIT3    // Archive of archive_source requested
+#define RECONNECT_EVT_FALLBACK      BIT4    // Broker refused MQTT 5
+
+// Unsupported Protocol Version reason code of an MQTT 5 CONNACK
+#define MQTT5_REASON_UNSUPPORTED_PROTOCOL   0x84
+
+static TaskHandle_t reconnect_task_handle = NULL;
+static volatile bool link_up = false;
+static uint32_t attempt_timeout_ms = ENVILOG_MQTT_RETRY_TIMEOUT_MS;
+static portMUX_TYPE reconnect_lock = portMUX_INITIALIZER_UNLOCKED;
+static char archive_source[SENSOR_SOURCE_NAME_LEN];  // Under reconnect_lock
+static bool use_v5 = PROTOCOL_5_ENABLED;              // Cleared when the broker refuses MQTT 5, reconnect task only
+static uint32_t client_generation = 0;                  // Bumped by create_client(), under reconnect_lock
+static uint32_t refused_generation = UINT32_MAX;        // Client that was refused MQTT 5, under reconnect_lock
+
+// Parse {"source": "dht11", "type": "median", "window": 5, "alpha": 0.3, "q": 0.01, "r": 1.0}
+static void handle_filter_config(const cJSON *filter) {
+    cJSON *source = cJSON_GetObjectItem(filter, "source");
+    const char *source_name = (source && cJSON_IsString(source)) ? source->valuestring : NULL;
+
+    sensor_filter_config_t filter_cfg;
+    if (dht11_get_filter(source_name, &filter_cfg) != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NOT_FOUND, ERROR_CAT_VALIDATION,
+            "Unknown filter source: %s", source_name ? source_name : "(all)");
+        return;
+    }
+
+    cJSON *type = cJSON_GetObjectItem(filter, "type");
+    if (type && cJSON_IsString(type) &&
+        sensor_filter_type_from_name(type->valuestring, &filter_cfg.type) != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION,
+            "Invalid filter type: %s", type->valuestring);
+        return;
+    }
+
+    cJSON *item = cJSON_GetObjectItem(filter, "window");
+    if (item && cJSON_IsNumber(item)) {
+        filter_cfg.median_window = (uint8_t)item->valueint;
+    }
+    item = cJSON_GetObjectItem(filter, "alpha");
+    if (item && cJSON_IsNumber(item)) {
+        filter_cfg.ewma_alpha = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(filter, "q");
+    if (item && cJSON_IsNumber(item)) {
+        filter_cfg.kalman_q = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(filter, "r");
+    if (item && cJSON_IsNumber(item)) {
+        filter_cfg.kalman_r = (float)item->valuedouble;
+    }
+
+    if (dht11_set_filter(source_name, &filter_cfg) == ESP_OK) {
+        ESP_LOGI(TAG, "Updated filter of %s: %s", source_name ? source_name : "all sources",
+                 sensor_filter_type_name(filter_cfg.type));
+    }
+}
+
+// Publish the compressed archive of a source, one ts_block.h block per message
+static void publish_archive(const char *source) {
+    data_manager_handle_t handle;
+    if (data_manager_find_source(source, &handle) != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NOT_FOUND, ERROR_CAT_VALIDATION,
+            "Unknown archive source: %s", source);
+        return;
+    }
+
+    uint8_t *block = malloc(TS_BLOCK_SIZE);
+    if (block == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "No memory for archive block");
+        return;
+    }
+
+    char topic[ENVILOG_MQTT_TOPIC_MAX_LEN];
+    snprintf(topic, sizeof(topic), "%s/%s", ENVILOG_MQTT_TOPIC_ARCHIVE, source);
+
+    // Blocks go to the outbox as they are copied, never the whole archive at once
+    uint32_t cursor = 0;
+    size_t len = 0;
+    size_t blocks = 0;
+    while (data_manager_read_archive(handle, &cursor, block, &len) == ESP_OK) {
+        if (mqtt_publish(topic, (const char *)block, len, 1, 0, NULL) < 0) {
+            ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
+                "Archive publish of %s stopped after %u blocks", source, blocks);
+            break;
+        }
+        blocks++;
+    }
+    free(block);
+    ESP_LOGI(TAG, "Published %u archive blocks of %s", blocks, source);
+}
+
+static void notify_reconnect(uint32_t events) {
+    if (reconnect_task_handle != NULL) {
+        xTaskNotify(reconnect_task_handle, events, eSetBits);
+    }
+}
+
+// Hand an archive request to the reconnect task; publishing from the event handler could deadlock
+static void request_archive(const char *data, int data_len) {
+    if (data_len <= 0 || data_len >= (int)sizeof(archive_source)) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Invalid archive request");
+        return;
+    }
+    portENTER_CRITICAL(&reconnect_lock);
+    memcpy(archive_source, data, data_len);
+    archive_source[data_len] = '\0';
+    portEXIT_CRITICAL(&reconnect_lock);
+    notify_reconnect(RECONNECT_EVT_ARCHIVE);
+}
 
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                              int32_t event_id, void *event_data)
@@ -27,8 +168,6 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
 
     switch (event->event_id) {
         case MQTT_EVENT_CONNECTED:
-            retry_count = 0;         // Reset counter
-            immediate_retry = true;  // Reset to immediate mode
             ESP_LOGI(TAG, "MQTT Connected - queued messages will be sent");
             
             // Subscribe to status topic
@@ -38,25 +177,45 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             // Subscribe to sensor configuration topic
             msg_id = esp_mqtt_client_subscribe(event->client, ENVILOG_MQTT_TOPIC_SENSOR_CONFIG, 1);
             ESP_LOGI(TAG, "Subscribed to sensor config, msg_id=%d", msg_id);
+
+            msg_id = esp_mqtt_client_subscribe(event->client, ENVILOG_MQTT_TOPIC_ARCHIVE_REQUEST, 1);
+            ESP_LOGI(TAG, "Subscribed to archive requests, msg_id=%d", msg_id);
             
+            // Re-announce the source list with the next sample
+            announced_sources = 0;
+            mqtt_publish_session_start();
+
             xEventGroupSetBits(mqtt_event_group, ENVILOG_MQTT_CONNECTED_BIT);
             xEventGroupClearBits(mqtt_event_group, ENVILOG_MQTT_DISCONNECTED_BIT);
+
+            // Replay what was stored while the uplink was down
+            mqtt_forward_connected(sample_format);
+            notify_reconnect(RECONNECT_EVT_SESSION);
             break;
 
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "MQTT Disconnected - messages will be queued");
             xEventGroupSetBits(mqtt_event_group, ENVILOG_MQTT_DISCONNECTED_BIT);
             xEventGroupClearBits(mqtt_event_group, ENVILOG_MQTT_CONNECTED_BIT);
+            mqtt_forward_disconnected();
+            notify_reconnect(RECONNECT_EVT_SESSION);
             break;
 
         case MQTT_EVENT_PUBLISHED:
             ESP_LOGI(TAG, "Message published successfully, msg_id=%d", event->msg_id);
+            mqtt_forward_published(event->msg_id);
             break;
 
         case MQTT_EVENT_DATA:
             ESP_LOGI(TAG, "Received data on topic: %.*s", event->topic_len, event->topic);
             ESP_LOGI(TAG, "Data: %.*s", event->data_len, event->data);
             
+            if (event->topic_len == strlen(ENVILOG_MQTT_TOPIC_ARCHIVE_REQUEST) &&
+                strncmp(event->topic, ENVILOG_MQTT_TOPIC_ARCHIVE_REQUEST, event->topic_len) == 0) {
+                request_archive(event->data, event->data_len);
+                break;
+            }
+
             // Check if this is a sensor config message
             if (strncmp(event->topic, ENVILOG_MQTT_TOPIC_SENSOR_CONFIG, event->topic_len) == 0) {
                 ESP_LOGI(TAG, "Received sensor config update");
@@ -65,20 +224,44 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                 if (data_str) {
                     cJSON *root = cJSON_Parse(data_str);
                     if (root) {
+                        dht11_runtime_config_t sensor_cfg;
+                        dht11_get_config(&sensor_cfg);
+                        bool valid = true;
+
                         cJSON *interval = cJSON_GetObjectItem(root, "read_interval");
                         if (interval && cJSON_IsNumber(interval)) {
                             uint32_t new_interval = (uint32_t)interval->valuedouble;
                             if (new_interval >= 2000 && new_interval <= 300000) {
-                                // Stop current readings
-                                dht11_stop_reading();
-                                // Start with new interval
-                                dht11_start_reading(new_interval);
-                                ESP_LOGI(TAG, "Updated sensor read interval to %lu ms", new_interval);
+                                sensor_cfg.read_interval_ms = new_interval;
                             } else {
+                                valid = false;
                                 ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION,
                                     "Invalid interval value: %lu (must be between 2000-300000)", new_interval);
                             }
                         }
+
+                        cJSON *enabled = cJSON_GetObjectItem(root, "enabled");
+                        if (enabled && cJSON_IsBool(enabled)) {
+                            sensor_cfg.enabled = cJSON_IsTrue(enabled);
+                        }
+
+                        // read_interval becomes the ceiling of the adaptive rate
+                        cJSON *adaptive = cJSON_GetObjectItem(root, "adaptive");
+                        if (adaptive && cJSON_IsBool(adaptive)) {
+                            sensor_cfg.adaptive = cJSON_IsTrue(adaptive);
+                        }
+
+                        cJSON *filter = cJSON_GetObjectItem(root, "filter");
+                        if (valid && filter && cJSON_IsObject(filter)) {
+                            handle_filter_config(filter);
+                        }
+
+                        // Applied by the sensor task at its next sample boundary
+                        if (valid && dht11_apply_config(&sensor_cfg) == ESP_OK) {
+                            ESP_LOGI(TAG, "Updated sensor config: interval %lu ms%s, %s", sensor_cfg.read_interval_ms,
+                                     sensor_cfg.adaptive ? " (adaptive ceiling)" : "",
+                                     sensor_cfg.enabled ? "enabled" : "disabled");
+                        }
                         cJSON_Delete(root);
                     } else {
                         ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION,
@@ -98,6 +281,16 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                         ERROR_CAT_COMMUNICATION, "Last error code reported from esp-tls");
                }
            }
+           // A 3.1.1 broker answers an MQTT 5 CONNECT with its own refusal code
+           // The reconnect task decides, it may have replaced this client already
+           if (event->error_handle->error_type == MQTT_ERROR_TYPE_CONNECTION_REFUSED &&
+               (event->error_handle->connect_return_code == MQTT_CONNECTION_REFUSE_PROTOCOL ||
+                event->error_handle->connect_return_code == MQTT5_REASON_UNSUPPORTED_PROTOCOL)) {
+               portENTER_CRITICAL(&reconnect_lock);
+               refused_generation = (uint32_t)(uintptr_t)handler_args;
+               portEXIT_CRITICAL(&reconnect_lock);
+               notify_reconnect(RECONNECT_EVT_FALLBACK);
+           }
            xEventGroupSetBits(mqtt_event_group, ENVILOG_MQTT_ERROR_BIT);
            break;
 
@@ -107,60 +300,345 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
     }
 }
 
+// Link events from the default loop; the flag keeps the latest state if events coalesce
+static void link_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data) {
+    link_up = (base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP);
+    notify_reconnect(RECONNECT_EVT_LINK);
+}
+
+// FNV-1a over the station MAC, so devices of a fleet draw different delays
+static uint32_t jitter_seed(void) {
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    uint32_t seed = 2166136261u;
+    for (size_t i = 0; i < sizeof(mac); i++) {
+        seed = (seed ^ mac[i]) * 16777619u;
+    }
+    return seed;
+}
+
+// The configured attempt timeout, but no shorter than the client's own network timeout
+static uint32_t get_attempt_timeout(const mqtt_config_t *mqtt_cfg) {
+    return (mqtt_cfg->retry_timeout_ms > mqtt_cfg->timeout_ms) ? mqtt_cfg->retry_timeout_ms : mqtt_cfg->timeout_ms;
+}
+
+// Create the client for a configuration; started by mqtt_reconnect_task
+static esp_err_t create_client(const mqtt_config_t *mqtt_cfg) {
+    esp_mqtt_client_config_t esp_mqtt_cfg = {
+        .broker.address.uri = mqtt_cfg->broker_url,
+        .credentials.client_id = mqtt_cfg->client_id,
+        .session.keepalive = mqtt_cfg->keepalive,
+#if CONFIG_ENVILOG_MQTT_PROTOCOL_5
+        .session.protocol_ver = use_v5 ? MQTT_PROTOCOL_V_5 : MQTT_PROTOCOL_V_3_1_1,
+#endif
+        
+        // Timeout settings
+        .network.timeout_ms = mqtt_cfg->timeout_ms,
+        .network.disable_auto_reconnect = true,     // Paced by mqtt_reconnect_task
+
+        // Outbox configuration
+        .outbox.limit = ENVILOG_MQTT_OUTBOX_SIZE * 1024,
+        
+        // Session settings
+        .session.disable_clean_session = false,
+        
+        // Last will message
+        .session.last_will = {
+            .topic = "/envilog/status",
+            .msg = "offline",
+            .qos = 1,
+            .retain = 1
+        }
+    };
+
+    mqtt_client = esp_mqtt_client_init(&esp_mqtt_cfg);
+    if (mqtt_client == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
+            "Failed to initialize MQTT client");
+        return ESP_FAIL;
+    }
+
+    // The handler argument tells events of this client from those of a replaced one
+    portENTER_CRITICAL(&reconnect_lock);
+    uint32_t generation = ++client_generation;
+    portEXIT_CRITICAL(&reconnect_lock);
+    ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID,
+                                                 mqtt_event_handler, (void *)(uintptr_t)generation));
+    mqtt_publish_set_client(mqtt_client, use_v5);
+    mqtt_reconnect_set_client(mqtt_client);
+    return ESP_OK;
+}
+
+static void destroy_client(void) {
+    // Returns once no publish uses the old client
+    mqtt_publish_set_client(NULL, false);
+    mqtt_reconnect_set_client(NULL);
+    esp_mqtt_client_stop(mqtt_client);
+    esp_mqtt_client_destroy(mqtt_client);
+    mqtt_client = NULL;
+}
+
+// Replace the client with one for the saved config and use_v5. Only the reconnect task calls
+// this, so a replacement never overlaps another one or a state machine step.
+static esp_err_t replace_client(void) {
+    mqtt_config_t mqtt_cfg;
+    esp_err_t ret = system_manager_load_mqtt_config(&mqtt_cfg);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_CONFIG, "Failed to load MQTT config");
+        return ret;
+    }
+
+    destroy_client();
+    xEventGroupClearBits(mqtt_event_group, ENVILOG_MQTT_CONNECTED_BIT);
+    mqtt_forward_disconnected();
+    ret = create_client(&mqtt_cfg);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ESP_LOGI(TAG, "MQTT client recreated for %s, MQTT %s", mqtt_cfg.broker_url, use_v5 ? "5" : "3.1.1");
+    return ESP_OK;
+}
+
+// Whether the current client, not one replaced since, was refused MQTT 5
+static bool current_client_refused(void) {
+    portENTER_CRITICAL(&reconnect_lock);
+    bool refused = (refused_generation == client_generation);
+    portEXIT_CRITICAL(&reconnect_lock);
+    return refused;
+}
+
+static void handle_reconnect_events(uint32_t events) {
+    if ((events & RECONNECT_EVT_LINK) && mqtt_reconnect_link(link_up, esp_timer_get_time())) {
+        xEventGroupClearBits(mqtt_event_group, ENVILOG_MQTT_CONNECTED_BIT);
+        xEventGroupSetBits(mqtt_event_group, ENVILOG_MQTT_DISCONNECTED_BIT);
+    }
+
+    if (events & RECONNECT_EVT_ARCHIVE) {
+        char source[SENSOR_SOURCE_NAME_LEN];
+        portENTER_CRITICAL(&reconnect_lock);
+        memcpy(source, archive_source, sizeof(source));
+        portEXIT_CRITICAL(&reconnect_lock);
+        publish_archive(source);
+    }
+
+    if (events & RECONNECT_EVT_SESSION) {
+        mqtt_reconnect_session(envilog_mqtt_is_connected(), esp_timer_get_time());
+    }
+
+    // After the session events, so the refused attempt is not scheduled again with MQTT 5
+    bool fallback = (events & RECONNECT_EVT_FALLBACK) && use_v5 && current_client_refused();
+    if (fallback) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NOT_SUPPORTED, ERROR_CAT_COMMUNICATION,
+            "Broker refused MQTT 5, using 3.1.1 until restart");
+        use_v5 = false;
+    }
+    if ((fallback || (events & RECONNECT_EVT_RECONFIGURE)) && replace_client() == ESP_OK) {
+        if (fallback) {
+            // The broker is reachable, retry at once
+            mqtt_reconnect_retry_now(esp_timer_get_time());
+        } else {
+            mqtt_reconnect_restart(esp_timer_get_time());
+        }
+    }
+}
+
+// Blocks without timeout while connected or without link; wakes only for events and backoff deadlines
 static void mqtt_reconnect_task(void *pvParameters)
 {
-    bool was_connected = false;  // Track previous WiFi state
-    
     while (1) {
-        bool is_connected = network_manager_is_connected();
-        
-        // Handle WiFi state change
-        if (was_connected && !is_connected) {
-            // WiFi just disconnected
-            esp_mqtt_client_stop(mqtt_client);
-            xEventGroupClearBits(mqtt_event_group, ENVILOG_MQTT_CONNECTED_BIT);
-            xEventGroupSetBits(mqtt_event_group, ENVILOG_MQTT_DISCONNECTED_BIT);
+        int64_t deadline_us;
+        esp_err_t ret = mqtt_reconnect_poll(esp_timer_get_time(), &deadline_us);
+        if (ret == ESP_ERR_TIMEOUT) {
+            ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_COMMUNICATION,
+                "MQTT attempt %lu timed out", mqtt_reconnect_get_attempt());
+        } else if (ret != ESP_OK) {
+            ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_COMMUNICATION,
+                "MQTT attempt %lu failed to start", mqtt_reconnect_get_attempt());
         }
-        
-        if (is_connected) {
-            if (!envilog_mqtt_is_connected()) {
-                if (immediate_retry && retry_count < ENVILOG_WIFI_RETRY_NUM) {
-                    ESP_LOGI(TAG, "MQTT retry connecting (%d/%d)",
-                            retry_count + 1, ENVILOG_WIFI_RETRY_NUM);
-                    if (esp_mqtt_client_start(mqtt_client) != ESP_OK) {
-                        retry_count++;
-                    }
-                } else if (retry_count == ENVILOG_WIFI_RETRY_NUM) {
-                    ERROR_LOG_WARNING(TAG, ESP_ERR_TIMEOUT, ERROR_CAT_COMMUNICATION,
-                        "MQTT failed after maximum retries, switching to periodic reconnection");
-                    immediate_retry = false;
-                    retry_count++;
-                }
-                vTaskDelay(pdMS_TO_TICKS(immediate_retry ? 
-                    ENVILOG_MQTT_TIMEOUT_MS : ENVILOG_MQTT_RETRY_TIMEOUT_MS));
+
+        TickType_t wait = portMAX_DELAY;
+        if (deadline_us != INT64_MAX) {
+            int64_t delay_us = deadline_us - esp_timer_get_time();
+            wait = (delay_us > 0) ? pdMS_TO_TICKS(delay_us / 1000) + 1 : 0;
+        }
+
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, wait);
+        handle_reconnect_events(events);
+    }
+}
+
+// Publish the registered sources as a retained list on ENVILOG_MQTT_TOPIC_SENSORS
+static void publish_source_list(size_t count) {
+    cJSON *root = cJSON_CreateArray();
+    if (root == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        data_manager_source_info_t info;
+        if (data_manager_get_source_info((data_manager_handle_t)i, &info) != ESP_OK) {
+            continue;
+        }
+        cJSON *obj = cJSON_CreateObject();
+        if (obj == NULL) {
+            break;
+        }
+        cJSON_AddStringToObject(obj, "name", info.name);
+        cJSON *channels = cJSON_AddArrayToObject(obj, "channels");
+        for (uint8_t c = 0; channels && c < info.channel_count; c++) {
+            cJSON *channel = cJSON_CreateObject();
+            if (channel == NULL) {
+                break;
             }
+            cJSON_AddStringToObject(channel, "name", info.channels[c].name);
+            cJSON_AddStringToObject(channel, "unit", info.channels[c].unit);
+            cJSON_AddNumberToObject(channel, "scale", info.channels[c].scale);
+            cJSON_AddItemToArray(channels, channel);
         }
-        
-        was_connected = is_connected;
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        cJSON_AddItemToArray(root, obj);
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (json_str == NULL) {
+        return;
+    }
+
+    int msg_id = mqtt_publish(ENVILOG_MQTT_TOPIC_SENSORS, json_str, strlen(json_str), 1, 1, NULL);
+    free(json_str);
+    if (msg_id < 0) {
+        ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION, "Failed to publish source list");
+        return;
+    }
+    announced_sources = count;
+}
+
+// Sources are only added, so a count change means the retained list is stale
+static void announce_sources(void) {
+    size_t source_count = data_manager_get_source_count();
+    if (source_count != announced_sources && envilog_mqtt_is_connected()) {
+        publish_source_list(source_count);
+    }
+}
+
+// Encode one sample in the given format, -1 if it does not fit
+static int encode_sample(uint8_t format, char *buf, size_t size, const sensor_sample_t *sample) {
+    size_t len = mqtt_payload_encode_sample_as(format, buf, size, sample,
+                                               sensor_sample_time_ms(sample, esp_timer_get_time() / 1000));
+    return len ? (int)len : -1;
+}
+
+// Add a sample to its source's batch, waking the flush task when it opens one
+static esp_err_t batch_sample(const char *source, const sensor_sample_t *sample) {
+    bool opened = false;
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    esp_err_t ret = mqtt_batch_add(source, sample_format, sample, esp_timer_get_time() / 1000, &opened);
+    xSemaphoreGive(batch_mutex);
+    if (opened) {
+        // New batch: let the flush task arm its latency deadline
+        xTaskNotifyGive(batch_task_handle);
+    }
+    return ret;
+}
+
+// Publish batches whose oldest sample reached the latency bound, return the next deadline
+static int64_t flush_expired_batches(void) {
+    uint64_t next_ms = 0;
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    bool pending = mqtt_batch_flush_expired(esp_timer_get_time() / 1000, &next_ms);
+    xSemaphoreGive(batch_mutex);
+    return pending ? (int64_t)next_ms * 1000 : INT64_MAX;
+}
+
+// Enforces the latency bound; count and byte limits flush on the dispatcher
+static void mqtt_batch_task(void *pvParameters) {
+    while (1) {
+        int64_t deadline_us = flush_expired_batches();
+        TickType_t wait = portMAX_DELAY;
+        if (deadline_us != INT64_MAX) {
+            int64_t delay_us = deadline_us - esp_timer_get_time();
+            wait = (delay_us > 0) ? pdMS_TO_TICKS(delay_us / 1000) + 1 : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
     }
 }
 
 // Callback function for Data Manager to send sensor data to MQTT
-static esp_err_t mqtt_sensor_data_callback(const dht11_reading_t *reading) {
-    if (!reading || !reading->valid) {
+static esp_err_t mqtt_sensor_data_callback(const char *source, const sensor_sample_t *sample) {
+    if (!source || !sample || !sensor_sample_is_valid(sample)) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Create JSON for MQTT (moved from DHT11)
+    // Taken offline: the forwarder sends it from the sample store. The "mqtt"
+    // subscriber never queues these; this covers any other registration
+    if (sample->flags & SENSOR_SAMPLE_UNSENT) {
+        return ESP_OK;
+    }
+
+    announce_sources();
+
+    if (BATCHING_ENABLED && batch_mutex != NULL) {
+        return batch_sample(source, sample);
+    }
+
+    char payload[SAMPLE_JSON_MAX];
+    int len = encode_sample(sample_format, payload, sizeof(payload), sample);
+    if (len < 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return envilog_mqtt_publish_diagnostic(source, payload, len);
+}
+
+// A channel summary as a raw JSON object, the same one the HTTP rollup endpoint serves
+static void add_summary_to_object(cJSON *object, const char *name, const data_manager_channel_summary_t *summary) {
+    char json[MQTT_PAYLOAD_SUMMARY_JSON_MAX];
+    if (mqtt_payload_format_summary_json(json, sizeof(json), summary) > 0) {
+        cJSON_AddRawToObject(object, name, json);
+    }
+}
+
+static esp_err_t publish_rollup(const char *topic, const char *payload, size_t len) {
+    // QoS 1: buckets are rare and meant for long-term storage
+    int msg_id = mqtt_publish(topic, payload, len, 1, 0, NULL);
+    if (msg_id < 0) {
+        ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
+            "Failed to publish rollup to %s", topic);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// Callback function for Data Manager to send closed rollup buckets to MQTT
+static esp_err_t mqtt_rollup_callback(const char *source, const data_manager_rollup_t *rollup) {
+    if (!source || !rollup || !mqtt_client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    announce_sources();
+
+    char topic[ENVILOG_MQTT_TOPIC_MAX_LEN];
+    snprintf(topic, sizeof(topic), "%s/%s/%lu", ENVILOG_MQTT_TOPIC_ROLLUPS,
+             source, rollup->resolution_ms / 1000);
+
+    if (rollup_format == MQTT_PAYLOAD_CBOR) {
+        uint8_t payload[MQTT_PAYLOAD_ROLLUP_MAX];
+        size_t len = mqtt_payload_encode_rollup(payload, sizeof(payload), rollup);
+        return len ? publish_rollup(topic, (const char *)payload, len) : ESP_ERR_INVALID_SIZE;
+    }
+
     cJSON *root = cJSON_CreateObject();
     if (root == NULL) {
         return ESP_ERR_NO_MEM;
     }
 
-    cJSON_AddNumberToObject(root, "temperature", reading->temperature);
-    cJSON_AddNumberToObject(root, "humidity", reading->humidity);
-    cJSON_AddNumberToObject(root, "timestamp", reading->timestamp);
+    char start[24];
+    snprintf(start, sizeof(start), "%" PRIu64, rollup->start_ms);
+    cJSON_AddRawToObject(root, "start", start);
+    cJSON_AddNumberToObject(root, "resolution_s", rollup->resolution_ms / 1000);
+    cJSON_AddNumberToObject(root, "count", rollup->count);
+    add_summary_to_object(root, "temperature", &rollup->temperature);
+    add_summary_to_object(root, "humidity", &rollup->humidity);
 
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -169,9 +647,8 @@ static esp_err_t mqtt_sensor_data_callback(const dht11_reading_t *reading) {
         return ESP_ERR_NO_MEM;
     }
 
-    esp_err_t ret = envilog_mqtt_publish_diagnostic("dht11", json_str, strlen(json_str));
+    esp_err_t ret = publish_rollup(topic, json_str, strlen(json_str));
     free(json_str);
-
     return ret;
 }
 
@@ -185,6 +662,8 @@ esp_err_t envilog_mqtt_init(void)
         ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_CONFIG, "Failed to load MQTT config");
         return ret;
     }
+    envilog_mqtt_set_payload_formats(&mqtt_cfg);
+    attempt_timeout_ms = get_attempt_timeout(&mqtt_cfg);
 
     mqtt_event_group = xEventGroupCreate();
     if (mqtt_event_group == NULL) {
@@ -192,50 +671,58 @@ esp_err_t envilog_mqtt_init(void)
         return ESP_FAIL;
     }
 
-    esp_mqtt_client_config_t esp_mqtt_cfg = {
-        .broker.address.uri = mqtt_cfg.broker_url,
-        .credentials.client_id = mqtt_cfg.client_id,
-        .session.keepalive = mqtt_cfg.keepalive,
-        
-        // Timeout settings
-        .network.timeout_ms = mqtt_cfg.timeout_ms,
-        .network.reconnect_timeout_ms = mqtt_cfg.retry_timeout_ms,
-
-        // Outbox configuration
-        .outbox.limit = ENVILOG_MQTT_OUTBOX_SIZE * 1024,
-        
-        // Session settings
-        .session.disable_clean_session = false,
-        
-        // Last will message
-        .session.last_will = {
-            .topic = "/envilog/status",
-            .msg = "offline",
-            .qos = 1,
-            .retain = 1
-        }
-    };
-
-    mqtt_client = esp_mqtt_client_init(&esp_mqtt_cfg);
-    if (mqtt_client == NULL) {
-        ERROR_LOG_ERROR(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
-            "Failed to initialize MQTT client");
-        return ESP_FAIL;
+    ret = mqtt_publish_init();
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SYSTEM, "Failed to create publish lock");
+        return ret;
     }
 
-    ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID,
-                                                 mqtt_event_handler, NULL));
-
-    return ESP_OK;
+    ESP_LOGI(TAG, "Protocol: MQTT %s", use_v5 ? "5" : "3.1.1");
+    return create_client(&mqtt_cfg);
 }
 
 esp_err_t envilog_mqtt_start(void)
 {
     ESP_LOGI(TAG, "Starting MQTT Client");
     
-    // Create reconnection task
-    xTaskCreate(mqtt_reconnect_task, "mqtt_reconnect", TASK_STACK_SIZE_MQTT,
-                NULL, TASK_PRIORITY_MQTT, NULL);
+    mqtt_reconnect_config_t reconnect_config = {
+        .backoff_base_ms = ENVILOG_MQTT_BACKOFF_BASE_MS,
+        .backoff_max_ms = ENVILOG_MQTT_BACKOFF_MAX_MS,
+        .attempt_timeout_ms = attempt_timeout_ms,
+        .jitter_seed = jitter_seed(),
+    };
+    mqtt_reconnect_init(&reconnect_config);
+    if (xTaskCreate(mqtt_reconnect_task, "mqtt_reconnect", TASK_STACK_SIZE_MQTT,
+                    NULL, TASK_PRIORITY_MQTT, &reconnect_task_handle) != pdPASS) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to create reconnect task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Read the link state after registering so no transition falls in between
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, link_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, link_event_handler, NULL));
+    link_up = network_manager_is_connected();
+    notify_reconnect(RECONNECT_EVT_LINK);
+
+    if (BATCHING_ENABLED && batch_mutex == NULL) {
+        mqtt_batch_config_t batch_config = {
+            .max_samples = ENVILOG_MQTT_BATCH_SAMPLES,
+            .max_bytes = ENVILOG_MQTT_BATCH_BYTES,
+            .latency_ms = ENVILOG_MQTT_BATCH_LATENCY_MS,
+            .publish = envilog_mqtt_publish_diagnostic,
+        };
+        batch_mutex = xSemaphoreCreateMutex();
+        if (batch_mutex == NULL || mqtt_batch_init(&batch_config) != ESP_OK ||
+            xTaskCreate(mqtt_batch_task, "mqtt_batch", TASK_STACK_SIZE_MQTT,
+                        NULL, TASK_PRIORITY_MQTT, &batch_task_handle) != pdPASS) {
+            // Samples fall back to one message each
+            ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to start MQTT batching");
+            if (batch_mutex != NULL) {
+                vSemaphoreDelete(batch_mutex);
+                batch_mutex = NULL;
+            }
+        }
+    }
 
     return ESP_OK;
 }
@@ -258,10 +745,14 @@ esp_err_t envilog_mqtt_publish_status(const char *data, size_t len)
 
     len = (len == 0) ? strlen(data) : len;
 
-    int msg_id = esp_mqtt_client_publish(mqtt_client, ENVILOG_MQTT_TOPIC_STATUS,
-                                       data, len,
-                                       0,    // QoS 0 for frequent updates
-                                       0);   // Don't retain
+    static const mqtt_publish_opts_t status_opts = {
+        .expiry_s = ENVILOG_MQTT_MESSAGE_EXPIRY_S,
+        .alias = true,
+    };
+    int msg_id = mqtt_publish(ENVILOG_MQTT_TOPIC_STATUS, data, len,
+                              0,    // QoS 0 for frequent updates
+                              0,    // Don't retain
+                              &status_opts);
 
     if (msg_id < 0) {
         ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
@@ -285,9 +776,15 @@ esp_err_t envilog_mqtt_publish_diagnostic(const char *type, const char *data, si
 
     len = (len == 0) ? strlen(data) : len;
 
-    int msg_id = esp_mqtt_client_publish(mqtt_client, full_topic, data, len,
-                                       1,    // QoS 1 to test queueing
-                                       0);   // Don't retain
+    // MQTT 5 only; the alias is skipped at QoS 1
+    const mqtt_publish_opts_t opts = {
+        .source = type,
+        .expiry_s = ENVILOG_MQTT_MESSAGE_EXPIRY_S,
+        .alias = true,
+    };
+    int msg_id = mqtt_publish(full_topic, data, len, ENVILOG_MQTT_SAMPLE_QOS,
+                              0,    // Don't retain
+                              &opts);
 
     if (msg_id < 0) {
         ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
@@ -309,54 +806,52 @@ esp_err_t envilog_mqtt_update_config(void)
             "Failed to load new MQTT config");
         return ret;
     }
+    envilog_mqtt_set_payload_formats(&mqtt_cfg);
+    attempt_timeout_ms = get_attempt_timeout(&mqtt_cfg);
+    mqtt_reconnect_set_attempt_timeout(attempt_timeout_ms);
 
     // Check client state
-    if (mqtt_client == NULL) {
+    if (mqtt_client == NULL || reconnect_task_handle == NULL) {
         ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_STATE, ERROR_CAT_SYSTEM,
-            "MQTT client not initialized");
+            "MQTT client not started");
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Only reconfigure if WiFi is connected and client is connected
-    if (network_manager_is_connected() && envilog_mqtt_is_connected()) {
-        esp_mqtt_client_stop(mqtt_client);
-        esp_mqtt_client_destroy(mqtt_client);
-
-        esp_mqtt_client_config_t esp_mqtt_cfg = {
-            .broker.address.uri = mqtt_cfg.broker_url,
-            .credentials.client_id = mqtt_cfg.client_id,
-            .session.keepalive = mqtt_cfg.keepalive,
-            .network.timeout_ms = mqtt_cfg.timeout_ms,
-            .network.reconnect_timeout_ms = mqtt_cfg.retry_timeout_ms,
-            .outbox.limit = ENVILOG_MQTT_OUTBOX_SIZE * 1024,
-            .session.disable_clean_session = false,
-            .session.last_will = {
-                .topic = "/envilog/status",
-                .msg = "offline",
-                .qos = 1,
-                .retain = 1
-            }
-        };
+    // The client is replaced on the reconnect task, which owns its lifecycle
+    notify_reconnect(RECONNECT_EVT_RECONFIGURE);
+    ESP_LOGI(TAG, "MQTT configuration updated");
+    return ESP_OK;
+}
 
-        mqtt_client = esp_mqtt_client_init(&esp_mqtt_cfg);
-        if (mqtt_client == NULL) {
-            ERROR_LOG_ERROR(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION,
-                "Failed to initialize MQTT client");
-            return ESP_FAIL;
-        }
+sensor_data_callback_t envilog_mqtt_get_sensor_callback(void) {
+    return mqtt_sensor_data_callback;
+}
 
-        ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID,
-                                                     mqtt_event_handler, NULL));
-    }
+sensor_rollup_callback_t envilog_mqtt_get_rollup_callback(void) {
+    return mqtt_rollup_callback;
+}
 
-    // Reset retry mechanism regardless
-    retry_count = 0;
-    immediate_retry = true;
+esp_err_t envilog_mqtt_get_batch_stats(envilog_mqtt_batch_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (batch_mutex == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-    ESP_LOGI(TAG, "MQTT configuration updated");
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    mqtt_batch_get_stats(stats);
+    xSemaphoreGive(batch_mutex);
     return ESP_OK;
 }
 
-sensor_data_callback_t envilog_mqtt_get_sensor_callback(void) {
-    return mqtt_sensor_data_callback;
+void envilog_mqtt_set_payload_formats(const mqtt_config_t *config) {
+    if (config == NULL) {
+        return;
+    }
+    sample_format = (config->sample_format == MQTT_PAYLOAD_CBOR) ? MQTT_PAYLOAD_CBOR : MQTT_PAYLOAD_JSON;
+    rollup_format = (config->rollup_format == MQTT_PAYLOAD_CBOR) ? MQTT_PAYLOAD_CBOR : MQTT_PAYLOAD_JSON;
+    ESP_LOGI(TAG, "Payload formats: samples %s, rollups %s",
+             sample_format == MQTT_PAYLOAD_CBOR ? "cbor" : "json",
+             rollup_format == MQTT_PAYLOAD_CBOR ? "cbor" : "json");
 }
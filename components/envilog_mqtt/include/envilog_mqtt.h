@@ -4,6 +4,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "data_manager.h"
+#include "system_manager.h"
 
 // EnviLog MQTT event group bits
 #define ENVILOG_MQTT_CONNECTED_BIT     BIT0
@@ -18,10 +19,106 @@
 #define ENVILOG_MQTT_TOPIC_SENSORS      "/envilog/sensors"
 #define ENVILOG_MQTT_TOPIC_DHT11        "/envilog/sensors/dht11"
 #define ENVILOG_MQTT_TOPIC_SENSOR_CONFIG "/envilog/sensors/config"
+#define ENVILOG_MQTT_TOPIC_ROLLUPS      "/envilog/rollups"
+#define ENVILOG_MQTT_TOPIC_ARCHIVE      "/envilog/archive"
+#define ENVILOG_MQTT_TOPIC_ARCHIVE_REQUEST "/envilog/sensors/archive"
+#define ENVILOG_MQTT_TOPIC_FORWARD      "/envilog/forward"
+
+#define ENVILOG_MQTT_BATCH_LATENCY_BUCKETS 8
+#define ENVILOG_MQTT_RECONNECT_BUCKETS     10
+
+/**
+ * @brief Sample batching counters
+ *
+ * samples - messages is the number of publishes saved. Latency is the time
+ * a delivered sample waited in its batch; bucket i counts waits in the i-th
+ * eighth of ENVILOG_MQTT_BATCH_LATENCY_MS, the last bucket also counts
+ * longer ones. Samples of a batch whose publish failed are counted in
+ * samples_dropped instead.
+ */
+typedef struct {
+    uint32_t samples;              // Samples added to batches
+    uint32_t messages;             // Batches published
+    uint32_t flushed_full;         // Batches closed at ENVILOG_MQTT_BATCH_SAMPLES
+    uint32_t flushed_bytes;        // Batches closed because the next sample did not fit
+    uint32_t flushed_latency;      // Batches closed by the latency bound
+    uint32_t publish_errors;
+    uint32_t samples_dropped;      // Samples of the batches that failed to publish
+    uint32_t latency_max_ms;
+    uint64_t latency_total_ms;     // Sum for the mean
+    uint32_t latency_buckets[ENVILOG_MQTT_BATCH_LATENCY_BUCKETS];
+} envilog_mqtt_batch_stats_t;
+
+/**
+ * @brief Reconnect counters
+ *
+ * Reconnect time runs from the moment a session became possible (link up,
+ * or session lost with the link up) until the broker accepted it. Time
+ * bucket 0 counts reconnects under 1 s, bucket i those of 2^(i-1) up to
+ * 2^i s. Attempt bucket 0 counts reconnects at the first attempt, bucket i
+ * those needing 2^(i-1) + 1 up to 2^i attempts. The last bucket of each
+ * also counts everything beyond.
+ */
+typedef struct {
+    const char *state;             // wait_link, backoff, connecting or connected
+    uint32_t reconnects;           // Sessions established
+    uint32_t attempts;             // Connection attempts in total
+    uint32_t attempt;              // Attempts in the current outage
+    uint32_t last_delay_ms;        // Last backoff drawn
+    uint32_t longest_ms;
+    uint64_t total_ms;             // Sum for the mean
+    uint32_t time_buckets[ENVILOG_MQTT_RECONNECT_BUCKETS];
+    uint32_t attempt_buckets[ENVILOG_MQTT_RECONNECT_BUCKETS];
+} envilog_mqtt_reconnect_stats_t;
+
+/**
+ * @brief Store-and-forward counters
+ *
+ * The cursor is the next stored sample the forwarder examines; it only
+ * moves past a message once the broker has acknowledged it.
+ */
+typedef struct {
+    uint32_t drains;               // Drains started, one per broker session
+    uint32_t messages;             // Messages acknowledged by the broker
+    uint32_t samples;              // Samples in acknowledged messages
+    uint32_t publish_errors;
+    uint32_t ack_timeouts;
+    uint32_t cursor_seq;           // Sample store record of the cursor
+    uint16_t cursor_index;         // Sample within that record
+    bool active;                   // Drain in progress
+} envilog_mqtt_forward_stats_t;
+
+/**
+ * @brief Publish counters
+ *
+ * Wire bytes are the PUBLISH packets as encoded for the broker: fixed
+ * header, topic, packet id, MQTT 5 properties and payload. wire_bytes /
+ * messages compared between the two protocol versions gives the overhead
+ * a topic alias saves.
+ */
+typedef struct {
+    uint8_t protocol;              // Protocol level of the client, 5 or 4 (3.1.1)
+    uint32_t messages;             // Publishes accepted by the client
+    uint32_t aliased;              // Sent with an empty topic and a topic alias
+    uint32_t metadata;             // Carried the source metadata properties
+    uint64_t payload_bytes;
+    uint64_t wire_bytes;
+} envilog_mqtt_publish_stats_t;
 
 /**
  * @brief Initialize the MQTT client
  * 
+ * With CONFIG_ENVILOG_MQTT_PROTOCOL_5 the client connects with MQTT 5:
+ * - the status topic, and the sample topics at QoS 0, get a topic alias,
+ *   bound by their first message of a session and left empty after that
+ * - the first sample of a source in a session carries its fixed metadata
+ *   as user properties: "fw" (firmware version), "source", and one
+ *   property per channel named after it with its unit as value
+ * - samples and status messages expire after ENVILOG_MQTT_MESSAGE_EXPIRY_S
+ *   at the broker, so offline subscribers do not get a stale backlog
+ * A broker refusing the protocol level is retried with MQTT 3.1.1 for the
+ * rest of the boot, and a broker without topic aliases gets full topics.
+ * 
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t envilog_mqtt_init(void);
@@ -29,6 +126,13 @@ esp_err_t envilog_mqtt_init(void);
 /**
  * @brief Start the MQTT client
  * 
+ * Connection attempts are paced by a task that sleeps while the session
+ * is up or there is no IP link. After a loss it retries with exponential
+ * backoff and full jitter: attempt n waits a uniform random delay of up to
+ * min(ENVILOG_MQTT_BACKOFF_MAX_MS, ENVILOG_MQTT_BACKOFF_BASE_MS * 2^n),
+ * drawn from a generator seeded with the station MAC so a fleet recovering
+ * from the same outage spreads out instead of reconnecting in lockstep.
+ * 
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t envilog_mqtt_start(void);
@@ -57,7 +161,9 @@ EventGroupHandle_t envilog_mqtt_get_event_group(void);
 esp_err_t envilog_mqtt_publish_status(const char *data, size_t len);
 
 /**
- * @brief Publish diagnostic data (QoS 1 for testing queue)
+ * @brief Publish diagnostic data at ENVILOG_MQTT_SAMPLE_QOS
+ * 
+ * Carries the samples of a source, see envilog_mqtt_get_sensor_callback().
  * 
  * @param type Diagnostic type (e.g., "heap", "wifi", "system")
  * @param data Diagnostic data
@@ -68,14 +174,91 @@ esp_err_t envilog_mqtt_publish_diagnostic(const char *type, const char *data, si
 
 /**
  * @brief Update MQTT configuration
- * 
- * @return esp_err_t ESP_OK on success
+ *
+ * Payload formats apply at once. The client is recreated from the saved
+ * config on the reconnect task, connected or not, and reconnects with a
+ * fresh backoff.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE before envilog_mqtt_start()
  */
 esp_err_t envilog_mqtt_update_config(void);
 
+/**
+ * @brief Select the payload encoding of the sample and rollup topics
+ * 
+ * Takes effect with the next message; an open batch keeps its format.
+ * 
+ * @param config MQTT configuration carrying sample_format and rollup_format
+ */
+void envilog_mqtt_set_payload_formats(const mqtt_config_t *config);
+
 /**
  * @brief Get MQTT sensor data callback for data manager
  * 
+ * With ENVILOG_MQTT_BATCH_SAMPLES above 1, samples of a source are
+ * collected and published to /envilog/diagnostic/<source> as one JSON
+ * array of the single-sample objects.
+ * 
+ * Samples flagged SENSOR_SAMPLE_UNSENT are skipped; the forwarder sends
+ * them from the sample store instead.
+ * 
  * @return sensor_data_callback_t Callback function for sensor data
  */
 sensor_data_callback_t envilog_mqtt_get_sensor_callback(void);
+
+/**
+ * @brief Get MQTT rollup callback for data manager
+ *
+ * Publishes each closed bucket to /envilog/rollups/<source>/<seconds>.
+ * 
+ * @return sensor_rollup_callback_t Callback function for rollup buckets
+ */
+sensor_rollup_callback_t envilog_mqtt_get_rollup_callback(void);
+
+/**
+ * @brief Get sample batching counters
+ * 
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED when batching is disabled
+ */
+esp_err_t envilog_mqtt_get_batch_stats(envilog_mqtt_batch_stats_t *stats);
+
+/**
+ * @brief Forward samples taken while the uplink was down
+ * 
+ * Call after sample_store_init(). On every broker connect, samples the
+ * sample store holds with SENSOR_SAMPLE_UNSENT are published at QoS 1 to
+ * /envilog/forward/<source>/<boot> as arrays in the sample payload format,
+ * at most ENVILOG_MQTT_FORWARD_RATE messages a second. Timestamps of
+ * earlier boots are ms since that boot. Progress is saved in NVS after
+ * each acknowledged message, so a reboot resumes instead of starting over;
+ * a message cut off before its acknowledgement may arrive twice, consumers
+ * dedupe on source, boot and timestamp.
+ * 
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t envilog_mqtt_start_forward(void);
+
+/**
+ * @brief Get store-and-forward counters
+ * 
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED when forwarding is not started
+ */
+esp_err_t envilog_mqtt_get_forward_stats(envilog_mqtt_forward_stats_t *stats);
+
+/**
+ * @brief Get reconnect counters and histograms
+ * 
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t envilog_mqtt_get_reconnect_stats(envilog_mqtt_reconnect_stats_t *stats);
+
+/**
+ * @brief Get publish counters
+ * 
+ * @param stats Pointer to store the counters
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE before envilog_mqtt_init()
+ */
+esp_err_t envilog_mqtt_get_publish_stats(envilog_mqtt_publish_stats_t *stats);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_driver.h"
+#include "data_manager.h"
+#include "system_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary (CBOR, RFC 8949) payloads of the sample and rollup topics.
+ *
+ * Values stay in the fixed-point units of the data path: temperatures in
+ * 0.01 °C, humidities in 0.01 %RH, matching the channel scale announced
+ * on /envilog/sensors. Maps use small unsigned keys instead of names.
+ *
+ * Sample, /envilog/diagnostic/<source>:
+ *   0  timestamp, ms since boot
+ *   1  temperature
+ *   2  humidity
+ *   3  temperature_filtered   (only with a filter)
+ *   4  humidity_filtered      (only with a filter)
+ *   5  filter name, text      (only with a filter)
+ *
+ * A batch is an indefinite-length array (0x9F .. 0xFF) of sample maps, as
+ * are the messages on /envilog/forward/<source>/<boot>.
+ *
+ * Rollup, /envilog/rollups/<source>/<seconds>:
+ *   0  bucket start, ms since boot
+ *   1  temperature summary [min, max, mean, p5, p50, p95]
+ *   2  humidity summary
+ *   6  resolution_s
+ *   7  count
+ *
+ * JSON payloads start with '{' or '[', CBOR ones with a map or array
+ * head (0x80 .. 0xBF), so readers can tell them apart. tools/envilog_payload.py
+ * decodes both into the JSON field names.
+ */
+#define MQTT_PAYLOAD_CBOR_BATCH_OPEN   0x9F
+#define MQTT_PAYLOAD_CBOR_BATCH_CLOSE  0xFF
+#define MQTT_PAYLOAD_SAMPLE_MAX        48   // Largest encoded sample, filter name included
+#define MQTT_PAYLOAD_ROLLUP_MAX        72   // Largest encoded rollup
+#define MQTT_PAYLOAD_SUMMARY_JSON_MAX  (16 * (4 + DATA_MANAGER_QUANTILES))  // Terminator included
+
+/**
+ * @brief Encode a sample as a CBOR map
+ *
+ * Writes only into buf; nothing is allocated.
+ *
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @param sample Sample to encode
+ * @param timestamp_ms Full sample time, see sensor_sample_time_ms()
+ * @return size_t Bytes written, 0 if the buffer is too small
+ */
+size_t mqtt_payload_encode_sample(uint8_t *buf, size_t size, const sensor_sample_t *sample,
+                                  uint64_t timestamp_ms);
+
+/**
+ * @brief Format a sample as the JSON object of the sample topic
+ *
+ * @param buf Output buffer, NUL terminated on success
+ * @param size Buffer size
+ * @param sample Sample to format
+ * @param timestamp_ms Full sample time
+ * @return size_t Characters written without the terminator, 0 if the buffer is too small
+ */
+size_t mqtt_payload_format_sample_json(char *buf, size_t size, const sensor_sample_t *sample,
+                                       uint64_t timestamp_ms);
+
+/**
+ * @brief Encode a sample as JSON or CBOR
+ *
+ * @param format mqtt_payload_format_t
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @param sample Sample to encode
+ * @param timestamp_ms Full sample time
+ * @return size_t Bytes written, 0 if the buffer is too small
+ */
+size_t mqtt_payload_encode_sample_as(uint8_t format, char *buf, size_t size, const sensor_sample_t *sample,
+                                     uint64_t timestamp_ms);
+
+/**
+ * @brief Format one channel of a rollup bucket as a JSON object
+ *
+ * {"min":..,"max":..,"mean":..,"p5":..} with a p<percent> field per
+ * DATA_MANAGER_QUANTILE_PERCENTS, shared by the rollup topic and the
+ * HTTP rollup endpoint, e.g. through cJSON_AddRawToObject().
+ *
+ * @param buf Output buffer, NUL terminated on success
+ * @param size Buffer size, MQTT_PAYLOAD_SUMMARY_JSON_MAX always fits
+ * @param summary Channel summary
+ * @return size_t Characters written without the terminator, 0 if the buffer is too small
+ */
+size_t mqtt_payload_format_summary_json(char *buf, size_t size, const data_manager_channel_summary_t *summary);
+
+/**
+ * @brief Encode a rollup bucket as a CBOR map
+ *
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @param rollup Closed bucket
+ * @return size_t Bytes written, 0 if the buffer is too small
+ */
+size_t mqtt_payload_encode_rollup(uint8_t *buf, size_t size, const data_manager_rollup_t *rollup);
+
+#ifdef __cplusplus
+}
+#endif
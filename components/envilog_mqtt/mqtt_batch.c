@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mqtt_batch.h"
+#include "mqtt_payload.h"
+
+// Samples of one source collected into a JSON or CBOR array payload
+typedef struct {
+    const char *source;             // Data manager name, valid for its lifetime
+    char *payload;                  // max_bytes, allocated with the first sample
+    uint32_t *arrival_ms;           // Per-sample arrival for the latency histogram
+    size_t len;
+    uint16_t count;
+    uint8_t format;                 // Fixed when the batch opens
+} mqtt_batch_t;
+
+typedef enum {
+    BATCH_FLUSH_FULL,
+    BATCH_FLUSH_BYTES,
+    BATCH_FLUSH_LATENCY,
+} batch_flush_reason_t;
+
+static mqtt_batch_config_t batch_config;
+static mqtt_batch_t batches[DATA_MANAGER_MAX_SOURCES];
+static size_t batch_count = 0;
+static envilog_mqtt_batch_stats_t batch_stats = {0};
+
+esp_err_t mqtt_batch_init(const mqtt_batch_config_t *config) {
+    if (config == NULL || config->max_samples == 0 || config->max_bytes < 2 ||
+        config->latency_ms == 0 || config->publish == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < batch_count; i++) {
+        free(batches[i].payload);
+        free(batches[i].arrival_ms);
+    }
+    memset(batches, 0, sizeof(batches));
+    batch_count = 0;
+    memset(&batch_stats, 0, sizeof(batch_stats));
+    batch_config = *config;
+    return ESP_OK;
+}
+
+// Close the array, publish it and account each delivered sample's wait
+static esp_err_t flush_batch(mqtt_batch_t *batch, batch_flush_reason_t reason, uint32_t now_ms) {
+    batch->payload[batch->len++] = (batch->format == MQTT_PAYLOAD_CBOR) ? MQTT_PAYLOAD_CBOR_BATCH_CLOSE : ']';
+    esp_err_t ret = batch_config.publish(batch->source, batch->payload, batch->len);
+
+    // A failed batch is dropped; its samples never reached the broker, so they have no latency
+    for (uint16_t i = 0; ret == ESP_OK && i < batch->count; i++) {
+        uint32_t latency_ms = now_ms - batch->arrival_ms[i];
+        size_t bucket = (size_t)latency_ms * ENVILOG_MQTT_BATCH_LATENCY_BUCKETS / batch_config.latency_ms;
+        batch_stats.latency_buckets[bucket < ENVILOG_MQTT_BATCH_LATENCY_BUCKETS ?
+                                    bucket : ENVILOG_MQTT_BATCH_LATENCY_BUCKETS - 1]++;
+        batch_stats.latency_total_ms += latency_ms;
+        if (latency_ms > batch_stats.latency_max_ms) {
+            batch_stats.latency_max_ms = latency_ms;
+        }
+    }
+
+    if (ret == ESP_OK) {
+        batch_stats.messages++;
+    } else {
+        batch_stats.publish_errors++;
+        batch_stats.samples_dropped += batch->count;
+    }
+    batch_stats.flushed_full += (reason == BATCH_FLUSH_FULL);
+    batch_stats.flushed_bytes += (reason == BATCH_FLUSH_BYTES);
+    batch_stats.flushed_latency += (reason == BATCH_FLUSH_LATENCY);
+
+    batch->len = 0;
+    batch->count = 0;
+    return ret;
+}
+
+static mqtt_batch_t *get_batch(const char *source) {
+    for (size_t i = 0; i < batch_count; i++) {
+        if (batches[i].source == source || strcmp(batches[i].source, source) == 0) {
+            return &batches[i];
+        }
+    }
+    if (batch_count == DATA_MANAGER_MAX_SOURCES) {
+        return NULL;
+    }
+    char *payload = malloc(batch_config.max_bytes);
+    uint32_t *arrival_ms = malloc(batch_config.max_samples * sizeof(uint32_t));
+    if (payload == NULL || arrival_ms == NULL) {
+        free(payload);
+        free(arrival_ms);
+        return NULL;
+    }
+    mqtt_batch_t *batch = &batches[batch_count++];
+    batch->source = source;
+    batch->payload = payload;
+    batch->arrival_ms = arrival_ms;
+    return batch;
+}
+
+// Bytes in front of the next item: the array opener, a JSON comma, or nothing between CBOR items
+static size_t batch_item_prefix(const mqtt_batch_t *batch) {
+    return (batch->count == 0 || batch->format == MQTT_PAYLOAD_JSON) ? 1 : 0;
+}
+
+// Encode one sample in the given format at offset, -1 if it does not fit before the closing byte
+static int encode_at(mqtt_batch_t *batch, uint8_t format, size_t offset, const sensor_sample_t *sample,
+                     uint64_t now_ms) {
+    if (offset + 1 >= batch_config.max_bytes) {
+        return -1;
+    }
+    size_t len = mqtt_payload_encode_sample_as(format, batch->payload + offset,
+                                               batch_config.max_bytes - 1 - offset, sample,
+                                               sensor_sample_time_ms(sample, now_ms));
+    return len ? (int)len : -1;
+}
+
+esp_err_t mqtt_batch_add(const char *source, uint8_t format, const sensor_sample_t *sample,
+                         uint64_t now_ms, bool *opened) {
+    esp_err_t ret = ESP_OK;
+    *opened = false;
+
+    mqtt_batch_t *batch = get_batch(source);
+    if (batch == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t item_format = (batch->count > 0) ? batch->format : format;
+    size_t offset = batch->len + batch_item_prefix(batch);
+    int len = encode_at(batch, item_format, offset, sample, now_ms);
+    if (len < 0 && batch->count > 0) {
+        ret = flush_batch(batch, BATCH_FLUSH_BYTES, (uint32_t)now_ms);
+        item_format = format;
+        offset = 1;
+        len = encode_at(batch, item_format, offset, sample, now_ms);
+    }
+    if (len < 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (batch->count == 0) {
+        batch->format = item_format;
+        batch->payload[0] = (item_format == MQTT_PAYLOAD_CBOR) ? MQTT_PAYLOAD_CBOR_BATCH_OPEN : '[';
+    } else if (offset > batch->len) {
+        batch->payload[batch->len] = ',';
+    }
+    batch->len = offset + len;
+    batch->arrival_ms[batch->count++] = (uint32_t)now_ms;
+    batch_stats.samples++;
+
+    if (batch->count == batch_config.max_samples) {
+        // Report the byte-limit flush error first if both failed
+        esp_err_t full_ret = flush_batch(batch, BATCH_FLUSH_FULL, (uint32_t)now_ms);
+        if (ret == ESP_OK) {
+            ret = full_ret;
+        }
+    } else if (batch->count == 1) {
+        *opened = true;
+    }
+    return ret;
+}
+
+bool mqtt_batch_flush_expired(uint64_t now_ms, uint64_t *next_ms) {
+    bool pending = false;
+    for (size_t i = 0; i < batch_count; i++) {
+        mqtt_batch_t *batch = &batches[i];
+        if (batch->count == 0) {
+            continue;
+        }
+        uint32_t age_ms = (uint32_t)now_ms - batch->arrival_ms[0];
+        if (age_ms >= batch_config.latency_ms) {
+            flush_batch(batch, BATCH_FLUSH_LATENCY, (uint32_t)now_ms);
+        } else {
+            uint64_t deadline_ms = now_ms + (batch_config.latency_ms - age_ms);
+            if (!pending || deadline_ms < *next_ms) {
+                *next_ms = deadline_ms;
+            }
+            pending = true;
+        }
+    }
+    return pending;
+}
+
+void mqtt_batch_get_stats(envilog_mqtt_batch_stats_t *stats) {
+    *stats = batch_stats;
+}
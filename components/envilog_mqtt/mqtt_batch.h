@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sensor_driver.h"
+#include "envilog_mqtt.h"
+
+/*
+ * Per-source sample batches of the diagnostic topics. Pure bookkeeping:
+ * the caller serializes the calls, passes the time in and gets batches
+ * back through the publish hook, so the same code runs in the host tests.
+ */
+
+// Publishes one closed batch
+typedef esp_err_t (*mqtt_batch_publish_t)(const char *source, const char *payload, size_t len);
+
+// A batch closes on whichever limit is reached first
+typedef struct {
+    uint16_t max_samples;           // N, samples per batch
+    size_t max_bytes;               // M, payload bytes per batch, brackets included
+    uint32_t latency_ms;            // T, longest wait of the oldest sample
+    mqtt_batch_publish_t publish;
+} mqtt_batch_config_t;
+
+/**
+ * @brief Set the limits and the publish hook, dropping any open batch
+ */
+esp_err_t mqtt_batch_init(const mqtt_batch_config_t *config);
+
+/**
+ * @brief Encode a sample straight into its source's batch
+ *
+ * Publishes the batch first if the sample would overflow the byte limit,
+ * and after it if the batch reached the sample limit. An open batch
+ * keeps its format. A batch that fails to publish is dropped and its
+ * samples counted in samples_dropped.
+ *
+ * @param source Data manager name, valid for its lifetime
+ * @param format mqtt_payload_format_t of a batch opened by this sample
+ * @param sample Sample to add
+ * @param now_ms Current time, ms since boot
+ * @param opened Set when the sample opened a batch, so a latency deadline must be armed
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM without a batch for the source,
+ *         ESP_ERR_INVALID_SIZE if the sample does not fit an empty batch, or the first publish error
+ */
+esp_err_t mqtt_batch_add(const char *source, uint8_t format, const sensor_sample_t *sample,
+                         uint64_t now_ms, bool *opened);
+
+/**
+ * @brief Publish batches whose oldest sample reached the latency bound
+ *
+ * @param now_ms Current time, ms since boot
+ * @param next_ms Earliest deadline of the batches left open
+ * @return bool Whether a batch is still open
+ */
+bool mqtt_batch_flush_expired(uint64_t now_ms, uint64_t *next_ms);
+
+/**
+ * @brief Copy the counters
+ */
+void mqtt_batch_get_stats(envilog_mqtt_batch_stats_t *stats);
@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "envilog_mqtt.h"
+#include "envilog_config.h"
+#include "task_manager.h"
+#include "error_handler.h"
+#include "sample_store.h"
+#include "mqtt_payload.h"
+#include "mqtt_forward.h"
+#include "mqtt_publish.h"
+
+static const char *TAG = "mqtt_forward";
+
+#define FORWARD_NVS_NAMESPACE   "envilog_fwd"
+#define FORWARD_NVS_KEY_CURSOR  "cursor"
+#define FORWARD_ACK_TIMEOUT_MS  10000
+#define FORWARD_RETRY_MS        30000   // Pause before resuming a drain cut short while connected
+
+#define FORWARD_RUN_BIT         BIT0    // Broker session up
+#define FORWARD_START_BIT       BIT1    // Drain requested
+#define FORWARD_ACK_BIT         BIT2    // PUBACK of the awaited message received, or session lost
+
+// awaited_msg_id while nothing is awaited, and while the id of the publish in progress is unknown
+#define FORWARD_AWAIT_NONE      -1
+#define FORWARD_AWAIT_PUBLISH   0       // QoS 1 ids start at 1
+#define FORWARD_EARLY_ACKS      4       // PUBACKs kept while the publish has not returned its id
+
+// Next stored sample to examine, persisted after every acknowledged message
+typedef struct {
+    uint32_t seq;                   // Record sequence number
+    uint16_t index;                 // Sample within the record
+} forward_cursor_t;
+
+// Unsent samples of one source and boot collected into a JSON or CBOR array
+typedef struct {
+    char source[SENSOR_SOURCE_NAME_LEN];
+    uint32_t boot;
+    char *payload;                  // ENVILOG_MQTT_FORWARD_BYTES
+    size_t len;
+    uint16_t count;
+    forward_cursor_t end;           // Cursor once the broker has the chunk
+} forward_chunk_t;
+
+static EventGroupHandle_t forward_events = NULL;
+static volatile uint8_t forward_format = MQTT_PAYLOAD_JSON;
+static portMUX_TYPE ack_lock = portMUX_INITIALIZER_UNLOCKED;
+static int awaited_msg_id = FORWARD_AWAIT_NONE;
+static int early_acks[FORWARD_EARLY_ACKS];  // The broker can answer before mqtt_publish() returns
+static size_t early_ack_count = 0;
+static nvs_handle_t cursor_nvs;
+static forward_cursor_t cursor = {0};
+static sample_store_record_t *record = NULL;
+static forward_chunk_t chunk = {0};
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static envilog_mqtt_forward_stats_t stats = {0};     // Written by the forward task, under stats_lock
+
+static void save_cursor(void) {
+    portENTER_CRITICAL(&stats_lock);
+    stats.cursor_seq = cursor.seq;
+    stats.cursor_index = cursor.index;
+    portEXIT_CRITICAL(&stats_lock);
+    esp_err_t ret = nvs_set_blob(cursor_nvs, FORWARD_NVS_KEY_CURSOR, &cursor, sizeof(cursor));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(cursor_nvs);
+    }
+    if (ret != ESP_OK) {
+        // Samples since the last saved cursor are sent again after a reboot
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_STORAGE, "Failed to save forward cursor");
+    }
+}
+
+static bool session_up(void) {
+    return (xEventGroupGetBits(forward_events) & FORWARD_RUN_BIT) != 0;
+}
+
+// Start awaiting the PUBACK of a publish about to be issued
+static void await_publish(void) {
+    portENTER_CRITICAL(&ack_lock);
+    awaited_msg_id = FORWARD_AWAIT_PUBLISH;
+    early_ack_count = 0;
+    portEXIT_CRITICAL(&ack_lock);
+    xEventGroupClearBits(forward_events, FORWARD_ACK_BIT);
+}
+
+// Await msg_id from now on, or stop awaiting with FORWARD_AWAIT_NONE; counts a PUBACK that came first
+static void await_msg_id(int msg_id) {
+    bool acked = false;
+    portENTER_CRITICAL(&ack_lock);
+    for (size_t i = 0; i < early_ack_count; i++) {
+        acked = acked || (early_acks[i] == msg_id);
+    }
+    awaited_msg_id = msg_id;
+    early_ack_count = 0;
+    portEXIT_CRITICAL(&ack_lock);
+    if (acked) {
+        xEventGroupSetBits(forward_events, FORWARD_ACK_BIT);
+    }
+}
+
+// Wait for the PUBACK of the awaited message; false on timeout or when the session drops
+static bool wait_ack(void) {
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)FORWARD_ACK_TIMEOUT_MS * 1000;
+    while (1) {
+        int64_t left_us = deadline_us - esp_timer_get_time();
+        if (left_us <= 0) {
+            return false;
+        }
+        EventBits_t bits = xEventGroupWaitBits(forward_events, FORWARD_ACK_BIT, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(left_us / 1000) + 1);
+        if (!(bits & FORWARD_RUN_BIT)) {
+            return false;
+        }
+        if (bits & FORWARD_ACK_BIT) {
+            return true;
+        }
+    }
+}
+
+// Publish the chunk at QoS 1 and move the cursor past it once the broker has it
+static bool send_chunk(void) {
+    chunk.payload[chunk.len++] = (forward_format == MQTT_PAYLOAD_CBOR) ? MQTT_PAYLOAD_CBOR_BATCH_CLOSE : ']';
+
+    char topic[ENVILOG_MQTT_TOPIC_MAX_LEN];
+    snprintf(topic, sizeof(topic), "%s/%s/%lu", ENVILOG_MQTT_TOPIC_FORWARD, chunk.source, chunk.boot);
+
+    await_publish();
+    int msg_id = mqtt_publish(topic, chunk.payload, chunk.len, 1, 0, NULL);
+    if (msg_id < 0) {
+        await_msg_id(FORWARD_AWAIT_NONE);
+        portENTER_CRITICAL(&stats_lock);
+        stats.publish_errors++;
+        portEXIT_CRITICAL(&stats_lock);
+        ERROR_LOG_WARNING(TAG, ESP_FAIL, ERROR_CAT_COMMUNICATION, "Failed to forward to %s", topic);
+        return false;
+    }
+    await_msg_id(msg_id);
+    bool acked = wait_ack();
+    await_msg_id(FORWARD_AWAIT_NONE);
+    if (!acked) {
+        portENTER_CRITICAL(&stats_lock);
+        stats.ack_timeouts++;
+        portEXIT_CRITICAL(&stats_lock);
+        ERROR_LOG_WARNING(TAG, ESP_ERR_TIMEOUT, ERROR_CAT_COMMUNICATION,
+            "No acknowledgement for %s, msg_id=%d", topic, msg_id);
+        return false;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.messages++;
+    stats.samples += chunk.count;
+    portEXIT_CRITICAL(&stats_lock);
+    cursor = chunk.end;
+    save_cursor();
+    chunk.len = 0;
+    chunk.count = 0;
+
+    // Spread the backlog so the broker sees at most ENVILOG_MQTT_FORWARD_RATE messages a second
+    vTaskDelay(pdMS_TO_TICKS(1000 / ENVILOG_MQTT_FORWARD_RATE));
+    return true;
+}
+
+// Encode a sample after the chunk's items; false if it would not fit
+static bool chunk_add(const sensor_sample_t *sample, uint64_t timestamp_ms) {
+    // Array opener or JSON comma in front, the last byte kept for the closer
+    size_t offset = chunk.len + ((chunk.count == 0 || forward_format == MQTT_PAYLOAD_JSON) ? 1 : 0);
+    if (offset >= ENVILOG_MQTT_FORWARD_BYTES - 1) {
+        return false;
+    }
+    size_t len = mqtt_payload_encode_sample_as(forward_format, chunk.payload + offset,
+                                               ENVILOG_MQTT_FORWARD_BYTES - 1 - offset, sample, timestamp_ms);
+    if (len == 0) {
+        return false;
+    }
+
+    if (chunk.count == 0) {
+        chunk.payload[0] = (forward_format == MQTT_PAYLOAD_CBOR) ? MQTT_PAYLOAD_CBOR_BATCH_OPEN : '[';
+    } else if (offset > chunk.len) {
+        chunk.payload[chunk.len] = ',';
+    }
+    chunk.len = offset + len;
+    chunk.count++;
+    return true;
+}
+
+// Forward every unsent sample after the cursor; true once the store is drained
+static bool drain(void) {
+    // Samples still buffered in RAM become readable records
+    sample_store_flush();
+
+    sample_store_stats_t store;
+    if (sample_store_get_stats(&store) != ESP_OK) {
+        return false;
+    }
+    if (cursor.seq > store.next_seq) {
+        // The partition was erased, its sequence numbers restarted
+        cursor = (forward_cursor_t){0};
+    }
+
+    // A chunk left by an interrupted drain is rebuilt from the cursor
+    chunk.len = 0;
+    chunk.count = 0;
+    forward_cursor_t pos = cursor;
+    uint64_t now_ms = esp_timer_get_time() / 1000;
+
+    while (session_up()) {
+        esp_err_t ret = sample_store_read(pos.seq, record);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            break;
+        }
+        if (ret != ESP_OK) {
+            return false;
+        }
+        if (record->seq != pos.seq) {
+            // Records in between were evicted, or their pages torn
+            pos = (forward_cursor_t){ .seq = record->seq };
+        }
+
+        // A message carries one source and boot, the topic names both
+        if (chunk.count > 0 && (chunk.boot != record->boot || strcmp(chunk.source, record->source) != 0)) {
+            if (!send_chunk()) {
+                return false;
+            }
+        }
+
+        ts_block_decoder_t decoder;
+        if (ts_block_decoder_init(&decoder, record->block, SAMPLE_STORE_BLOCK_SIZE) == ESP_OK) {
+            sensor_sample_t sample;
+            for (uint16_t i = 0; ts_block_decode_next(&decoder, &sample); i++) {
+                if (i < pos.index || !(sample.flags & SENSOR_SAMPLE_UNSENT)) {
+                    continue;
+                }
+                // Timestamps of earlier boots stay relative to their boot
+                uint64_t timestamp_ms = (record->boot == store.boot) ?
+                                        sensor_sample_time_ms(&sample, now_ms) : sample.timestamp_ms;
+                if (chunk.count == 0) {
+                    memcpy(chunk.source, record->source, sizeof(chunk.source));
+                    chunk.boot = record->boot;
+                }
+                if (!chunk_add(&sample, timestamp_ms)) {
+                    chunk.end = (forward_cursor_t){ .seq = record->seq, .index = i };
+                    if (!send_chunk()) {
+                        return false;
+                    }
+                    chunk_add(&sample, timestamp_ms);
+                }
+            }
+        }
+
+        pos = (forward_cursor_t){ .seq = record->seq + 1 };
+        chunk.end = pos;
+    }
+
+    if (!session_up()) {
+        return false;
+    }
+    if (chunk.count > 0) {
+        return send_chunk();
+    }
+    if (pos.seq != cursor.seq || pos.index != cursor.index) {
+        // Only samples the live uplink already had were passed
+        cursor = pos;
+        save_cursor();
+    }
+    return true;
+}
+
+static void mqtt_forward_task(void *pvParameters) {
+    while (1) {
+        xEventGroupWaitBits(forward_events, FORWARD_START_BIT, pdTRUE, pdFALSE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&stats_lock);
+        stats.drains++;
+        stats.active = true;
+        uint32_t messages = stats.messages;
+        portEXIT_CRITICAL(&stats_lock);
+        bool drained = drain();
+        portENTER_CRITICAL(&stats_lock);
+        stats.active = false;
+        portEXIT_CRITICAL(&stats_lock);
+
+        if (stats.messages != messages) {
+            ESP_LOGI(TAG, "Forwarded %lu messages%s", stats.messages - messages,
+                     drained ? ", backlog drained" : "");
+        }
+        if (!drained && session_up()) {
+            // Lost acknowledgement on a live session, resume later from the saved cursor
+            vTaskDelay(pdMS_TO_TICKS(FORWARD_RETRY_MS));
+            if (session_up()) {
+                xEventGroupSetBits(forward_events, FORWARD_START_BIT);
+            }
+        }
+    }
+}
+
+void mqtt_forward_connected(uint8_t format) {
+    forward_format = format;
+    if (forward_events != NULL) {
+        xEventGroupSetBits(forward_events, FORWARD_RUN_BIT | FORWARD_START_BIT);
+    }
+}
+
+void mqtt_forward_disconnected(void) {
+    if (forward_events != NULL) {
+        xEventGroupClearBits(forward_events, FORWARD_RUN_BIT);
+        xEventGroupSetBits(forward_events, FORWARD_ACK_BIT);
+    }
+}
+
+void mqtt_forward_published(int msg_id) {
+    if (forward_events == NULL) {
+        return;
+    }
+
+    // Other QoS 1 messages are acknowledged too; only the awaited one ends the wait
+    bool awaited = false;
+    portENTER_CRITICAL(&ack_lock);
+    if (awaited_msg_id == FORWARD_AWAIT_PUBLISH) {
+        if (early_ack_count < FORWARD_EARLY_ACKS) {
+            early_acks[early_ack_count++] = msg_id;
+        }
+    } else {
+        awaited = (msg_id == awaited_msg_id);
+    }
+    portEXIT_CRITICAL(&ack_lock);
+    if (awaited) {
+        xEventGroupSetBits(forward_events, FORWARD_ACK_BIT);
+    }
+}
+
+esp_err_t envilog_mqtt_start_forward(void) {
+    if (forward_events != NULL) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = nvs_open(FORWARD_NVS_NAMESPACE, NVS_READWRITE, &cursor_nvs);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_STORAGE, "Failed to open forward cursor namespace");
+        return ret;
+    }
+    size_t size = sizeof(cursor);
+    if (nvs_get_blob(cursor_nvs, FORWARD_NVS_KEY_CURSOR, &cursor, &size) != ESP_OK || size != sizeof(cursor)) {
+        cursor = (forward_cursor_t){0};
+    }
+    stats.cursor_seq = cursor.seq;
+    stats.cursor_index = cursor.index;
+
+    record = malloc(sizeof(*record));
+    chunk.payload = malloc(ENVILOG_MQTT_FORWARD_BYTES);
+    forward_events = xEventGroupCreate();
+    if (record == NULL || chunk.payload == NULL || forward_events == NULL ||
+        xTaskCreate(mqtt_forward_task, "mqtt_forward", TASK_STACK_SIZE_MQTT,
+                    NULL, TASK_PRIORITY_DATA_PROCESSING, NULL) != pdPASS) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to start MQTT forwarding");
+        free(record);
+        free(chunk.payload);
+        record = NULL;
+        chunk.payload = NULL;
+        if (forward_events != NULL) {
+            vEventGroupDelete(forward_events);
+            forward_events = NULL;
+        }
+        nvs_close(cursor_nvs);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The session may have come up before the store was ready
+    if (envilog_mqtt_is_connected()) {
+        xEventGroupSetBits(forward_events, FORWARD_RUN_BIT | FORWARD_START_BIT);
+    }
+
+    ESP_LOGI(TAG, "Forwarding from record %lu, sample %u", cursor.seq, cursor.index);
+    return ESP_OK;
+}
+
+esp_err_t envilog_mqtt_get_forward_stats(envilog_mqtt_forward_stats_t *out) {
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (forward_events == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Hooks of the store-and-forward drain, called from the MQTT event handler.
+ * They do nothing until envilog_mqtt_start_forward().
+ */
+
+/**
+ * @brief Broker session established, start a drain in the given payload format
+ */
+void mqtt_forward_connected(uint8_t format);
+
+/**
+ * @brief Broker session lost, abandon the drain at the last acknowledged message
+ */
+void mqtt_forward_disconnected(void);
+
+/**
+ * @brief A QoS 1 publish was acknowledged by the broker
+ */
+void mqtt_forward_published(int msg_id);
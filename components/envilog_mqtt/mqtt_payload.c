@@ -0,0 +1,188 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mqtt_payload.h"
+#include "sensor_filter.h"
+
+// CBOR major types
+#define CBOR_UINT   0
+#define CBOR_NINT   1
+#define CBOR_TEXT   3
+#define CBOR_ARRAY  4
+#define CBOR_MAP    5
+
+// Output cursor; len keeps counting past size so one check at the end catches overflow
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+} cbor_writer_t;
+
+static void put_byte(cbor_writer_t *w, uint8_t byte) {
+    if (w->len < w->size) {
+        w->buf[w->len] = byte;
+    }
+    w->len++;
+}
+
+// Initial byte plus the shortest big-endian argument
+static void put_head(cbor_writer_t *w, uint8_t major, uint64_t value) {
+    uint8_t type = major << 5;
+    int bytes;
+    if (value < 24) {
+        put_byte(w, type | (uint8_t)value);
+        return;
+    } else if (value <= UINT8_MAX) {
+        put_byte(w, type | 24);
+        bytes = 1;
+    } else if (value <= UINT16_MAX) {
+        put_byte(w, type | 25);
+        bytes = 2;
+    } else if (value <= UINT32_MAX) {
+        put_byte(w, type | 26);
+        bytes = 4;
+    } else {
+        put_byte(w, type | 27);
+        bytes = 8;
+    }
+    for (int i = bytes - 1; i >= 0; i--) {
+        put_byte(w, (uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void put_int(cbor_writer_t *w, int32_t value) {
+    if (value < 0) {
+        put_head(w, CBOR_NINT, (uint64_t)(-1 - (int64_t)value));
+    } else {
+        put_head(w, CBOR_UINT, (uint64_t)value);
+    }
+}
+
+static void put_text(cbor_writer_t *w, const char *text) {
+    size_t len = strlen(text);
+    put_head(w, CBOR_TEXT, len);
+    for (size_t i = 0; i < len; i++) {
+        put_byte(w, (uint8_t)text[i]);
+    }
+}
+
+static void put_summary(cbor_writer_t *w, const data_manager_channel_summary_t *summary) {
+    put_head(w, CBOR_ARRAY, 3 + DATA_MANAGER_QUANTILES);
+    put_int(w, summary->min);
+    put_int(w, summary->max);
+    put_int(w, summary->mean);
+    for (int i = 0; i < DATA_MANAGER_QUANTILES; i++) {
+        put_int(w, summary->quantiles[i]);
+    }
+}
+
+static size_t writer_result(const cbor_writer_t *w) {
+    return w->len <= w->size ? w->len : 0;
+}
+
+size_t mqtt_payload_encode_sample(uint8_t *buf, size_t size, const sensor_sample_t *sample,
+                                  uint64_t timestamp_ms) {
+    if (buf == NULL || sample == NULL) {
+        return 0;
+    }
+
+    cbor_writer_t w = { .buf = buf, .size = size };
+    bool filtered = sample->filter != SENSOR_FILTER_NONE;
+
+    put_head(&w, CBOR_MAP, filtered ? 6 : 3);
+    put_head(&w, CBOR_UINT, 0);
+    put_head(&w, CBOR_UINT, timestamp_ms);
+    put_head(&w, CBOR_UINT, 1);
+    put_int(&w, sample->temperature);
+    put_head(&w, CBOR_UINT, 2);
+    put_int(&w, sample->humidity);
+    if (filtered) {
+        put_head(&w, CBOR_UINT, 3);
+        put_int(&w, sample->temperature_filtered);
+        put_head(&w, CBOR_UINT, 4);
+        put_int(&w, sample->humidity_filtered);
+        put_head(&w, CBOR_UINT, 5);
+        put_text(&w, sensor_filter_type_name(sample->filter));
+    }
+    return writer_result(&w);
+}
+
+size_t mqtt_payload_format_sample_json(char *buf, size_t size, const sensor_sample_t *sample,
+                                       uint64_t timestamp_ms) {
+    if (buf == NULL || sample == NULL) {
+        return 0;
+    }
+
+    int len = snprintf(buf, size,
+                       "{\"temperature\":" SENSOR_CENTI_FMT ",\"humidity\":" SENSOR_CENTI_FMT ",\"timestamp\":%" PRIu64,
+                       SENSOR_CENTI_ARGS(sample->temperature), SENSOR_CENTI_ARGS(sample->humidity),
+                       timestamp_ms);
+
+    // Filtered values ride along until consumers stop using the raw ones
+    if (sample->filter != SENSOR_FILTER_NONE && len > 0 && (size_t)len < size) {
+        len += snprintf(buf + len, size - len,
+                        ",\"temperature_filtered\":" SENSOR_CENTI_FMT ",\"humidity_filtered\":" SENSOR_CENTI_FMT
+                        ",\"filter\":\"%s\"",
+                        SENSOR_CENTI_ARGS(sample->temperature_filtered),
+                        SENSOR_CENTI_ARGS(sample->humidity_filtered),
+                        sensor_filter_type_name(sample->filter));
+    }
+    if (len > 0 && (size_t)len + 1 < size) {
+        buf[len++] = '}';
+        buf[len] = '\0';
+        return len;
+    }
+    return 0;
+}
+
+size_t mqtt_payload_format_summary_json(char *buf, size_t size, const data_manager_channel_summary_t *summary) {
+    static const uint8_t percents[DATA_MANAGER_QUANTILES] = DATA_MANAGER_QUANTILE_PERCENTS;
+    if (buf == NULL || summary == NULL) {
+        return 0;
+    }
+
+    int len = snprintf(buf, size,
+                       "{\"min\":" SENSOR_CENTI_FMT ",\"max\":" SENSOR_CENTI_FMT ",\"mean\":" SENSOR_CENTI_FMT,
+                       SENSOR_CENTI_ARGS(summary->min), SENSOR_CENTI_ARGS(summary->max),
+                       SENSOR_CENTI_ARGS(summary->mean));
+    for (int i = 0; i < DATA_MANAGER_QUANTILES && len > 0 && (size_t)len < size; i++) {
+        len += snprintf(buf + len, size - len, ",\"p%u\":" SENSOR_CENTI_FMT,
+                        percents[i], SENSOR_CENTI_ARGS(summary->quantiles[i]));
+    }
+    if (len > 0 && (size_t)len + 1 < size) {
+        buf[len++] = '}';
+        buf[len] = '\0';
+        return len;
+    }
+    return 0;
+}
+
+size_t mqtt_payload_encode_sample_as(uint8_t format, char *buf, size_t size, const sensor_sample_t *sample,
+                                     uint64_t timestamp_ms) {
+    if (format == MQTT_PAYLOAD_CBOR) {
+        return mqtt_payload_encode_sample((uint8_t *)buf, size, sample, timestamp_ms);
+    }
+    return mqtt_payload_format_sample_json(buf, size, sample, timestamp_ms);
+}
+
+size_t mqtt_payload_encode_rollup(uint8_t *buf, size_t size, const data_manager_rollup_t *rollup) {
+    if (buf == NULL || rollup == NULL) {
+        return 0;
+    }
+
+    cbor_writer_t w = { .buf = buf, .size = size };
+
+    put_head(&w, CBOR_MAP, 5);
+    put_head(&w, CBOR_UINT, 0);
+    put_head(&w, CBOR_UINT, rollup->start_ms);
+    put_head(&w, CBOR_UINT, 1);
+    put_summary(&w, &rollup->temperature);
+    put_head(&w, CBOR_UINT, 2);
+    put_summary(&w, &rollup->humidity);
+    put_head(&w, CBOR_UINT, 6);
+    put_head(&w, CBOR_UINT, rollup->resolution_ms / 1000);
+    put_head(&w, CBOR_UINT, 7);
+    put_head(&w, CBOR_UINT, rollup->count);
+    return writer_result(&w);
+}
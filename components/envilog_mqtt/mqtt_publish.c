@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "envilog_mqtt.h"
+#include "envilog_config.h"
+#include "data_manager.h"
+#include "mqtt_publish.h"
+
+static SemaphoreHandle_t publish_mutex = NULL;
+static esp_mqtt_client_handle_t client = NULL;
+static bool client_v5 = false;
+static volatile uint32_t session_generation = 0;    // Bumped per session, read under publish_mutex
+static char firmware[16];
+static envilog_mqtt_publish_stats_t stats = {0};
+
+static size_t varint_len(size_t value) {
+    size_t len = 1;
+    while (value >= 128) {
+        value >>= 7;
+        len++;
+    }
+    return len;
+}
+
+// PUBLISH packet size: fixed header, topic, packet id, properties and payload
+static size_t publish_wire_len(size_t topic_len, int qos, bool v5, size_t props_len, size_t payload_len) {
+    size_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + payload_len;
+    if (v5) {
+        remaining += varint_len(props_len) + props_len;
+    }
+    return 1 + varint_len(remaining) + remaining;
+}
+
+#if CONFIG_ENVILOG_MQTT_PROTOCOL_5
+static const char *TAG = "mqtt_publish";
+
+#define SESSION_TOPICS      DATA_MANAGER_MAX_SOURCES        // Topics tracked per session; the alias is index + 1
+#define METADATA_MAX        (2 + SENSOR_SAMPLE_CHANNELS)    // Firmware, source and one unit per channel
+
+// Topic state within one broker session
+typedef struct {
+    char topic[ENVILOG_MQTT_TOPIC_MAX_LEN];
+    bool announced;                 // Source metadata sent
+    bool bound;                     // Alias bound, later messages go without the topic
+} session_topic_t;
+
+static uint32_t table_generation = 0;               // Session the table describes
+static bool aliases_refused = false;                // Broker took no alias this session
+static session_topic_t session_topics[SESSION_TOPICS];
+static size_t session_topic_count = 0;
+
+// Entry of the topic in this session, added while there is room; NULL once the table is full
+static session_topic_t *get_session_topic(const char *topic) {
+    if (table_generation != session_generation) {
+        table_generation = session_generation;
+        aliases_refused = false;
+        for (size_t i = 0; i < session_topic_count; i++) {
+            session_topics[i].announced = false;
+            session_topics[i].bound = false;
+        }
+    }
+
+    for (size_t i = 0; i < session_topic_count; i++) {
+        if (strcmp(session_topics[i].topic, topic) == 0) {
+            return &session_topics[i];
+        }
+    }
+    if (session_topic_count == SESSION_TOPICS || strlen(topic) >= ENVILOG_MQTT_TOPIC_MAX_LEN) {
+        return NULL;
+    }
+    session_topic_t *entry = &session_topics[session_topic_count++];
+    strcpy(entry->topic, topic);
+    entry->announced = false;
+    entry->bound = false;
+    return entry;
+}
+
+// Fixed metadata of a source: firmware version, source id and the unit of each channel
+static size_t source_metadata(const char *source, esp_mqtt5_user_property_item_t *items) {
+    size_t count = 0;
+    items[count++] = (esp_mqtt5_user_property_item_t){ .key = "fw", .value = firmware };
+    items[count++] = (esp_mqtt5_user_property_item_t){ .key = "source", .value = source };
+
+    data_manager_handle_t handle;
+    data_manager_source_info_t info;
+    if (data_manager_find_source(source, &handle) == ESP_OK &&
+        data_manager_get_source_info(handle, &info) == ESP_OK) {
+        for (uint8_t c = 0; c < info.channel_count && count < METADATA_MAX; c++) {
+            items[count++] = (esp_mqtt5_user_property_item_t){
+                .key = info.channels[c].name, .value = info.channels[c].unit };
+        }
+    }
+    return count;
+}
+
+// Set the properties of this message and publish; called with publish_mutex held
+static int publish_v5(const char *topic, const char *data, int len, int qos, int retain,
+                      const mqtt_publish_opts_t *opts, size_t *wire_len) {
+    esp_mqtt5_publish_property_config_t property = {0};
+    session_topic_t *entry = NULL;
+    const char *wire_topic = topic;
+    size_t metadata_len = 0;
+
+    if (opts != NULL) {
+        property.message_expiry_interval = opts->expiry_s;
+        if (opts->source != NULL || (opts->alias && qos == 0)) {
+            entry = get_session_topic(topic);
+        }
+    }
+
+    // QoS 1 and 2 packets are replayed verbatim from the outbox after a
+    // reconnect, when the alias they reference is gone; only QoS 0 uses one
+    if (entry != NULL && opts->alias && qos == 0 && !aliases_refused) {
+        property.topic_alias = (uint16_t)(entry - session_topics) + 1;
+        if (entry->bound) {
+            wire_topic = "";
+        }
+    }
+
+    // Sent once per topic and session, consumers keep it per topic
+    bool metadata = entry != NULL && opts->source != NULL && !entry->announced;
+    if (metadata) {
+        esp_mqtt5_user_property_item_t items[METADATA_MAX];
+        size_t count = source_metadata(opts->source, items);
+        metadata = esp_mqtt5_client_set_user_property(&property.user_property, items, count) == ESP_OK;
+        for (size_t i = 0; metadata && i < count; i++) {
+            metadata_len += 5 + strlen(items[i].key) + strlen(items[i].value);
+        }
+    }
+
+    int msg_id = -1;
+    if (esp_mqtt5_client_set_publish_property(client, &property) == ESP_OK) {
+        msg_id = esp_mqtt_client_publish(client, wire_topic, data, len, qos, retain);
+    }
+    if (msg_id < 0 && property.topic_alias != 0) {
+        // Above the broker's Topic Alias Maximum, which is 0 when its CONNACK has none
+        ESP_LOGW(TAG, "Topic alias %u refused, sending full topics this session", property.topic_alias);
+        aliases_refused = true;
+        property.topic_alias = 0;
+        wire_topic = topic;
+        if (esp_mqtt5_client_set_publish_property(client, &property) == ESP_OK) {
+            msg_id = esp_mqtt_client_publish(client, wire_topic, data, len, qos, retain);
+        }
+    }
+    if (property.user_property != NULL) {
+        esp_mqtt5_client_delete_user_property(property.user_property);
+    }
+
+    if (msg_id >= 0 && entry != NULL) {
+        entry->announced |= metadata;
+        entry->bound |= (property.topic_alias != 0);
+        stats.aliased += (wire_topic[0] == '\0');
+        stats.metadata += metadata;
+    }
+    size_t props_len = (property.message_expiry_interval ? 5 : 0) + (property.topic_alias ? 3 : 0) +
+                       (metadata ? metadata_len : 0);
+    *wire_len = publish_wire_len(strlen(wire_topic), qos, true, props_len, len);
+    return msg_id;
+}
+#endif
+
+esp_err_t mqtt_publish_init(void) {
+    if (publish_mutex == NULL) {
+        publish_mutex = xSemaphoreCreateMutex();
+        if (publish_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    snprintf(firmware, sizeof(firmware), "%d.%d.%d",
+             ENVILOG_VERSION_MAJOR, ENVILOG_VERSION_MINOR, ENVILOG_VERSION_PATCH);
+    return ESP_OK;
+}
+
+void mqtt_publish_set_client(esp_mqtt_client_handle_t new_client, bool v5) {
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    client = new_client;
+    client_v5 = v5;
+    session_generation++;
+    xSemaphoreGive(publish_mutex);
+}
+
+void mqtt_publish_session_start(void) {
+    session_generation++;
+}
+
+int mqtt_publish(const char *topic, const char *data, int len, int qos, int retain,
+                 const mqtt_publish_opts_t *opts) {
+    if (publish_mutex == NULL || topic == NULL || data == NULL) {
+        return -1;
+    }
+
+    int msg_id = -1;
+    size_t wire_len = 0;
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    if (client == NULL) {
+        // Being replaced
+    } else if (client_v5) {
+#if CONFIG_ENVILOG_MQTT_PROTOCOL_5
+        msg_id = publish_v5(topic, data, len, qos, retain, opts, &wire_len);
+#endif
+    } else {
+        msg_id = esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+        wire_len = publish_wire_len(strlen(topic), qos, false, 0, len);
+    }
+
+    if (msg_id >= 0) {
+        stats.messages++;
+        stats.payload_bytes += len;
+        stats.wire_bytes += wire_len;
+    }
+    xSemaphoreGive(publish_mutex);
+    return msg_id;
+}
+
+esp_err_t envilog_mqtt_get_publish_stats(envilog_mqtt_publish_stats_t *out) {
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (publish_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    *out = stats;
+    out->protocol = client_v5 ? 5 : 4;
+    xSemaphoreGive(publish_mutex);
+    return ESP_OK;
+}
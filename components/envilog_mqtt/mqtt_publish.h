@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mqtt_client.h"
+
+/*
+ * Every publish of the component goes through mqtt_publish(). esp-mqtt
+ * takes MQTT 5 publish properties as client state set ahead of the publish
+ * call, so the pair is serialized here; otherwise a publish from one task
+ * could go out with another task's topic alias. Not for the MQTT event
+ * handler: the client task holds its own lock there, and a publisher
+ * holding ours may be waiting for it.
+ */
+
+// Per-message options, only used on MQTT 5 sessions
+typedef struct {
+    const char *source;         // Attach the source metadata to the first message of the topic in a session
+    uint32_t expiry_s;          // Message expiry interval, 0 for none
+    bool alias;                 // Frequent topic, sent with a topic alias when at QoS 0
+} mqtt_publish_opts_t;
+
+/**
+ * @brief Create the publish lock
+ */
+esp_err_t mqtt_publish_init(void);
+
+/**
+ * @brief Set the client publishes go to, NULL while it is being replaced
+ *
+ * Waits for a publish in progress, so the old client can be destroyed
+ * once this returns.
+ *
+ * @param client Client handle
+ * @param v5 Client was configured for MQTT 5
+ */
+void mqtt_publish_set_client(esp_mqtt_client_handle_t client, bool v5);
+
+/**
+ * @brief Broker session established; aliases and metadata start over
+ *
+ * Safe to call from the MQTT event handler.
+ */
+void mqtt_publish_session_start(void);
+
+/**
+ * @brief Publish on the current client
+ *
+ * @param topic Full topic
+ * @param data Payload
+ * @param len Payload length
+ * @param qos QoS level
+ * @param retain Retain flag
+ * @param opts MQTT 5 options, NULL for none
+ * @return int Message id as from esp_mqtt_client_publish(), -1 on failure
+ */
+int mqtt_publish(const char *topic, const char *data, int len, int qos, int retain,
+                 const mqtt_publish_opts_t *opts);
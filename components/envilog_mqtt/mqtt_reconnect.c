@@ -0,0 +1,203 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "mqtt_reconnect.h"
+
+static const char *TAG = "mqtt_reconnect";
+
+static const char *const state_names[] = { "wait_link", "backoff", "connecting", "connected" };
+
+static mqtt_reconnect_config_t config = {0};
+static esp_mqtt_client_handle_t client = NULL;
+static mqtt_reconnect_state_t state = MQTT_RECONNECT_WAIT_LINK;
+static bool client_started = false;     // Started by an attempt and not stopped by us since
+static uint32_t attempt = 0;            // Attempts in the current outage
+static int64_t since_us = 0;            // When a session first became possible
+static int64_t deadline_us = 0;
+static uint32_t jitter_state = 1;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static envilog_mqtt_reconnect_stats_t stats = { .state = "wait_link" };
+
+static uint32_t jitter_next(void) {
+    jitter_state ^= jitter_state << 13;
+    jitter_state ^= jitter_state >> 17;
+    jitter_state ^= jitter_state << 5;
+    return jitter_state;
+}
+
+// Bucket i holds values below 2^i, the last one everything larger
+static size_t log2_bucket(uint32_t value) {
+    size_t bucket = 0;
+    while (bucket < ENVILOG_MQTT_RECONNECT_BUCKETS - 1 && value >= (1u << bucket)) {
+        bucket++;
+    }
+    return bucket;
+}
+
+static void set_state(mqtt_reconnect_state_t next) {
+    state = next;
+    portENTER_CRITICAL(&stats_lock);
+    stats.state = state_names[next];
+    stats.attempt = attempt;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Back to a stopped client; its task may have ended on its own after a drop, which stop reports harmlessly
+static void stop_client(void) {
+    if (client_started) {
+        esp_mqtt_client_stop(client);
+        client_started = false;
+    }
+}
+
+// Full jitter: uniform in [0, min(max, base * 2^attempt)]
+static void schedule(int64_t now_us) {
+    if (attempt == 0) {
+        since_us = now_us;
+    }
+    uint32_t shift = attempt < 20 ? attempt : 20;
+    uint64_t ceiling_ms = (uint64_t)config.backoff_base_ms << shift;
+    if (ceiling_ms > config.backoff_max_ms) {
+        ceiling_ms = config.backoff_max_ms;
+    }
+    uint32_t delay_ms = jitter_next() % (uint32_t)(ceiling_ms + 1);
+    deadline_us = now_us + (int64_t)delay_ms * 1000;
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.last_delay_ms = delay_ms;
+    portEXIT_CRITICAL(&stats_lock);
+    set_state(MQTT_RECONNECT_BACKOFF);
+    ESP_LOGI(TAG, "MQTT reconnect attempt %" PRIu32 " in %" PRIu32 " ms", attempt + 1, delay_ms);
+}
+
+static esp_err_t start_attempt(int64_t now_us) {
+    attempt++;
+    portENTER_CRITICAL(&stats_lock);
+    stats.attempts++;
+    portEXIT_CRITICAL(&stats_lock);
+
+    // Each attempt starts from a stopped client, whatever the last one left behind
+    stop_client();
+    esp_err_t ret = (client != NULL) ? esp_mqtt_client_start(client) : ESP_ERR_INVALID_STATE;
+    if (ret != ESP_OK) {
+        schedule(now_us);
+        return ret;
+    }
+    client_started = true;
+    deadline_us = now_us + (int64_t)config.attempt_timeout_ms * 1000;
+    set_state(MQTT_RECONNECT_CONNECTING);
+    return ESP_OK;
+}
+
+static void established(int64_t now_us) {
+    uint32_t elapsed_ms = (uint32_t)((now_us - since_us) / 1000);
+    portENTER_CRITICAL(&stats_lock);
+    stats.reconnects++;
+    stats.total_ms += elapsed_ms;
+    if (elapsed_ms > stats.longest_ms) {
+        stats.longest_ms = elapsed_ms;
+    }
+    stats.time_buckets[log2_bucket(elapsed_ms / 1000)]++;
+    stats.attempt_buckets[log2_bucket(attempt > 0 ? attempt - 1 : 0)]++;
+    portEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGI(TAG, "MQTT session up after %" PRIu32 " ms, %" PRIu32 " attempts", elapsed_ms, attempt);
+    attempt = 0;
+    set_state(MQTT_RECONNECT_CONNECTED);
+}
+
+void mqtt_reconnect_init(const mqtt_reconnect_config_t *cfg) {
+    config = *cfg;
+    jitter_state = cfg->jitter_seed ? cfg->jitter_seed : 1;
+    attempt = 0;
+    set_state(MQTT_RECONNECT_WAIT_LINK);
+}
+
+void mqtt_reconnect_set_client(esp_mqtt_client_handle_t new_client) {
+    client = new_client;
+    client_started = false;
+}
+
+void mqtt_reconnect_set_attempt_timeout(uint32_t timeout_ms) {
+    config.attempt_timeout_ms = timeout_ms;
+}
+
+bool mqtt_reconnect_link(bool up, int64_t now_us) {
+    if (!up && state != MQTT_RECONNECT_WAIT_LINK) {
+        // The session cannot survive without IP; start clean when the link returns
+        stop_client();
+        attempt = 0;
+        set_state(MQTT_RECONNECT_WAIT_LINK);
+        return true;
+    }
+    if (up && state == MQTT_RECONNECT_WAIT_LINK) {
+        // Jittered too: a site-wide outage brings every device's link back at once
+        schedule(now_us);
+    }
+    return false;
+}
+
+void mqtt_reconnect_session(bool connected, int64_t now_us) {
+    if (state == MQTT_RECONNECT_WAIT_LINK) {
+        return;
+    }
+    if (connected) {
+        if (state != MQTT_RECONNECT_CONNECTED) {
+            established(now_us);
+        }
+    } else if (state == MQTT_RECONNECT_CONNECTED || state == MQTT_RECONNECT_CONNECTING) {
+        schedule(now_us);
+    }
+}
+
+void mqtt_reconnect_retry_now(int64_t now_us) {
+    if (state != MQTT_RECONNECT_WAIT_LINK) {
+        deadline_us = now_us;
+        set_state(MQTT_RECONNECT_BACKOFF);
+    }
+}
+
+void mqtt_reconnect_restart(int64_t now_us) {
+    if (state != MQTT_RECONNECT_WAIT_LINK) {
+        attempt = 0;
+        schedule(now_us);
+    }
+}
+
+esp_err_t mqtt_reconnect_poll(int64_t now_us, int64_t *next_us) {
+    esp_err_t ret = ESP_OK;
+    if (now_us >= deadline_us) {
+        if (state == MQTT_RECONNECT_BACKOFF) {
+            ret = start_attempt(now_us);
+        } else if (state == MQTT_RECONNECT_CONNECTING) {
+            // Stop it now so a late session does not come up during the backoff
+            stop_client();
+            schedule(now_us);
+            ret = ESP_ERR_TIMEOUT;
+        }
+    }
+
+    bool timed = (state == MQTT_RECONNECT_BACKOFF || state == MQTT_RECONNECT_CONNECTING);
+    *next_us = timed ? deadline_us : INT64_MAX;
+    return ret;
+}
+
+mqtt_reconnect_state_t mqtt_reconnect_get_state(void) {
+    return state;
+}
+
+uint32_t mqtt_reconnect_get_attempt(void) {
+    return attempt;
+}
+
+esp_err_t envilog_mqtt_get_reconnect_stats(envilog_mqtt_reconnect_stats_t *out) {
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+#include "envilog_mqtt.h"
+
+/*
+ * Reconnect state machine of the MQTT client. The client runs with
+ * auto-reconnect disabled, so its task ends after a drop and a reconnect
+ * request would be refused; every attempt therefore stops the client and
+ * starts it again. The reconnect task feeds in link and session events
+ * and the time, and sleeps until the returned deadline, so the same code
+ * runs in the host tests against a mock client.
+ */
+
+typedef enum {
+    MQTT_RECONNECT_WAIT_LINK,       // No IP; nothing to do until the link is back
+    MQTT_RECONNECT_BACKOFF,         // Waiting out the jittered delay before the next attempt
+    MQTT_RECONNECT_CONNECTING,      // Attempt issued, waiting for the session
+    MQTT_RECONNECT_CONNECTED,       // Session up
+} mqtt_reconnect_state_t;
+
+typedef struct {
+    uint32_t backoff_base_ms;       // Ceiling of the first delay, doubled per attempt
+    uint32_t backoff_max_ms;        // Largest ceiling
+    uint32_t attempt_timeout_ms;    // Attempt without a session before it is abandoned
+    uint32_t jitter_seed;           // Nonzero seed of the delay generator
+} mqtt_reconnect_config_t;
+
+/**
+ * @brief Set the limits and start over in MQTT_RECONNECT_WAIT_LINK
+ */
+void mqtt_reconnect_init(const mqtt_reconnect_config_t *config);
+
+/**
+ * @brief Set the client attempts start, NULL while it is being replaced
+ *
+ * The client must not be started; the next attempt starts it.
+ */
+void mqtt_reconnect_set_client(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief Change the attempt timeout, taking effect with the next attempt
+ */
+void mqtt_reconnect_set_attempt_timeout(uint32_t timeout_ms);
+
+/**
+ * @brief IP link went up or down
+ *
+ * Losing the link stops the client; its return schedules a jittered attempt.
+ *
+ * @param up Link state
+ * @param now_us Current time
+ * @return bool Whether the loss ended a session or an outage in progress
+ */
+bool mqtt_reconnect_link(bool up, int64_t now_us);
+
+/**
+ * @brief The client connected or disconnected
+ *
+ * @param connected Session state
+ * @param now_us Current time
+ */
+void mqtt_reconnect_session(bool connected, int64_t now_us);
+
+/**
+ * @brief Attempt again at once, e.g. with a client for another protocol version
+ */
+void mqtt_reconnect_retry_now(int64_t now_us);
+
+/**
+ * @brief Start a new outage with a jittered first attempt, e.g. after a config change
+ */
+void mqtt_reconnect_restart(int64_t now_us);
+
+/**
+ * @brief Run the attempt or timeout that is due
+ *
+ * @param now_us Current time
+ * @param deadline_us Time of the next step, INT64_MAX when only events move the state
+ * @return esp_err_t ESP_OK, ESP_ERR_TIMEOUT if an attempt was abandoned, or the error
+ *         of a client that failed to start; either way the next attempt is scheduled
+ */
+esp_err_t mqtt_reconnect_poll(int64_t now_us, int64_t *deadline_us);
+
+/**
+ * @brief Current state
+ */
+mqtt_reconnect_state_t mqtt_reconnect_get_state(void);
+
+/**
+ * @brief Attempts in the current outage
+ */
+uint32_t mqtt_reconnect_get_attempt(void);
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "unity.h"
+#include "mqtt_payload.h"
+#include "sensor_filter.h"
+
+/*
+ * Size and encode time of the JSON and CBOR sample payloads, plus the
+ * CBOR rollup and batch sizes. The sample is one from a day-old boot
+ * (timestamp 123456789 ms), so the JSON timestamp has its usual width.
+ */
+
+#define BENCH_ROUNDS        200000
+#define BENCH_TIMESTAMP_MS  123456789ULL
+
+static sensor_sample_t bench_sample(uint8_t filter) {
+    sensor_sample_t sample = {
+        .temperature = 2350,
+        .humidity = 4512,
+        .temperature_filtered = 2348,
+        .humidity_filtered = 4500,
+        .timestamp_ms = (uint32_t)BENCH_TIMESTAMP_MS,
+        .flags = SENSOR_SAMPLE_VALID,
+        .filter = filter,
+    };
+    return sample;
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+// ns per encode, varying the temperature so the work is not hoisted out of the loop
+static double time_encode(uint8_t format, sensor_sample_t sample, unsigned *sink) {
+    char buf[MQTT_PAYLOAD_SAMPLE_MAX * 4];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        sample.temperature = 2350 + (i & 7);
+        *sink += mqtt_payload_encode_sample_as(format, buf, sizeof(buf), &sample, BENCH_TIMESTAMP_MS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsed_ns(&start, &end) / BENCH_ROUNDS;
+}
+
+TEST_CASE("CBOR sample follows the documented map", "[mqtt_payload]") {
+    sensor_sample_t sample = bench_sample(SENSOR_FILTER_NONE);
+    sample.temperature = -5;
+    uint8_t buf[MQTT_PAYLOAD_SAMPLE_MAX];
+    size_t len = mqtt_payload_encode_sample(buf, sizeof(buf), &sample, 5000000000ULL);
+
+    // {0: 5000000000, 1: -5, 2: 4512}
+    static const uint8_t expected[] = {
+        0xA3, 0x00, 0x1B, 0x00, 0x00, 0x00, 0x01, 0x2A, 0x05, 0xF2, 0x00,
+        0x01, 0x24, 0x02, 0x19, 0x11, 0xA0,
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buf, sizeof(expected));
+
+    // Too small a buffer writes nothing usable and says so
+    TEST_ASSERT_EQUAL(0, mqtt_payload_encode_sample(buf, len - 1, &sample, 5000000000ULL));
+}
+
+TEST_CASE("filtered samples stay within MQTT_PAYLOAD_SAMPLE_MAX", "[mqtt_payload]") {
+    sensor_sample_t sample = bench_sample(SENSOR_FILTER_MEDIAN);
+    sample.temperature = sample.temperature_filtered = INT16_MIN;
+    sample.humidity = sample.humidity_filtered = INT16_MIN;
+    uint8_t buf[MQTT_PAYLOAD_SAMPLE_MAX];
+    TEST_ASSERT_NOT_EQUAL(0, mqtt_payload_encode_sample(buf, sizeof(buf), &sample, UINT64_MAX));
+}
+
+TEST_CASE("rollup summaries format as one JSON object", "[mqtt_payload]") {
+    const data_manager_channel_summary_t summary = {
+        .min = INT16_MIN, .max = INT16_MIN, .mean = INT16_MIN, .quantiles = { INT16_MIN, INT16_MIN, INT16_MIN },
+    };
+    char json[MQTT_PAYLOAD_SUMMARY_JSON_MAX];
+    size_t len = mqtt_payload_format_summary_json(json, sizeof(json), &summary);
+    TEST_ASSERT_EQUAL(strlen(json), len);
+    TEST_ASSERT_EQUAL_STRING("{\"min\":-327.68,\"max\":-327.68,\"mean\":-327.68,"
+                             "\"p5\":-327.68,\"p50\":-327.68,\"p95\":-327.68}", json);
+    TEST_ASSERT_EQUAL(0, mqtt_payload_format_summary_json(json, len, &summary));
+
+    const data_manager_channel_summary_t typical = {
+        .min = 2210, .max = 2405, .mean = -5, .quantiles = { 2220, 2300, 2400 },
+    };
+    mqtt_payload_format_summary_json(json, sizeof(json), &typical);
+    TEST_ASSERT_EQUAL_STRING("{\"min\":22.10,\"max\":24.05,\"mean\":-0.05,"
+                             "\"p5\":22.20,\"p50\":23.00,\"p95\":24.00}", json);
+}
+
+TEST_CASE("JSON and CBOR payload size and encode time", "[mqtt_payload][bench]") {
+    unsigned sink = 0;
+    char json[160];
+    uint8_t cbor[MQTT_PAYLOAD_SAMPLE_MAX];
+
+    printf("%-22s %6s %7s %8s %7s\n", "", "JSON B", "ns", "CBOR B", "ns");
+    static const uint8_t filters[] = { SENSOR_FILTER_NONE, SENSOR_FILTER_MEDIAN };
+    for (size_t f = 0; f < sizeof(filters); f++) {
+        sensor_sample_t sample = bench_sample(filters[f]);
+        size_t json_len = mqtt_payload_format_sample_json(json, sizeof(json), &sample, BENCH_TIMESTAMP_MS);
+        size_t cbor_len = mqtt_payload_encode_sample(cbor, sizeof(cbor), &sample, BENCH_TIMESTAMP_MS);
+        TEST_ASSERT_NOT_EQUAL(0, json_len);
+        TEST_ASSERT_NOT_EQUAL(0, cbor_len);
+        // CBOR carries the same fields in under a third of the bytes
+        TEST_ASSERT_LESS_THAN(json_len / 3, cbor_len);
+
+        double json_ns = time_encode(MQTT_PAYLOAD_JSON, sample, &sink);
+        double cbor_ns = time_encode(MQTT_PAYLOAD_CBOR, sample, &sink);
+        printf("  sample, %-12s %6zu %7.1f %8zu %7.1f\n", sensor_filter_type_name(filters[f]),
+               json_len, json_ns, cbor_len, cbor_ns);
+    }
+
+    data_manager_rollup_t rollup = {
+        .start_ms = 3600000, .resolution_ms = 3600000, .count = 1800, .level = 3,
+        .temperature = { -120, 2400, 1100, { -100, 1000, 2300 } },
+        .humidity = { 3000, 9000, 5000, { 3100, 5000, 8800 } },
+    };
+    uint8_t rollup_buf[MQTT_PAYLOAD_ROLLUP_MAX];
+    size_t rollup_len = mqtt_payload_encode_rollup(rollup_buf, sizeof(rollup_buf), &rollup);
+    TEST_ASSERT_NOT_EQUAL(0, rollup_len);
+    printf("  %-20s %6s %7s %8zu\n", "rollup", "", "", rollup_len);
+
+    // A batch of 15 unfiltered samples, 2 s apart, as batching at N=16, T=30 s sends them
+    char batch[1024];
+    size_t json_batch = 0, cbor_batch = 0;
+    uint8_t cbor_item[MQTT_PAYLOAD_SAMPLE_MAX];
+    sensor_sample_t sample = bench_sample(SENSOR_FILTER_NONE);
+    for (int i = 0; i < 15; i++) {
+        sample.temperature = 2350 + i;
+        uint64_t timestamp_ms = BENCH_TIMESTAMP_MS + i * 2000;
+        json_batch += 1 + mqtt_payload_format_sample_json(batch, sizeof(batch), &sample, timestamp_ms);
+        cbor_batch += mqtt_payload_encode_sample(cbor_item, sizeof(cbor_item), &sample, timestamp_ms);
+    }
+    json_batch += 1;            // '[', the commas and ']'
+    cbor_batch += 2;            // 0x9F and 0xFF
+    printf("  %-20s %6zu %7s %8zu\n", "batch of 15", json_batch, "", cbor_batch);
+    printf("(sink %u)\n", sink);
+}
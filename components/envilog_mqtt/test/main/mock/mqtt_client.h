@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * The part of the esp-mqtt client API that mqtt_publish.c and
+ * mqtt_reconnect.c use, with the same signatures. test_mqtt_publish.c
+ * implements publishing as a broker model that encodes every PUBLISH
+ * packet, test_mqtt_reconnect.c the client task lifecycle, so no client
+ * or broker is needed.
+ */
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client);
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain);
+
+typedef struct mqtt5_user_property_list_t *mqtt5_user_property_handle_t;
+
+typedef struct {
+    const char *key;
+    const char *value;
+} esp_mqtt5_user_property_item_t;
+
+typedef struct {
+    bool payload_format_indicator;
+    uint32_t message_expiry_interval;
+    uint16_t topic_alias;
+    const char *response_topic;
+    const char *correlation_data;
+    uint16_t correlation_data_len;
+    const char *content_type;
+    mqtt5_user_property_handle_t user_property;
+} esp_mqtt5_publish_property_config_t;
+
+esp_err_t esp_mqtt5_client_set_user_property(mqtt5_user_property_handle_t *user_property,
+                                             esp_mqtt5_user_property_item_t item[], uint8_t item_num);
+esp_err_t esp_mqtt5_client_set_publish_property(esp_mqtt_client_handle_t client,
+                                                const esp_mqtt5_publish_property_config_t *property);
+void esp_mqtt5_client_delete_user_property(mqtt5_user_property_handle_t user_property);
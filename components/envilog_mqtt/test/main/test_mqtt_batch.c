@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "mqtt_batch.h"
+#include "mqtt_payload.h"
+#include "sensor_filter.h"
+
+/*
+ * Message rate and latency bound of sample batching over a simulated day,
+ * at N = 16 samples, M = 1024 bytes and T = 30 s. The simulation jumps
+ * between sample times and the flush deadlines, as the mqtt_batch task
+ * wakes at them.
+ */
+
+#define DAY_MS              (24 * 3600 * 1000ULL)
+#define BATCH_N             16
+#define BATCH_M             1024
+#define BATCH_T_MS          30000
+
+static const char *const sources[] = { "dht11", "dht11_1", "dht11_2", "dht11_3" };
+
+static uint32_t published;
+static uint32_t failing;            // Publishes left to fail
+static size_t last_len;
+static char last_payload[BATCH_M];
+
+static esp_err_t record_publish(const char *source, const char *payload, size_t len) {
+    if (failing > 0) {
+        failing--;
+        return ESP_FAIL;
+    }
+    published++;
+    last_len = len;
+    memcpy(last_payload, payload, len);
+    return ESP_OK;
+}
+
+static void init_batching(uint16_t max_samples, size_t max_bytes, uint32_t latency_ms) {
+    mqtt_batch_config_t config = {
+        .max_samples = max_samples,
+        .max_bytes = max_bytes,
+        .latency_ms = latency_ms,
+        .publish = record_publish,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_init(&config));
+    published = 0;
+    failing = 0;
+    last_len = 0;
+}
+
+static sensor_sample_t make_sample(size_t source, uint64_t now_ms, uint8_t filter) {
+    sensor_sample_t sample = {
+        .temperature = 2350 + source,
+        .humidity = 4500,
+        .temperature_filtered = 2349,
+        .humidity_filtered = 4501,
+        .timestamp_ms = (uint32_t)now_ms,
+        .flags = SENSOR_SAMPLE_VALID,
+        .filter = filter,
+    };
+    return sample;
+}
+
+// One day of JSON samples from each probe every period_ms; filtered samples carry three more fields
+static void simulate_day(uint32_t period_ms, size_t probes, uint8_t filter, envilog_mqtt_batch_stats_t *stats) {
+    init_batching(BATCH_N, BATCH_M, BATCH_T_MS);
+
+    uint64_t deadline_ms = 0;
+    bool pending = false;
+    for (uint64_t sample_ms = 0; sample_ms < DAY_MS; sample_ms += period_ms) {
+        // Latency flushes that come due before the next round of samples
+        while (pending && deadline_ms <= sample_ms) {
+            pending = mqtt_batch_flush_expired(deadline_ms, &deadline_ms);
+        }
+        for (size_t p = 0; p < probes; p++) {
+            sensor_sample_t sample = make_sample(p, sample_ms, filter);
+            bool opened;
+            TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add(sources[p], MQTT_PAYLOAD_JSON, &sample, sample_ms, &opened));
+            if (opened || !pending) {
+                pending = mqtt_batch_flush_expired(sample_ms, &deadline_ms);
+            }
+        }
+    }
+    mqtt_batch_get_stats(stats);
+
+    printf("%zu probe(s) @ %lu s, %s: %lu samples -> %lu messages (full %lu, bytes %lu, latency %lu), "
+           "%.2f msg/s saved, wait mean %.1f s max %.1f s\n",
+           probes, (unsigned long)(period_ms / 1000), sensor_filter_type_name(filter),
+           (unsigned long)stats->samples, (unsigned long)stats->messages,
+           (unsigned long)stats->flushed_full, (unsigned long)stats->flushed_bytes,
+           (unsigned long)stats->flushed_latency, (stats->samples - stats->messages) / (DAY_MS / 1000.0),
+           (double)stats->latency_total_ms / stats->samples / 1000, stats->latency_max_ms / 1000.0);
+}
+
+TEST_CASE("batches close on the sample limit", "[mqtt_batch]") {
+    init_batching(3, BATCH_M, BATCH_T_MS);
+    bool opened;
+    for (uint32_t i = 0; i < 3; i++) {
+        sensor_sample_t sample = make_sample(0, i * 2000, SENSOR_FILTER_NONE);
+        TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, i * 2000, &opened));
+        TEST_ASSERT_EQUAL(i == 0, opened);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, published);
+    last_payload[last_len] = '\0';
+    TEST_ASSERT_EQUAL_STRING("[{\"temperature\":23.50,\"humidity\":45.00,\"timestamp\":0},"
+                             "{\"temperature\":23.50,\"humidity\":45.00,\"timestamp\":2000},"
+                             "{\"temperature\":23.50,\"humidity\":45.00,\"timestamp\":4000}]", last_payload);
+}
+
+TEST_CASE("batches close before the byte limit", "[mqtt_batch]") {
+    init_batching(BATCH_N, 128, BATCH_T_MS);
+    bool opened;
+    sensor_sample_t sample = make_sample(0, 0, SENSOR_FILTER_NONE);
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 0, &opened));
+    }
+    // Two 52-byte objects, the comma and the brackets fit in 128 bytes; the third opens a new batch
+    TEST_ASSERT_EQUAL_UINT32(1, published);
+    TEST_ASSERT_EQUAL(107, last_len);
+    TEST_ASSERT_EQUAL('[', last_payload[0]);
+    TEST_ASSERT_EQUAL(']', last_payload[last_len - 1]);
+
+    envilog_mqtt_batch_stats_t stats;
+    mqtt_batch_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.flushed_bytes);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.samples);
+}
+
+TEST_CASE("CBOR batches are indefinite-length arrays", "[mqtt_batch]") {
+    init_batching(2, BATCH_M, BATCH_T_MS);
+    bool opened;
+    sensor_sample_t sample = make_sample(0, 0, SENSOR_FILTER_MEDIAN);
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_CBOR, &sample, 0, &opened));
+    // An open batch keeps its format
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 0, &opened));
+    TEST_ASSERT_EQUAL_UINT32(1, published);
+    TEST_ASSERT_EQUAL_HEX8(MQTT_PAYLOAD_CBOR_BATCH_OPEN, (uint8_t)last_payload[0]);
+    TEST_ASSERT_EQUAL_HEX8(MQTT_PAYLOAD_CBOR_BATCH_CLOSE, (uint8_t)last_payload[last_len - 1]);
+    TEST_ASSERT_EQUAL_HEX8(0xA6, (uint8_t)last_payload[1]);   // Map of six: the sample has a filter
+}
+
+TEST_CASE("the latency bound flushes the oldest sample at T", "[mqtt_batch]") {
+    init_batching(BATCH_N, BATCH_M, BATCH_T_MS);
+    bool opened;
+    uint64_t next_ms = 0;
+    sensor_sample_t sample = make_sample(0, 1000, SENSOR_FILTER_NONE);
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 1000, &opened));
+    TEST_ASSERT_TRUE(opened);
+    TEST_ASSERT_TRUE(mqtt_batch_flush_expired(1000, &next_ms));
+    TEST_ASSERT_EQUAL_UINT64(1000 + BATCH_T_MS, next_ms);
+    TEST_ASSERT_TRUE(mqtt_batch_flush_expired(next_ms - 1, &next_ms));
+    TEST_ASSERT_EQUAL_UINT32(0, published);
+    TEST_ASSERT_FALSE(mqtt_batch_flush_expired(next_ms, &next_ms));
+    TEST_ASSERT_EQUAL_UINT32(1, published);
+
+    envilog_mqtt_batch_stats_t stats;
+    mqtt_batch_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.flushed_latency);
+    TEST_ASSERT_EQUAL_UINT32(BATCH_T_MS, stats.latency_max_ms);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.latency_buckets[ENVILOG_MQTT_BATCH_LATENCY_BUCKETS - 1]);
+}
+
+TEST_CASE("a failed publish drops its samples without a latency", "[mqtt_batch]") {
+    init_batching(3, 128, BATCH_T_MS);
+    bool opened;
+    sensor_sample_t sample = make_sample(0, 0, SENSOR_FILTER_NONE);
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 0, &opened));
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 0, &opened));
+
+    // The third sample closes the first two on bytes and opens the next batch even though the publish fails
+    failing = 1;
+    TEST_ASSERT_EQUAL(ESP_FAIL, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 1000, &opened));
+    TEST_ASSERT_TRUE(opened);
+    TEST_ASSERT_EQUAL_UINT32(0, published);
+
+    envilog_mqtt_batch_stats_t stats;
+    mqtt_batch_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.samples);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.samples_dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.publish_errors);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.messages);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latency_max_ms);
+    for (int i = 0; i < ENVILOG_MQTT_BATCH_LATENCY_BUCKETS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, stats.latency_buckets[i]);
+    }
+
+    // The sample that opened the next batch is delivered with it
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 2000, &opened));
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_batch_add("dht11", MQTT_PAYLOAD_JSON, &sample, 2000, &opened));
+    TEST_ASSERT_EQUAL_UINT32(1, published);
+    mqtt_batch_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.messages);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.samples_dropped);
+    TEST_ASSERT_EQUAL_UINT32(1000, stats.latency_max_ms);
+    TEST_ASSERT_EQUAL_UINT64(1000, stats.latency_total_ms);
+}
+
+TEST_CASE("one unfiltered probe every 2 s for a day", "[mqtt_batch]") {
+    envilog_mqtt_batch_stats_t stats;
+    simulate_day(2000, 1, SENSOR_FILTER_NONE, &stats);
+    TEST_ASSERT_EQUAL_UINT32(43200, stats.samples);
+    TEST_ASSERT_EQUAL_UINT32(2879, stats.messages);
+    // 16 samples take 32 s, so every batch waits out T for its oldest sample
+    TEST_ASSERT_EQUAL_UINT32(stats.messages, stats.flushed_latency);
+    TEST_ASSERT_EQUAL_UINT32(BATCH_T_MS, stats.latency_max_ms);
+    TEST_ASSERT_UINT32_WITHIN(100, 16000, (uint32_t)(stats.latency_total_ms / stats.samples));
+}
+
+TEST_CASE("one filtered probe every 2 s for a day", "[mqtt_batch]") {
+    envilog_mqtt_batch_stats_t stats;
+    simulate_day(2000, 1, SENSOR_FILTER_MEDIAN, &stats);
+    TEST_ASSERT_EQUAL_UINT32(43200, stats.samples);
+    // Seven filtered objects fill M, well inside T
+    TEST_ASSERT_EQUAL_UINT32(6171, stats.messages);
+    TEST_ASSERT_EQUAL_UINT32(stats.messages, stats.flushed_bytes);
+    TEST_ASSERT_LESS_THAN_UINT32(BATCH_T_MS / 2, stats.latency_max_ms);
+}
+
+TEST_CASE("four filtered probes every 2 s for a day", "[mqtt_batch]") {
+    envilog_mqtt_batch_stats_t stats;
+    simulate_day(2000, 4, SENSOR_FILTER_MEDIAN, &stats);
+    TEST_ASSERT_EQUAL_UINT32(172800, stats.samples);
+    TEST_ASSERT_EQUAL_UINT32(24684, stats.messages);
+    // Batches are per source, so each probe fills its own as above
+    TEST_ASSERT_EQUAL_UINT32(stats.messages, stats.flushed_bytes);
+    TEST_ASSERT_LESS_THAN_UINT32(BATCH_T_MS / 2, stats.latency_max_ms);
+    TEST_ASSERT_UINT32_WITHIN(100, 8000, (uint32_t)(stats.latency_total_ms / stats.samples));
+}
+
+TEST_CASE("one unfiltered probe every 10 s for a day", "[mqtt_batch]") {
+    envilog_mqtt_batch_stats_t stats;
+    simulate_day(10000, 1, SENSOR_FILTER_NONE, &stats);
+    TEST_ASSERT_EQUAL_UINT32(8640, stats.samples);
+    TEST_ASSERT_EQUAL_UINT32(2879, stats.messages);
+    TEST_ASSERT_EQUAL_UINT32(BATCH_T_MS, stats.latency_max_ms);
+    TEST_ASSERT_UINT32_WITHIN(100, 20000, (uint32_t)(stats.latency_total_ms / stats.samples));
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "mqtt_publish.h"
+#include "data_manager.h"
+#include "envilog_mqtt.h"
+
+/*
+ * Wire bytes per sample message with MQTT 3.1.1 and MQTT 5, against a
+ * broker model: the mock client encodes each PUBLISH packet as the spec
+ * lays it out (fixed header, topic, packet id, properties, payload) and
+ * keeps the topic aliases of the session as a broker does. Workload:
+ * 1000 single-sample messages on /envilog/diagnostic/dht11 over 10
+ * sessions, with the options envilog_mqtt uses for samples.
+ */
+
+#define BROKER_ALIAS_MAX    10
+#define RUN_MESSAGES        1000
+#define RUN_SESSIONS        10
+#define SAMPLE_TOPIC        "/envilog/diagnostic/dht11"
+
+struct mqtt5_user_property_list_t {
+    size_t count;
+    esp_mqtt5_user_property_item_t items[8];
+};
+
+static struct {
+    bool v5;
+    uint16_t alias_max;                 // Topic Alias Maximum of the CONNACK
+    char aliases[BROKER_ALIAS_MAX + 1][64];
+    esp_mqtt5_publish_property_config_t property;
+    uint64_t wire_bytes;
+    uint32_t packets;
+    uint32_t protocol_errors;           // Empty topic without a bound alias
+} broker;
+
+static const sensor_channel_desc_t channels[] = {
+    { "temperature", "°C", 100 },
+    { "humidity", "%RH", 100 },
+};
+
+esp_err_t data_manager_find_source(const char *name, data_manager_handle_t *handle) {
+    *handle = 0;
+    return strcmp(name, "dht11") == 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t data_manager_get_source_info(data_manager_handle_t handle, data_manager_source_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    info->name = "dht11";
+    info->channels = channels;
+    info->channel_count = 2;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt5_client_set_user_property(mqtt5_user_property_handle_t *user_property,
+                                             esp_mqtt5_user_property_item_t item[], uint8_t item_num) {
+    *user_property = calloc(1, sizeof(**user_property));
+    TEST_ASSERT_NOT_NULL(*user_property);
+    TEST_ASSERT_LESS_OR_EQUAL(8, item_num);
+    (*user_property)->count = item_num;
+    memcpy((*user_property)->items, item, item_num * sizeof(*item));
+    return ESP_OK;
+}
+
+void esp_mqtt5_client_delete_user_property(mqtt5_user_property_handle_t user_property) {
+    free(user_property);
+}
+
+esp_err_t esp_mqtt5_client_set_publish_property(esp_mqtt_client_handle_t client,
+                                                const esp_mqtt5_publish_property_config_t *property) {
+    if (property->topic_alias > broker.alias_max) {
+        return ESP_FAIL;
+    }
+    broker.property = *property;
+    return ESP_OK;
+}
+
+static size_t varint_len(size_t value) {
+    size_t len = 1;
+    while (value >= 128) {
+        value >>= 7;
+        len++;
+    }
+    return len;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain) {
+    size_t props = 0;
+    if (broker.v5) {
+        const esp_mqtt5_publish_property_config_t *p = &broker.property;
+        props += p->message_expiry_interval ? 1 + 4 : 0;
+        props += p->topic_alias ? 1 + 2 : 0;
+        for (size_t i = 0; p->user_property != NULL && i < p->user_property->count; i++) {
+            props += 1 + 2 + strlen(p->user_property->items[i].key) + 2 + strlen(p->user_property->items[i].value);
+        }
+        if (p->topic_alias != 0 && topic[0] != '\0') {
+            strcpy(broker.aliases[p->topic_alias], topic);
+        } else if (topic[0] == '\0' && (p->topic_alias == 0 || broker.aliases[p->topic_alias][0] == '\0')) {
+            broker.protocol_errors++;
+            return -1;
+        }
+    }
+    size_t remaining = 2 + strlen(topic) + (qos > 0 ? 2 : 0) + len + (broker.v5 ? varint_len(props) + props : 0);
+    broker.wire_bytes += 1 + varint_len(remaining) + remaining;
+    broker.packets++;
+    return qos > 0 ? 1 : 0;
+}
+
+static void broker_session(void) {
+    memset(broker.aliases, 0, sizeof(broker.aliases));
+    mqtt_publish_session_start();
+}
+
+// Wire bytes per message of one run, checked against the device-side counter
+static double run(bool v5, int qos, const uint8_t *payload, size_t len, envilog_mqtt_publish_stats_t *delta) {
+    static bool initialized = false;
+    if (!initialized) {
+        TEST_ASSERT_EQUAL(ESP_OK, mqtt_publish_init());
+        initialized = true;
+    }
+
+    broker.v5 = v5;
+    broker.wire_bytes = 0;
+    broker.packets = 0;
+    broker.protocol_errors = 0;
+    mqtt_publish_set_client((esp_mqtt_client_handle_t)&broker, v5);
+
+    envilog_mqtt_publish_stats_t before, after;
+    TEST_ASSERT_EQUAL(ESP_OK, envilog_mqtt_get_publish_stats(&before));
+    const mqtt_publish_opts_t opts = { .source = "dht11", .expiry_s = 600, .alias = true };
+    for (int s = 0; s < RUN_SESSIONS; s++) {
+        broker_session();
+        for (int i = 0; i < RUN_MESSAGES / RUN_SESSIONS; i++) {
+            TEST_ASSERT_GREATER_OR_EQUAL(0, mqtt_publish(SAMPLE_TOPIC, (const char *)payload, len, qos, 0, &opts));
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, envilog_mqtt_get_publish_stats(&after));
+
+    delta->messages = after.messages - before.messages;
+    delta->aliased = after.aliased - before.aliased;
+    delta->metadata = after.metadata - before.metadata;
+    delta->wire_bytes = after.wire_bytes - before.wire_bytes;
+    TEST_ASSERT_EQUAL_UINT32(RUN_MESSAGES, delta->messages);
+    TEST_ASSERT_EQUAL_UINT32(0, broker.protocol_errors);
+    // The device-side count is what the broker model put on the wire
+    TEST_ASSERT_EQUAL_UINT64(broker.wire_bytes, delta->wire_bytes);
+    return (double)delta->wire_bytes / delta->messages;
+}
+
+static const char json_sample[] = "{\"temperature\":23.40,\"humidity\":45.00,\"timestamp\":1234567}";
+static const uint8_t cbor_sample[] = {
+    0xA3, 0x00, 0x1A, 0x00, 0x12, 0xD6, 0x87, 0x01, 0x19, 0x09, 0x24, 0x02, 0x19, 0x11, 0x94,
+};
+
+TEST_CASE("wire bytes per sample with MQTT 3.1.1 and MQTT 5", "[mqtt_publish]") {
+    static const struct {
+        const char *name;
+        bool v5;
+        int qos;
+        double json;            // Wire bytes per message, 58-byte payload
+        double cbor;            // 15-byte payload
+    } cases[] = {
+        { "3.1.1 QoS 1", false, 1, 89.0, 46.0 },
+        { "3.1.1 QoS 0", false, 0, 87.0, 44.0 },
+        { "5 QoS 1 (expiry, metadata)", true, 1, 95.6, 52.6 },
+        { "5 QoS 0 (alias, expiry, metadata)", true, 0, 71.9, 28.9 },
+    };
+    broker.alias_max = BROKER_ALIAS_MAX;
+    envilog_mqtt_publish_stats_t delta;
+
+    printf("%-34s %8s %8s\n", "wire bytes per message", "JSON", "CBOR");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        double json = run(cases[i].v5, cases[i].qos, (const uint8_t *)json_sample, strlen(json_sample), &delta);
+        double cbor = run(cases[i].v5, cases[i].qos, cbor_sample, sizeof(cbor_sample), &delta);
+        printf("%-34s %8.1f %8.1f\n", cases[i].name, json, cbor);
+        TEST_ASSERT_FLOAT_WITHIN(0.05, cases[i].json, json);
+        TEST_ASSERT_FLOAT_WITHIN(0.05, cases[i].cbor, cbor);
+
+        // Metadata once per session; aliases only at QoS 0, bound by the first message of a session
+        TEST_ASSERT_EQUAL_UINT32(cases[i].v5 ? RUN_SESSIONS : 0, delta.metadata);
+        TEST_ASSERT_EQUAL_UINT32(cases[i].v5 && cases[i].qos == 0 ? RUN_MESSAGES - RUN_SESSIONS : 0,
+                                 delta.aliased);
+    }
+}
+
+TEST_CASE("a broker without topic aliases gets full topics", "[mqtt_publish]") {
+    broker.alias_max = 0;
+    envilog_mqtt_publish_stats_t delta;
+    double json = run(true, 0, (const uint8_t *)json_sample, strlen(json_sample), &delta);
+    TEST_ASSERT_EQUAL_UINT32(0, delta.aliased);
+    TEST_ASSERT_EQUAL_UINT32(RUN_SESSIONS, delta.metadata);
+    printf("5 QoS 0, broker alias maximum 0: %.1f wire bytes per message\n", json);
+    // The QoS 0 figure above with the full topic back in every message
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 93.6, json);
+    broker.alias_max = BROKER_ALIAS_MAX;
+}
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "mqtt_reconnect.h"
+
+/*
+ * The reconnect state machine against a model of the esp-mqtt client
+ * task with auto-reconnect disabled: start() is refused while the task
+ * runs, stop() is refused once it has ended, and a dropped session ends
+ * the task on its own. A refused stop() is harmless, a refused start()
+ * is the attempt that never happens. Time only moves when a test
+ * advances it.
+ */
+
+#define BACKOFF_BASE_MS     1000
+#define BACKOFF_MAX_MS      60000
+#define ATTEMPT_TIMEOUT_MS  20000
+
+static struct {
+    bool running;                   // Client task alive, between start() and its end
+    bool refuse;                    // Broker unreachable, attempts end in a disconnect
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t refused_starts;        // start() while the task runs
+} client;
+
+static int64_t now_us;
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t handle) {
+    if (client.running) {
+        client.refused_starts++;
+        return ESP_FAIL;
+    }
+    client.running = true;
+    client.starts++;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t handle) {
+    if (!client.running) {
+        return ESP_FAIL;
+    }
+    client.running = false;
+    client.stops++;
+    return ESP_OK;
+}
+
+static void start_over(void) {
+    const mqtt_reconnect_config_t config = {
+        .backoff_base_ms = BACKOFF_BASE_MS,
+        .backoff_max_ms = BACKOFF_MAX_MS,
+        .attempt_timeout_ms = ATTEMPT_TIMEOUT_MS,
+        .jitter_seed = 0x2545F491,
+    };
+    memset(&client, 0, sizeof(client));
+    now_us = 0;
+    mqtt_reconnect_init(&config);
+    mqtt_reconnect_set_client((esp_mqtt_client_handle_t)&client);
+}
+
+// Sleep until the next deadline as the reconnect task does, then run it
+static esp_err_t wake(void) {
+    int64_t deadline_us;
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_reconnect_poll(now_us, &deadline_us));
+    TEST_ASSERT_TRUE(deadline_us != INT64_MAX);
+    TEST_ASSERT_GREATER_OR_EQUAL(now_us, deadline_us);
+    now_us = deadline_us;
+    return mqtt_reconnect_poll(now_us, &deadline_us);
+}
+
+// The broker answers the attempt in progress
+static void broker_answers(void) {
+    TEST_ASSERT_TRUE(client.running);
+    now_us += 50 * 1000;
+    if (client.refuse) {
+        client.running = false;
+        mqtt_reconnect_session(false, now_us);
+    } else {
+        mqtt_reconnect_session(true, now_us);
+    }
+}
+
+// The session drops; without auto-reconnect the client task ends by itself
+static void broker_drops(void) {
+    TEST_ASSERT_TRUE(client.running);
+    client.running = false;
+    mqtt_reconnect_session(false, now_us);
+}
+
+TEST_CASE("drop, backoff, attempt and connected again", "[mqtt_reconnect]") {
+    start_over();
+    envilog_mqtt_reconnect_stats_t before, after;
+    TEST_ASSERT_EQUAL(ESP_OK, envilog_mqtt_get_reconnect_stats(&before));
+
+    mqtt_reconnect_link(true, now_us);
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_BACKOFF, mqtt_reconnect_get_state());
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTING, mqtt_reconnect_get_state());
+    broker_answers();
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTED, mqtt_reconnect_get_state());
+
+    // Every drop is followed by a session on the first attempt
+    for (int drop = 0; drop < 5; drop++) {
+        now_us += 3600 * 1000000LL;
+        broker_drops();
+        TEST_ASSERT_EQUAL(MQTT_RECONNECT_BACKOFF, mqtt_reconnect_get_state());
+        int64_t dropped_us = now_us;
+        TEST_ASSERT_EQUAL(ESP_OK, wake());
+        TEST_ASSERT_LESS_OR_EQUAL(BACKOFF_BASE_MS * 1000LL, now_us - dropped_us);
+        TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTING, mqtt_reconnect_get_state());
+        broker_answers();
+        TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTED, mqtt_reconnect_get_state());
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, envilog_mqtt_get_reconnect_stats(&after));
+    TEST_ASSERT_EQUAL_UINT32(6, client.starts);
+    TEST_ASSERT_EQUAL_UINT32(0, client.refused_starts);
+    TEST_ASSERT_EQUAL_UINT32(6, after.reconnects - before.reconnects);
+    TEST_ASSERT_EQUAL_UINT32(6, after.attempts - before.attempts);
+    TEST_ASSERT_EQUAL_UINT32(6, after.attempt_buckets[0] - before.attempt_buckets[0]);
+    TEST_ASSERT_EQUAL_STRING("connected", after.state);
+}
+
+TEST_CASE("a timed out attempt stops the client before the next one", "[mqtt_reconnect]") {
+    start_over();
+    mqtt_reconnect_link(true, now_us);
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTING, mqtt_reconnect_get_state());
+
+    // No answer: the client is still mid-connect when the attempt times out
+    int64_t started_us = now_us;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, wake());
+    TEST_ASSERT_EQUAL(ATTEMPT_TIMEOUT_MS * 1000LL, now_us - started_us);
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_BACKOFF, mqtt_reconnect_get_state());
+    TEST_ASSERT_FALSE(client.running);
+    TEST_ASSERT_EQUAL_UINT32(1, client.stops);
+
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTING, mqtt_reconnect_get_state());
+    TEST_ASSERT_EQUAL_UINT32(2, client.starts);
+    broker_answers();
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTED, mqtt_reconnect_get_state());
+    TEST_ASSERT_EQUAL_UINT32(0, client.refused_starts);
+}
+
+TEST_CASE("a disconnect seen before the client task ends", "[mqtt_reconnect]") {
+    start_over();
+    mqtt_reconnect_link(true, now_us);
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    broker_answers();
+
+    // The disconnect event arrives while the client task is still winding down
+    mqtt_reconnect_session(false, now_us);
+    TEST_ASSERT_TRUE(client.running);
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    TEST_ASSERT_EQUAL_UINT32(0, client.refused_starts);
+    TEST_ASSERT_EQUAL_UINT32(1, client.stops);
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTING, mqtt_reconnect_get_state());
+    broker_answers();
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTED, mqtt_reconnect_get_state());
+}
+
+TEST_CASE("link loss stops the client until the link returns", "[mqtt_reconnect]") {
+    start_over();
+    mqtt_reconnect_link(true, now_us);
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    broker_answers();
+
+    TEST_ASSERT_TRUE(mqtt_reconnect_link(false, now_us));
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_WAIT_LINK, mqtt_reconnect_get_state());
+    TEST_ASSERT_FALSE(client.running);
+    int64_t deadline_us;
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_reconnect_poll(now_us, &deadline_us));
+    TEST_ASSERT_TRUE(deadline_us == INT64_MAX);
+    TEST_ASSERT_FALSE(mqtt_reconnect_link(false, now_us));
+
+    now_us += 600 * 1000000LL;
+    TEST_ASSERT_FALSE(mqtt_reconnect_link(true, now_us));
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    broker_answers();
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTED, mqtt_reconnect_get_state());
+    TEST_ASSERT_EQUAL_UINT32(2, client.starts);
+    TEST_ASSERT_EQUAL_UINT32(0, client.refused_starts);
+}
+
+TEST_CASE("backoff ceiling doubles per attempt up to the maximum", "[mqtt_reconnect]") {
+    start_over();
+    client.refuse = true;
+    mqtt_reconnect_link(true, now_us);
+
+    envilog_mqtt_reconnect_stats_t stats;
+    for (uint32_t attempt = 0; attempt < 12; attempt++) {
+        TEST_ASSERT_EQUAL(MQTT_RECONNECT_BACKOFF, mqtt_reconnect_get_state());
+        TEST_ASSERT_EQUAL(ESP_OK, envilog_mqtt_get_reconnect_stats(&stats));
+        uint64_t ceiling_ms = (uint64_t)BACKOFF_BASE_MS << attempt;
+        TEST_ASSERT_LESS_OR_EQUAL(ceiling_ms < BACKOFF_MAX_MS ? ceiling_ms : BACKOFF_MAX_MS, stats.last_delay_ms);
+        TEST_ASSERT_EQUAL(ESP_OK, wake());
+        broker_answers();
+    }
+    TEST_ASSERT_EQUAL_UINT32(12, mqtt_reconnect_get_attempt());
+
+    client.refuse = false;
+    TEST_ASSERT_EQUAL(ESP_OK, wake());
+    broker_answers();
+    TEST_ASSERT_EQUAL(MQTT_RECONNECT_CONNECTED, mqtt_reconnect_get_state());
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt_reconnect_get_attempt());
+    TEST_ASSERT_EQUAL_UINT32(0, client.refused_starts);
+}
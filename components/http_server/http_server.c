@@ -1,3 +1,5 @@
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_vfs.h"
@@ -12,6 +14,11 @@
 #include "system_manager.h"
 #include <sys/stat.h>
 #include "data_manager.h"
+#include "sample_store.h"
+#include "envilog_mqtt.h"
+#include "mqtt_payload.h"
+#include "envilog_config.h"
+#include "sensor_filter.h"
 #include "esp_spiffs.h"
 #include "error_handler.h"
 #include "mdns.h"
@@ -28,7 +35,15 @@ static esp_err_t get_network_config_handler(httpd_req_t *req);
 static esp_err_t get_mqtt_config_handler(httpd_req_t *req);
 static esp_err_t update_network_config_handler(httpd_req_t *req);
 static esp_err_t update_mqtt_config_handler(httpd_req_t *req);
+static esp_err_t sensor_list_handler(httpd_req_t *req);
 static esp_err_t sensor_data_handler(httpd_req_t *req);
+static esp_err_t sensor_diagnostics_handler(httpd_req_t *req);
+static esp_err_t sensor_history_handler(httpd_req_t *req);
+static esp_err_t sensor_archive_handler(httpd_req_t *req);
+static esp_err_t sensor_rollup_handler(httpd_req_t *req);
+static esp_err_t subscriber_diagnostics_handler(httpd_req_t *req);
+static esp_err_t store_diagnostics_handler(httpd_req_t *req);
+static esp_err_t mqtt_diagnostics_handler(httpd_req_t *req);
 
 static esp_err_t init_spiffs(void) {
     ESP_LOGI(TAG, "Initializing SPIFFS");
@@ -70,11 +85,59 @@ static esp_err_t init_spiffs(void) {
 /* URI Handler Configuration */
 static const httpd_uri_t uri_handlers[] = {
     {
-        .uri = "/api/v1/sensors/dht11",
+        .uri = "/api/v1/sensors",
+        .method = HTTP_GET,
+        .handler = sensor_list_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/sensors/*",
         .method = HTTP_GET,
         .handler = sensor_data_handler,
         .user_ctx = NULL
     },
+    {
+        .uri = "/api/v1/diagnostics/sensors/*",
+        .method = HTTP_GET,
+        .handler = sensor_diagnostics_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/diagnostics/subscribers",
+        .method = HTTP_GET,
+        .handler = subscriber_diagnostics_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/diagnostics/store",
+        .method = HTTP_GET,
+        .handler = store_diagnostics_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/diagnostics/mqtt",
+        .method = HTTP_GET,
+        .handler = mqtt_diagnostics_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/history/*",
+        .method = HTTP_GET,
+        .handler = sensor_history_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/archive/*",
+        .method = HTTP_GET,
+        .handler = sensor_archive_handler,
+        .user_ctx = NULL
+    },
+    {
+        .uri = "/api/v1/rollups/*",
+        .method = HTTP_GET,
+        .handler = sensor_rollup_handler,
+        .user_ctx = NULL
+    },
     {
         .uri = "/api/v1/system",
         .method = HTTP_GET,
@@ -228,6 +291,29 @@ static esp_err_t get_network_config_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static const char *payload_format_name(uint8_t format) {
+    return (format == MQTT_PAYLOAD_CBOR) ? "cbor" : "json";
+}
+
+// Parse "json" or "cbor", leaving format untouched when absent
+static bool get_payload_format(const cJSON *root, const char *key, uint8_t *format) {
+    cJSON *item = cJSON_GetObjectItem(root, key);
+    if (item == NULL) {
+        return true;
+    }
+    if (!cJSON_IsString(item)) {
+        return false;
+    }
+    if (strcmp(item->valuestring, "json") == 0) {
+        *format = MQTT_PAYLOAD_JSON;
+    } else if (strcmp(item->valuestring, "cbor") == 0) {
+        *format = MQTT_PAYLOAD_CBOR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 static esp_err_t get_mqtt_config_handler(httpd_req_t *req)
 {
     mqtt_config_t config;
@@ -243,8 +329,10 @@ static esp_err_t get_mqtt_config_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    // Only expose broker URL
+    // Only expose broker URL and payload formats
     cJSON_AddStringToObject(root, "broker_url", config.broker_url);
+    cJSON_AddStringToObject(root, "sample_format", payload_format_name(config.sample_format));
+    cJSON_AddStringToObject(root, "rollup_format", payload_format_name(config.rollup_format));
 
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -393,19 +481,27 @@ static esp_err_t update_mqtt_config_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    // Update only broker URL
+    // Update only broker URL and payload formats
     cJSON *item;
     if ((item = cJSON_GetObjectItem(root, "broker_url")) && item->valuestring) {
         strlcpy(config.broker_url, item->valuestring, sizeof(config.broker_url));
     }
+    bool formats_valid = get_payload_format(root, "sample_format", &config.sample_format) &&
+                         get_payload_format(root, "rollup_format", &config.rollup_format);
 
     cJSON_Delete(root);
 
+    if (!formats_valid) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Format must be \"json\" or \"cbor\"");
+        return ESP_FAIL;
+    }
+
     err = system_manager_save_mqtt_config(&config);
     if (err != ESP_OK) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
+    envilog_mqtt_set_payload_formats(&config);
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
@@ -532,7 +628,7 @@ esp_err_t http_server_init(const http_server_config_t *config)
     httpd_config_t http_config = HTTPD_DEFAULT_CONFIG();
     http_config.server_port = config->port;
     http_config.max_open_sockets = config->max_clients;
-    http_config.max_uri_handlers = 10;     // Add this line to increase from default
+    http_config.max_uri_handlers = 20;     // Room above the registered handlers
     http_config.lru_purge_enable = true;
     http_config.uri_match_fn = httpd_uri_match_wildcard;
     http_config.core_id = 0;
@@ -573,9 +669,85 @@ esp_err_t http_server_stop(void)
     return ret;
 }
 
+// Copy the source id that follows prefix in the URI, e.g. /api/v1/sensors/dht11,
+// and look up its handle (DATA_MANAGER_INVALID_HANDLE if not registered)
+static bool get_source_from_uri(httpd_req_t *req, const char *prefix, char source[SENSOR_SOURCE_NAME_LEN],
+                                data_manager_handle_t *handle) {
+    const char *name = req->uri + strlen(prefix);
+    size_t name_len = strcspn(name, "?");
+    if (name_len == 0 || name_len >= SENSOR_SOURCE_NAME_LEN) {
+        return false;
+    }
+    memcpy(source, name, name_len);
+    source[name_len] = '\0';
+    if (data_manager_find_source(source, handle) != ESP_OK) {
+        *handle = DATA_MANAGER_INVALID_HANDLE;
+    }
+    return true;
+}
+
+// Registered sources with their channels, so clients need not hard-code source names
+static esp_err_t sensor_list_handler(httpd_req_t *req) {
+    cJSON *root = cJSON_CreateArray();
+    if (!root) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    size_t count = data_manager_get_source_count();
+    for (size_t i = 0; i < count; i++) {
+        data_manager_source_info_t info;
+        if (data_manager_get_source_info((data_manager_handle_t)i, &info) != ESP_OK) {
+            continue;
+        }
+        cJSON *obj = cJSON_CreateObject();
+        if (!obj) {
+            break;
+        }
+        cJSON_AddStringToObject(obj, "name", info.name);
+        cJSON_AddNumberToObject(obj, "handle", info.handle);
+        cJSON_AddNumberToObject(obj, "generation", info.generation);
+        cJSON *channels = cJSON_AddArrayToObject(obj, "channels");
+        for (uint8_t c = 0; channels && c < info.channel_count; c++) {
+            cJSON *channel = cJSON_CreateObject();
+            if (!channel) {
+                break;
+            }
+            cJSON_AddStringToObject(channel, "name", info.channels[c].name);
+            cJSON_AddStringToObject(channel, "unit", info.channels[c].unit);
+            cJSON_AddNumberToObject(channel, "scale", info.channels[c].scale);
+            cJSON_AddItemToArray(channels, channel);
+        }
+        cJSON_AddItemToArray(root, obj);
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+
+    return ESP_OK;
+}
+
 static esp_err_t sensor_data_handler(httpd_req_t *req) {
-    dht11_reading_t reading;
-    esp_err_t ret = data_manager_get_latest_data("dht11", &reading);
+    char source[SENSOR_SOURCE_NAME_LEN];
+    data_manager_handle_t handle;
+    if (!get_source_from_uri(req, "/api/v1/sensors/", source, &handle)) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    // A source that has not registered yet reports as not valid
+    sensor_sample_t sample;
+    uint32_t generation = 0;
+    esp_err_t ret = data_manager_get_latest(handle, &sample, &generation);
     
     cJSON *root = cJSON_CreateObject();
     if (!root) {
@@ -583,14 +755,561 @@ static esp_err_t sensor_data_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
-    if (ret == ESP_OK && reading.valid) {
-        cJSON_AddNumberToObject(root, "temperature", reading.temperature);
-        cJSON_AddNumberToObject(root, "humidity", reading.humidity);
-        cJSON_AddNumberToObject(root, "timestamp", reading.timestamp);
+    if (ret == ESP_OK && sensor_sample_is_valid(&sample)) {
+        char timestamp[24];
+        snprintf(timestamp, sizeof(timestamp), "%" PRIu64,
+                 sensor_sample_time_ms(&sample, esp_timer_get_time() / 1000));
+        char number[SENSOR_CENTI_STR_LEN];
+
+        cJSON_AddRawToObject(root, "temperature", sensor_centi_format(sample.temperature, number));
+        cJSON_AddRawToObject(root, "humidity", sensor_centi_format(sample.humidity, number));
+        cJSON_AddRawToObject(root, "timestamp", timestamp);
         cJSON_AddBoolToObject(root, "valid", true);
+        if (sample.filter != SENSOR_FILTER_NONE) {
+            cJSON_AddRawToObject(root, "temperature_filtered",
+                                 sensor_centi_format(sample.temperature_filtered, number));
+            cJSON_AddRawToObject(root, "humidity_filtered",
+                                 sensor_centi_format(sample.humidity_filtered, number));
+            cJSON_AddStringToObject(root, "filter", sensor_filter_type_name(sample.filter));
+        }
     } else {
         cJSON_AddBoolToObject(root, "valid", false);
     }
+    if (ret == ESP_OK) {
+        cJSON_AddNumberToObject(root, "generation", generation);
+    }
+
+    sensor_cadence_stats_t cadence;
+    if (data_manager_get_cadence_stats(handle, &cadence) == ESP_OK) {
+        cJSON *cadence_obj = cJSON_AddObjectToObject(root, "cadence");
+        if (cadence_obj) {
+            cJSON_AddNumberToObject(cadence_obj, "samples", cadence.samples);
+            cJSON_AddNumberToObject(cadence_obj, "missed_slots", cadence.missed_slots);
+            cJSON_AddNumberToObject(cadence_obj, "retries", cadence.retries);
+            cJSON_AddNumberToObject(cadence_obj, "retry_successes", cadence.retry_successes);
+            cJSON_AddNumberToObject(cadence_obj, "jitter_last_us", cadence.jitter_last_us);
+            cJSON_AddNumberToObject(cadence_obj, "jitter_max_us", cadence.jitter_max_us);
+            cJSON_AddNumberToObject(cadence_obj, "jitter_mean_us", cadence.jitter_mean_us);
+            cJSON_AddNumberToObject(cadence_obj, "interval_ms", cadence.interval_ms);
+        }
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+
+    return ESP_OK;
+}
+
+static void add_histogram(cJSON *parent, const char *name, const sensor_histogram_t *hist) {
+    cJSON *obj = cJSON_AddObjectToObject(parent, name);
+    if (!obj) {
+        return;
+    }
+
+    cJSON_AddNumberToObject(obj, "offset_us", hist->offset_us);
+    cJSON_AddNumberToObject(obj, "bucket_us", hist->bucket_us);
+    cJSON_AddNumberToObject(obj, "count", hist->count);
+    if (hist->count > 0) {
+        cJSON_AddNumberToObject(obj, "min_us", hist->min_us);
+        cJSON_AddNumberToObject(obj, "max_us", hist->max_us);
+        cJSON_AddNumberToObject(obj, "mean_us", (double)hist->total_us / hist->count);
+    }
+    cJSON *buckets = cJSON_AddArrayToObject(obj, "buckets");
+    if (buckets) {
+        for (int i = 0; i < SENSOR_HISTOGRAM_BUCKETS; i++) {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(hist->buckets[i]));
+        }
+    }
+}
+
+static esp_err_t sensor_diagnostics_handler(httpd_req_t *req) {
+    char source[SENSOR_SOURCE_NAME_LEN];
+    data_manager_handle_t handle;
+    if (!get_source_from_uri(req, "/api/v1/diagnostics/sensors/", source, &handle) ||
+        handle == DATA_MANAGER_INVALID_HANDLE) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    sensor_timing_stats_t *timing = malloc(sizeof(sensor_timing_stats_t));
+    if (!timing) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    if (data_manager_get_timing_stats(handle, timing) != ESP_OK) {
+        free(timing);
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        free(timing);
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    cJSON_AddStringToObject(root, "source", source);
+    cJSON_AddNumberToObject(root, "reads", timing->reads);
+    cJSON_AddNumberToObject(root, "failed_reads", timing->failed_reads);
+    cJSON_AddNumberToObject(root, "last_min_margin_us", timing->last_min_margin_us);
+    add_histogram(root, "latency", &timing->latency);
+    add_histogram(root, "response_low", &timing->response_low);
+    add_histogram(root, "response_high", &timing->response_high);
+    add_histogram(root, "bit_margin", &timing->bit_margin);
+    free(timing);
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+
+    return ESP_OK;
+}
+
+static esp_err_t subscriber_diagnostics_handler(httpd_req_t *req) {
+    cJSON *root = cJSON_CreateArray();
+    if (!root) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    size_t count = data_manager_get_subscriber_count();
+    for (size_t i = 0; i < count; i++) {
+        data_manager_subscriber_stats_t stats;
+        if (data_manager_get_subscriber_stats(i, &stats) != ESP_OK) {
+            continue;
+        }
+        cJSON *obj = cJSON_CreateObject();
+        if (!obj) {
+            break;
+        }
+        cJSON_AddStringToObject(obj, "name", stats.name);
+        cJSON_AddNumberToObject(obj, "delivered", stats.delivered);
+        cJSON_AddNumberToObject(obj, "failed", stats.failed);
+        cJSON_AddNumberToObject(obj, "dropped", stats.dropped);
+        cJSON_AddNumberToObject(obj, "suppressed", stats.suppressed);
+        uint32_t offered = stats.delivered + stats.failed + stats.dropped + stats.queued + stats.suppressed;
+        cJSON_AddNumberToObject(obj, "suppression_ratio", offered ? (double)stats.suppressed / offered : 0);
+        cJSON_AddNumberToObject(obj, "depth", stats.depth);
+        cJSON_AddNumberToObject(obj, "queued", stats.queued);
+        cJSON_AddNumberToObject(obj, "high_water", stats.high_water);
+        cJSON_AddItemToArray(root, obj);
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+
+    return ESP_OK;
+}
+
+static esp_err_t store_diagnostics_handler(httpd_req_t *req) {
+    sample_store_stats_t stats;
+    if (sample_store_get_stats(&stats) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sample store disabled");
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    cJSON_AddNumberToObject(root, "segments", stats.segments);
+    cJSON_AddNumberToObject(root, "head_segment", stats.head_segment);
+    cJSON_AddNumberToObject(root, "next_seq", stats.next_seq);
+    cJSON_AddNumberToObject(root, "boot", stats.boot);
+    cJSON_AddNumberToObject(root, "samples", stats.samples);
+    cJSON_AddNumberToObject(root, "records", stats.records);
+    cJSON_AddNumberToObject(root, "bytes_encoded", stats.bytes_encoded);
+    cJSON_AddNumberToObject(root, "bytes_programmed", stats.bytes_programmed);
+    cJSON_AddNumberToObject(root, "write_amplification",
+                            stats.bytes_encoded ? (double)stats.bytes_programmed / stats.bytes_encoded : 0);
+    cJSON_AddNumberToObject(root, "segments_erased", stats.segments_erased);
+    cJSON_AddNumberToObject(root, "write_errors", stats.write_errors);
+    cJSON_AddNumberToObject(root, "recovery_reads", stats.recovery_reads);
+    cJSON_AddNumberToObject(root, "recovery_us", stats.recovery_us);
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+
+    return ESP_OK;
+}
+
+// Batching counters at the top level of /api/v1/diagnostics/mqtt
+static void add_batch_stats(cJSON *root, const envilog_mqtt_batch_stats_t *stats) {
+    double uptime_s = esp_timer_get_time() / 1000000.0;
+    uint32_t saved = stats->samples > stats->messages ? stats->samples - stats->messages : 0;
+    cJSON_AddNumberToObject(root, "samples", stats->samples);
+    cJSON_AddNumberToObject(root, "messages", stats->messages);
+    cJSON_AddNumberToObject(root, "messages_saved", saved);
+    cJSON_AddNumberToObject(root, "messages_saved_per_s", uptime_s > 0 ? saved / uptime_s : 0);
+    cJSON_AddNumberToObject(root, "flushed_full", stats->flushed_full);
+    cJSON_AddNumberToObject(root, "flushed_bytes", stats->flushed_bytes);
+    cJSON_AddNumberToObject(root, "flushed_latency", stats->flushed_latency);
+    cJSON_AddNumberToObject(root, "publish_errors", stats->publish_errors);
+    cJSON_AddNumberToObject(root, "samples_dropped", stats->samples_dropped);
+
+    uint32_t flushed = 0;
+    for (int i = 0; i < ENVILOG_MQTT_BATCH_LATENCY_BUCKETS; i++) {
+        flushed += stats->latency_buckets[i];
+    }
+    cJSON *latency = cJSON_AddObjectToObject(root, "latency");
+    if (latency) {
+        cJSON_AddNumberToObject(latency, "mean_ms", flushed ? (double)stats->latency_total_ms / flushed : 0);
+        cJSON_AddNumberToObject(latency, "max_ms", stats->latency_max_ms);
+        cJSON_AddNumberToObject(latency, "bucket_ms", ENVILOG_MQTT_BATCH_LATENCY_MS / ENVILOG_MQTT_BATCH_LATENCY_BUCKETS);
+        cJSON *buckets = cJSON_AddArrayToObject(latency, "buckets");
+        for (int i = 0; buckets && i < ENVILOG_MQTT_BATCH_LATENCY_BUCKETS; i++) {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(stats->latency_buckets[i]));
+        }
+    }
+}
+
+static void add_forward_stats(cJSON *root, const envilog_mqtt_forward_stats_t *stats) {
+    cJSON *forward = cJSON_AddObjectToObject(root, "forward");
+    if (forward) {
+        cJSON_AddBoolToObject(forward, "active", stats->active);
+        cJSON_AddNumberToObject(forward, "drains", stats->drains);
+        cJSON_AddNumberToObject(forward, "messages", stats->messages);
+        cJSON_AddNumberToObject(forward, "samples", stats->samples);
+        cJSON_AddNumberToObject(forward, "publish_errors", stats->publish_errors);
+        cJSON_AddNumberToObject(forward, "ack_timeouts", stats->ack_timeouts);
+        cJSON_AddNumberToObject(forward, "cursor_seq", stats->cursor_seq);
+        cJSON_AddNumberToObject(forward, "cursor_index", stats->cursor_index);
+    }
+}
+
+static void add_publish_stats(cJSON *root, const envilog_mqtt_publish_stats_t *stats) {
+    cJSON *publish = cJSON_AddObjectToObject(root, "publish");
+    if (publish) {
+        cJSON_AddStringToObject(publish, "protocol", stats->protocol == 5 ? "5" : "3.1.1");
+        cJSON_AddNumberToObject(publish, "messages", stats->messages);
+        cJSON_AddNumberToObject(publish, "aliased", stats->aliased);
+        cJSON_AddNumberToObject(publish, "metadata", stats->metadata);
+        cJSON_AddNumberToObject(publish, "payload_bytes", stats->payload_bytes);
+        cJSON_AddNumberToObject(publish, "wire_bytes", stats->wire_bytes);
+        cJSON_AddNumberToObject(publish, "wire_bytes_per_message",
+                                stats->messages ? (double)stats->wire_bytes / stats->messages : 0);
+    }
+}
+
+static void add_reconnect_stats(cJSON *root, const envilog_mqtt_reconnect_stats_t *stats) {
+    cJSON *reconnect = cJSON_AddObjectToObject(root, "reconnect");
+    if (reconnect) {
+        cJSON_AddStringToObject(reconnect, "state", stats->state ? stats->state : "");
+        cJSON_AddNumberToObject(reconnect, "reconnects", stats->reconnects);
+        cJSON_AddNumberToObject(reconnect, "attempts", stats->attempts);
+        cJSON_AddNumberToObject(reconnect, "attempt", stats->attempt);
+        cJSON_AddNumberToObject(reconnect, "last_delay_ms", stats->last_delay_ms);
+        cJSON_AddNumberToObject(reconnect, "mean_ms", stats->reconnects ? (double)stats->total_ms / stats->reconnects : 0);
+        cJSON_AddNumberToObject(reconnect, "longest_ms", stats->longest_ms);
+        // Bucket 0 is under 1 s / one attempt, bucket i up to 2^i s / attempts
+        cJSON *time_buckets = cJSON_AddArrayToObject(reconnect, "time_buckets_s");
+        cJSON *attempt_buckets = cJSON_AddArrayToObject(reconnect, "attempt_buckets");
+        for (int i = 0; time_buckets && attempt_buckets && i < ENVILOG_MQTT_RECONNECT_BUCKETS; i++) {
+            cJSON_AddItemToArray(time_buckets, cJSON_CreateNumber(stats->time_buckets[i]));
+            cJSON_AddItemToArray(attempt_buckets, cJSON_CreateNumber(stats->attempt_buckets[i]));
+        }
+    }
+}
+
+static esp_err_t mqtt_diagnostics_handler(httpd_req_t *req) {
+    envilog_mqtt_batch_stats_t batch_stats;
+    envilog_mqtt_forward_stats_t forward_stats;
+    envilog_mqtt_reconnect_stats_t reconnect_stats;
+    envilog_mqtt_publish_stats_t publish_stats;
+    bool batching = envilog_mqtt_get_batch_stats(&batch_stats) == ESP_OK;
+    bool forwarding = envilog_mqtt_get_forward_stats(&forward_stats) == ESP_OK;
+    envilog_mqtt_get_reconnect_stats(&reconnect_stats);
+    bool publishing = envilog_mqtt_get_publish_stats(&publish_stats) == ESP_OK;
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    if (batching) {
+        add_batch_stats(root, &batch_stats);
+    }
+    if (forwarding) {
+        add_forward_stats(root, &forward_stats);
+    }
+    add_reconnect_stats(root, &reconnect_stats);
+    if (publishing) {
+        add_publish_stats(root, &publish_stats);
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+
+    return ESP_OK;
+}
+
+// Read an unsigned query parameter, leaving value untouched when absent
+static bool get_query_u64(const char *query, const char *key, uint64_t *value) {
+    char text[24];
+    if (query == NULL || httpd_query_key_value(query, key, text, sizeof(text)) != ESP_OK) {
+        return true;
+    }
+    char *end;
+    *value = strtoull(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+// GET /api/v1/history/<source>?from=<ms>&to=<ms>&max_points=<n>
+// Streams {"source":..,"points":[[timestamp_ms,temperature,humidity],...]}, oldest first
+static esp_err_t sensor_history_handler(httpd_req_t *req) {
+    char source[SENSOR_SOURCE_NAME_LEN];
+    data_manager_handle_t handle;
+    if (!get_source_from_uri(req, "/api/v1/history/", source, &handle) ||
+        handle == DATA_MANAGER_INVALID_HANDLE) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    char query[96];
+    const char *query_ptr = NULL;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        query_ptr = query;
+    }
+
+    uint64_t from_ms = 0;
+    uint64_t to_ms = UINT64_MAX;
+    uint64_t max_points = HTTP_HISTORY_DEFAULT_POINTS;
+    if (!get_query_u64(query_ptr, "from", &from_ms) ||
+        !get_query_u64(query_ptr, "to", &to_ms) ||
+        !get_query_u64(query_ptr, "max_points", &max_points) || max_points == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid from, to or max_points");
+        return ESP_FAIL;
+    }
+    if (max_points > HTTP_HISTORY_MAX_POINTS) {
+        max_points = HTTP_HISTORY_MAX_POINTS;
+    }
+
+    sensor_sample_t *samples = malloc(max_points * sizeof(sensor_sample_t));
+    char *chunk = malloc(HTTP_CHUNK_SIZE);
+    if (!samples || !chunk) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM,
+            "Memory allocation failed");
+        free(samples);
+        free(chunk);
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    size_t count = 0;
+    esp_err_t ret = data_manager_get_history(handle, from_ms, to_ms, samples, max_points, &count);
+    if (ret != ESP_OK) {
+        free(samples);
+        free(chunk);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            httpd_resp_send_404(req);
+        } else {
+            httpd_resp_send_500(req);
+        }
+        return ESP_FAIL;
+    }
+
+    // Build points directly into chunks rather than a cJSON tree of every sample
+    httpd_resp_set_type(req, "application/json");
+    uint64_t now_ms = esp_timer_get_time() / 1000;
+    int len = snprintf(chunk, HTTP_CHUNK_SIZE, "{\"source\":\"%s\",\"points\":[", source);
+    bool first = true;
+    ret = ESP_OK;
+    for (size_t i = 0; i < count && ret == ESP_OK; i++) {
+        if (!sensor_sample_is_valid(&samples[i])) {
+            continue;
+        }
+        if (len > HTTP_CHUNK_SIZE - 48) {
+            ret = httpd_resp_send_chunk(req, chunk, len);
+            len = 0;
+        }
+        len += snprintf(chunk + len, HTTP_CHUNK_SIZE - len,
+                        "%s[%" PRIu64 "," SENSOR_CENTI_FMT "," SENSOR_CENTI_FMT "]", first ? "" : ",",
+                        sensor_sample_time_ms(&samples[i], now_ms),
+                        SENSOR_CENTI_ARGS(samples[i].temperature),
+                        SENSOR_CENTI_ARGS(samples[i].humidity));
+        first = false;
+    }
+    if (ret == ESP_OK) {
+        len += snprintf(chunk + len, HTTP_CHUNK_SIZE - len, "]}");
+        ret = httpd_resp_send_chunk(req, chunk, len);
+    }
+
+    free(samples);
+    free(chunk);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_COMMUNICATION, "History sending failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// GET /api/v1/archive/<source>
+// Streams the compressed archive blocks back to back, oldest first, in the ts_block.h format.
+// X-Uptime-Ms carries the device time for expanding the 32-bit sample timestamps.
+static esp_err_t sensor_archive_handler(httpd_req_t *req) {
+    char source[SENSOR_SOURCE_NAME_LEN];
+    data_manager_handle_t handle;
+    if (!get_source_from_uri(req, "/api/v1/archive/", source, &handle) ||
+        handle == DATA_MANAGER_INVALID_HANDLE) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    uint8_t *block = malloc(TS_BLOCK_SIZE);
+    if (!block) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM,
+            "Memory allocation failed");
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    // Copying one block at a time keeps the publisher's lock hold short
+    uint32_t cursor = 0;
+    size_t len = 0;
+    esp_err_t ret = data_manager_read_archive(handle, &cursor, block, &len);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        free(block);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Archive disabled");
+        return ESP_FAIL;
+    }
+
+    char uptime[24];
+    snprintf(uptime, sizeof(uptime), "%" PRId64, esp_timer_get_time() / 1000);
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "X-Uptime-Ms", uptime);
+
+    esp_err_t send_ret = ESP_OK;
+    while (ret == ESP_OK && send_ret == ESP_OK) {
+        send_ret = httpd_resp_send_chunk(req, (const char *)block, len);
+        ret = data_manager_read_archive(handle, &cursor, block, &len);
+    }
+
+    free(block);
+    if (send_ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, send_ret, ERROR_CAT_COMMUNICATION, "Archive sending failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Built by the MQTT payload code, so both interfaces serve the same summary
+static void add_rollup_channel(cJSON *parent, const char *name, const data_manager_channel_summary_t *summary) {
+    char json[MQTT_PAYLOAD_SUMMARY_JSON_MAX];
+    if (mqtt_payload_format_summary_json(json, sizeof(json), summary) > 0) {
+        cJSON_AddRawToObject(parent, name, json);
+    }
+}
+
+// Bucket as an object, or null before it has samples
+static void add_rollup(cJSON *parent, const char *name, const data_manager_rollup_t *rollup) {
+    if (rollup->count == 0) {
+        cJSON_AddNullToObject(parent, name);
+        return;
+    }
+    cJSON *obj = cJSON_AddObjectToObject(parent, name);
+    if (!obj) {
+        return;
+    }
+    char start[24];
+    snprintf(start, sizeof(start), "%" PRIu64, rollup->start_ms);
+    cJSON_AddRawToObject(obj, "start", start);
+    cJSON_AddNumberToObject(obj, "count", rollup->count);
+    add_rollup_channel(obj, "temperature", &rollup->temperature);
+    add_rollup_channel(obj, "humidity", &rollup->humidity);
+}
+
+// GET /api/v1/rollups/<source>?level=<n>
+// Open and last closed bucket of one rollup level, with min/max/mean and p5/p50/p95
+static esp_err_t sensor_rollup_handler(httpd_req_t *req) {
+    char source[SENSOR_SOURCE_NAME_LEN];
+    data_manager_handle_t handle;
+    if (!get_source_from_uri(req, "/api/v1/rollups/", source, &handle) ||
+        handle == DATA_MANAGER_INVALID_HANDLE) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    char query[32];
+    const char *query_ptr = NULL;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        query_ptr = query;
+    }
+
+    uint64_t level = DATA_MANAGER_ROLLUP_LEVELS;
+    if (!get_query_u64(query_ptr, "level", &level) || level == 0 || level > DATA_MANAGER_ROLLUP_LEVELS ||
+        data_manager_get_rollup_resolution(level) == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid or disabled level");
+        return ESP_FAIL;
+    }
+
+    data_manager_rollup_t open;
+    data_manager_rollup_t closed;
+    if (data_manager_get_rollup(handle, level, &open, &closed) != ESP_OK) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    cJSON_AddStringToObject(root, "source", source);
+    cJSON_AddNumberToObject(root, "level", level);
+    cJSON_AddNumberToObject(root, "resolution_s", data_manager_get_rollup_resolution(level) / 1000);
+    add_rollup(root, "open", &open);
+    add_rollup(root, "last", &closed);
 
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
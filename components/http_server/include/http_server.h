@@ -11,6 +11,10 @@ extern "C" {
 #define FILE_PATH_MAX (ESP_VFS_PATH_MAX + CONFIG_SPIFFS_OBJ_NAME_LEN)
 #define HTTP_CHUNK_SIZE (1024)
 
+// History endpoint limits
+#define HTTP_HISTORY_DEFAULT_POINTS (256)
+#define HTTP_HISTORY_MAX_POINTS (512)
+
 /**
  * @brief HTTP server configuration
  */
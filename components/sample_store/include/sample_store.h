@@ -0,0 +1,119 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include "ts_block.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Append-only sample log on the "tsdata" flash partition.
+ *
+ * The partition is a circular log of 4 KB segments (one erase sector each),
+ * written in order and erased just before reuse, so every sector wears
+ * evenly and the oldest segment is evicted automatically. A segment holds
+ * 16 records of one flash page each, every page programmed once:
+ *
+ *   0..3    magic SAMPLE_STORE_MAGIC
+ *   4..7    CRC-32 (zlib polynomial) of bytes 8 .. header + block length
+ *   8..11   record sequence number, increasing across boots
+ *   12..15  boot number, sample timestamps restart with every boot
+ *   16..31  source name, NUL padded
+ *   32..    ts_block.h block of at most SAMPLE_STORE_BLOCK_SIZE bytes
+ *
+ * An all-0xFF page is free. Pages with a bad magic or CRC were torn by a
+ * power loss and are skipped by readers. The first record of a segment
+ * doubles as its time-ordered header: recovery reads it for every segment,
+ * then scans only the newest segment for its first free page.
+ */
+#define SAMPLE_STORE_PARTITION_LABEL    "tsdata"
+#define SAMPLE_STORE_MAGIC              0x52564E45  // "ENVR"
+#define SAMPLE_STORE_SEGMENT_SIZE       4096
+#define SAMPLE_STORE_PAGE_SIZE          256
+#define SAMPLE_STORE_RECORD_HEADER_SIZE 32
+#define SAMPLE_STORE_BLOCK_SIZE         (SAMPLE_STORE_PAGE_SIZE - SAMPLE_STORE_RECORD_HEADER_SIZE)
+
+/**
+ * @brief Store counters
+ *
+ * Write amplification is bytes_programmed / bytes_encoded; every erased
+ * segment additionally costs one erase cycle of SAMPLE_STORE_SEGMENT_SIZE.
+ */
+typedef struct {
+    uint32_t segments;             // Segments in the partition
+    uint32_t head_segment;         // Segment being filled
+    uint32_t next_seq;             // Sequence number of the next record
+    uint32_t boot;                 // Boot number stamped on this boot's records
+    uint32_t samples;              // Samples appended since boot
+    uint32_t records;              // Records programmed since boot
+    uint32_t bytes_encoded;        // Compressed block bytes programmed
+    uint32_t bytes_programmed;     // Record bytes programmed, headers included
+    uint32_t segments_erased;
+    uint32_t write_errors;
+    uint32_t recovery_reads;       // Flash reads needed at boot
+    uint32_t recovery_us;          // Boot recovery time
+} sample_store_stats_t;
+
+/**
+ * @brief One stored record
+ */
+typedef struct {
+    uint32_t seq;                  // Record sequence number
+    uint32_t boot;                 // Boot the samples were taken in
+    char source[SENSOR_SOURCE_NAME_LEN];
+    uint8_t block[SAMPLE_STORE_BLOCK_SIZE];  // Decode with ts_block_decoder_init()
+} sample_store_record_t;
+
+/**
+ * @brief Recover the store and subscribe it to the data manager
+ *
+ * Call after data_manager_init().
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND without a tsdata partition
+ */
+esp_err_t sample_store_init(void);
+
+/**
+ * @brief Release the partition; sample_store_init() recovers the store again
+ *
+ * Records still being filled are lost as on a power cut, call
+ * sample_store_flush() first to keep them. Samples delivered meanwhile
+ * are refused.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE before init
+ */
+esp_err_t sample_store_deinit(void);
+
+/**
+ * @brief Write every partially filled record now, e.g. before a restart
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sample_store_flush(void);
+
+/**
+ * @brief Read the oldest stored record with a sequence number of at least seq
+ *
+ * Records of the current boot still being filled in RAM are not visible
+ * until sample_store_flush(). Reading seq, then record.seq + 1, walks the
+ * log in order at one flash read per record.
+ *
+ * @param seq Lowest sequence number wanted
+ * @param record Pointer to store the record
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no such record is stored
+ */
+esp_err_t sample_store_read(uint32_t seq, sample_store_record_t *record);
+
+/**
+ * @brief Get store counters
+ *
+ * @param stats Pointer to store counters
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE before init
+ */
+esp_err_t sample_store_get_stats(sample_store_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,431 @@
+#include <inttypes.h>
+#include <string.h>
+#include "sample_store.h"
+#include "data_manager.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "error_handler.h"
+
+static const char *TAG = "sample_store";
+
+#define PAGES_PER_SEGMENT   (SAMPLE_STORE_SEGMENT_SIZE / SAMPLE_STORE_PAGE_SIZE)
+#define FLUSH_INTERVAL_US   ((int64_t)CONFIG_ENVILOG_SAMPLE_STORE_FLUSH_S * 1000000)
+
+// Record being filled for one source, programmed when its block is full
+typedef struct {
+    const char *source;             // Data manager name, valid for its lifetime
+    uint8_t page[SAMPLE_STORE_PAGE_SIZE];
+    ts_block_encoder_t encoder;
+    int64_t opened_us;              // Time of the first sample in the page
+} pending_record_t;
+
+static const esp_partition_t *partition = NULL;
+static SemaphoreHandle_t store_mutex = NULL;
+static bool subscribed = false;     // The subscription outlives a deinit
+static pending_record_t pending[DATA_MANAGER_MAX_SOURCES];
+static size_t pending_count = 0;
+static uint32_t head_page = 0;      // Next free page in the head segment
+static sample_store_stats_t stats = {0};
+
+// Where the record after the last one returned by sample_store_read() starts
+static struct {
+    bool valid;
+    uint32_t seq;
+    uint32_t segment;
+    uint32_t page;
+} read_hint;
+
+static size_t page_offset(uint32_t segment, uint32_t page) {
+    return (size_t)segment * SAMPLE_STORE_SEGMENT_SIZE + (size_t)page * SAMPLE_STORE_PAGE_SIZE;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = value >> 24;
+}
+
+// Record length from its block header, 0 if out of range
+static size_t record_length(const uint8_t *page) {
+    size_t block_len = ts_block_size(page + SAMPLE_STORE_RECORD_HEADER_SIZE);
+    return block_len <= SAMPLE_STORE_BLOCK_SIZE ? SAMPLE_STORE_RECORD_HEADER_SIZE + block_len : 0;
+}
+
+// esp_rom_crc32_le with a zero seed matches zlib.crc32, used by the host tool
+static uint32_t record_crc(const uint8_t *page, size_t len) {
+    return esp_rom_crc32_le(0, page + 8, len - 8);
+}
+
+static bool page_is_free(const uint8_t *page) {
+    for (size_t i = 0; i < SAMPLE_STORE_PAGE_SIZE; i++) {
+        if (page[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool page_is_valid(const uint8_t *page) {
+    if (get_u32(page) != SAMPLE_STORE_MAGIC) {
+        return false;
+    }
+    size_t len = record_length(page);
+    return len != 0 && get_u32(page + 4) == record_crc(page, len);
+}
+
+static esp_err_t read_page(uint32_t segment, uint32_t page, uint8_t *buf) {
+    return esp_partition_read(partition, page_offset(segment, page), buf, SAMPLE_STORE_PAGE_SIZE);
+}
+
+// Find the newest segment from the first record of each, then its first free page
+static esp_err_t recover(void) {
+    uint8_t page[SAMPLE_STORE_PAGE_SIZE];
+    bool found = false;
+    uint32_t newest_seq = 0;
+
+    for (uint32_t segment = 0; segment < stats.segments; segment++) {
+        stats.recovery_reads++;
+        esp_err_t ret = read_page(segment, 0, page);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (page_is_valid(page) && (!found || get_u32(page + 8) > newest_seq)) {
+            newest_seq = get_u32(page + 8);
+            stats.head_segment = segment;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        // Blank or foreign partition; the first write erases and starts segment 0
+        stats.head_segment = stats.segments - 1;
+        head_page = PAGES_PER_SEGMENT;
+        return ESP_OK;
+    }
+
+    uint32_t last_boot = 0;
+    head_page = PAGES_PER_SEGMENT;
+    for (uint32_t i = 0; i < PAGES_PER_SEGMENT; i++) {
+        stats.recovery_reads++;
+        esp_err_t ret = read_page(stats.head_segment, i, page);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (page_is_free(page)) {
+            head_page = i;
+            break;
+        }
+        // Torn pages stay in place and are skipped by readers
+        if (page_is_valid(page)) {
+            newest_seq = get_u32(page + 8);
+            last_boot = get_u32(page + 12);
+        }
+    }
+
+    stats.next_seq = newest_seq + 1;
+    stats.boot = last_boot + 1;
+    return ESP_OK;
+}
+
+// Program one record, moving to the next segment (and evicting it) when the head is full
+static esp_err_t write_record(pending_record_t *record) {
+    if (head_page == PAGES_PER_SEGMENT) {
+        uint32_t next = (stats.head_segment + 1) % stats.segments;
+        esp_err_t ret = esp_partition_erase_range(partition, page_offset(next, 0), SAMPLE_STORE_SEGMENT_SIZE);
+        if (ret != ESP_OK) {
+            stats.write_errors++;
+            ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SYSTEM, "Failed to erase segment %" PRIu32, next);
+            return ret;
+        }
+        stats.head_segment = next;
+        stats.segments_erased++;
+        if (read_hint.segment == next) {
+            read_hint.valid = false;
+        }
+        head_page = 0;
+    }
+
+    uint8_t *page = record->page;
+    size_t len = record_length(page);
+    put_u32(page, SAMPLE_STORE_MAGIC);
+    put_u32(page + 8, stats.next_seq);
+    put_u32(page + 12, stats.boot);
+    memset(page + 16, 0, SENSOR_SOURCE_NAME_LEN);
+    strncpy((char *)page + 16, record->source, SENSOR_SOURCE_NAME_LEN - 1);
+    put_u32(page + 4, record_crc(page, len));
+
+    // A failed page is left behind as torn and never rewritten
+    esp_err_t ret = esp_partition_write(partition, page_offset(stats.head_segment, head_page), page, len);
+    head_page++;
+    if (ret != ESP_OK) {
+        stats.write_errors++;
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SYSTEM, "Failed to write record %" PRIu32, stats.next_seq);
+        return ret;
+    }
+
+    stats.next_seq++;
+    stats.records++;
+    stats.bytes_encoded += len - SAMPLE_STORE_RECORD_HEADER_SIZE;
+    stats.bytes_programmed += len;
+    return ESP_OK;
+}
+
+static void open_record(pending_record_t *record) {
+    ts_block_begin(&record->encoder, record->page + SAMPLE_STORE_RECORD_HEADER_SIZE, SAMPLE_STORE_BLOCK_SIZE);
+    record->opened_us = esp_timer_get_time();
+}
+
+static pending_record_t *get_pending(const char *source) {
+    for (size_t i = 0; i < pending_count; i++) {
+        if (pending[i].source == source || strcmp(pending[i].source, source) == 0) {
+            return &pending[i];
+        }
+    }
+    if (pending_count == DATA_MANAGER_MAX_SOURCES) {
+        return NULL;
+    }
+    pending_record_t *record = &pending[pending_count++];
+    record->source = source;
+    open_record(record);
+    return record;
+}
+
+// Runs on the data manager dispatcher; flash time never reaches the sensor tasks
+static esp_err_t store_sample_callback(const char *source, const sensor_sample_t *sample) {
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    if (partition == NULL) {
+        xSemaphoreGive(store_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    pending_record_t *record = get_pending(source);
+    if (record == NULL) {
+        xSemaphoreGive(store_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!ts_block_append(&record->encoder, sample)) {
+        ret = write_record(record);
+        open_record(record);
+        ts_block_append(&record->encoder, sample);
+    } else if (esp_timer_get_time() - record->opened_us > FLUSH_INTERVAL_US) {
+        // Bound what a power loss can take at the cost of a partly used page
+        ret = write_record(record);
+        open_record(record);
+    }
+    stats.samples++;
+    xSemaphoreGive(store_mutex);
+    return ret;
+}
+
+esp_err_t sample_store_init(void) {
+    if (partition != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t *found = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                            ESP_PARTITION_SUBTYPE_ANY,
+                                                            SAMPLE_STORE_PARTITION_LABEL);
+    if (found == NULL) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_NOT_FOUND, ERROR_CAT_SYSTEM,
+            "No %s partition, samples are not persisted", SAMPLE_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (found->size < 2 * SAMPLE_STORE_SEGMENT_SIZE) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_SIZE, ERROR_CAT_SYSTEM,
+            "Partition %s too small", SAMPLE_STORE_PARTITION_LABEL);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (store_mutex == NULL) {
+        store_mutex = xSemaphoreCreateMutex();
+        if (store_mutex == NULL) {
+            ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to create store mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Under the mutex: after a deinit the subscription may already deliver samples
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    partition = found;
+    stats.segments = found->size / SAMPLE_STORE_SEGMENT_SIZE;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = recover();
+    stats.recovery_us = (uint32_t)(esp_timer_get_time() - start_us);
+    if (ret != ESP_OK) {
+        partition = NULL;
+    }
+    xSemaphoreGive(store_mutex);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SYSTEM, "Store recovery failed");
+        return ret;
+    }
+
+    if (!subscribed) {
+        data_manager_subscriber_config_t subscriber = {
+            .name = "store",
+            .callback = store_sample_callback,
+            .queue_depth = 0,
+            .overflow = DATA_MANAGER_OVERFLOW_DROP_NEWEST,
+        };
+        ret = data_manager_subscribe(&subscriber, NULL);
+        if (ret != ESP_OK) {
+            partition = NULL;
+            return ret;
+        }
+        subscribed = true;
+    }
+
+    ESP_LOGI(TAG, "Store recovered in %" PRIu32 " us (%" PRIu32 " reads): %" PRIu32 " segments, head %" PRIu32
+             " page %" PRIu32 ", boot %" PRIu32,
+             stats.recovery_us, stats.recovery_reads, stats.segments, stats.head_segment,
+             head_page, stats.boot);
+    return ESP_OK;
+}
+
+esp_err_t sample_store_deinit(void) {
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    partition = NULL;
+    pending_count = 0;
+    head_page = 0;
+    read_hint.valid = false;
+    memset(&stats, 0, sizeof(stats));
+    xSemaphoreGive(store_mutex);
+    return ESP_OK;
+}
+
+esp_err_t sample_store_flush(void) {
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < pending_count; i++) {
+        if (pending[i].encoder.count > 0) {
+            esp_err_t write_ret = write_record(&pending[i]);
+            if (write_ret != ESP_OK) {
+                ret = write_ret;
+            }
+            open_record(&pending[i]);
+        }
+    }
+    xSemaphoreGive(store_mutex);
+    return ret;
+}
+
+// Pages from a position up to the head page, in log order
+static uint32_t pages_to_head(uint32_t segment, uint32_t page) {
+    uint32_t total = stats.segments * PAGES_PER_SEGMENT;
+    uint32_t from = segment * PAGES_PER_SEGMENT + page;
+    uint32_t to = (stats.head_segment * PAGES_PER_SEGMENT + head_page) % total;
+    return (to + total - from) % total;
+}
+
+// Start of the newest segment whose first record is not past seq, the oldest segment otherwise
+static esp_err_t locate(uint32_t seq, uint32_t *segment, uint8_t *buf) {
+    uint32_t oldest = (stats.head_segment + 1) % stats.segments;
+    *segment = oldest;
+    for (uint32_t i = 0; i < stats.segments; i++) {
+        uint32_t candidate = (oldest + i) % stats.segments;
+        esp_err_t ret = read_page(candidate, 0, buf);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (page_is_valid(buf)) {
+            if (get_u32(buf + 8) > seq) {
+                break;
+            }
+            *segment = candidate;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t sample_store_read(uint32_t seq, sample_store_record_t *record) {
+    if (record == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t page[SAMPLE_STORE_PAGE_SIZE];
+    uint32_t segment = 0;
+    uint32_t page_index = 0;
+    uint32_t remaining = 0;
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    if (stats.next_seq == 0) {
+        // Nothing was ever written
+    } else if (read_hint.valid && seq >= read_hint.seq) {
+        // Sequential reads continue where the last one stopped
+        segment = read_hint.segment;
+        page_index = read_hint.page;
+        remaining = pages_to_head(segment, page_index);
+    } else {
+        ret = locate(seq, &segment, page);
+        remaining = pages_to_head(segment, 0);
+        if (remaining == 0 && head_page == PAGES_PER_SEGMENT) {
+            // Full head segment: the oldest segment starts right after it
+            remaining = stats.segments * PAGES_PER_SEGMENT;
+        }
+    }
+
+    bool found = false;
+    while (ret == ESP_OK && !found && remaining-- > 0) {
+        ret = read_page(segment, page_index, page);
+        if (++page_index == PAGES_PER_SEGMENT) {
+            page_index = 0;
+            segment = (segment + 1) % stats.segments;
+        }
+        if (ret == ESP_OK && page_is_valid(page) && get_u32(page + 8) >= seq) {
+            record->seq = get_u32(page + 8);
+            record->boot = get_u32(page + 12);
+            memcpy(record->source, page + 16, SENSOR_SOURCE_NAME_LEN);
+            record->source[SENSOR_SOURCE_NAME_LEN - 1] = '\0';
+            memcpy(record->block, page + SAMPLE_STORE_RECORD_HEADER_SIZE, SAMPLE_STORE_BLOCK_SIZE);
+            read_hint.valid = true;
+            read_hint.seq = record->seq + 1;
+            read_hint.segment = segment;
+            read_hint.page = page_index;
+            found = true;
+        }
+    }
+    xSemaphoreGive(store_mutex);
+
+    if (ret != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_STORAGE, "Failed to read record %" PRIu32, seq);
+        return ret;
+    }
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t sample_store_get_stats(sample_store_stats_t *out) {
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(store_mutex);
+    return ESP_OK;
+}
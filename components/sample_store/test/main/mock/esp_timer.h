@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Time since boot, advanced by test_sample_store.c
+int64_t esp_timer_get_time(void);
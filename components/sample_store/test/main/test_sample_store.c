@@ -0,0 +1,408 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "sample_store.h"
+#include "data_manager.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+/*
+ * The store over a RAM partition with NOR flash semantics: a write only
+ * clears bits and an erase resets whole sectors. A power cut is a
+ * sample_store_deinit() without a flush, optionally after a write that
+ * programmed only part of its bytes; a reboot is sample_store_init() over
+ * the same RAM. Samples follow a fixed sequence, so every figure below is
+ * the same on every run.
+ */
+
+#define FLASH_SEGMENTS      8
+#define PAGES_PER_SEGMENT   (SAMPLE_STORE_SEGMENT_SIZE / SAMPLE_STORE_PAGE_SIZE)
+#define SAMPLE_INTERVAL_MS  2000
+
+static struct {
+    uint8_t bytes[FLASH_SEGMENTS * SAMPLE_STORE_SEGMENT_SIZE];
+    esp_partition_t partition;
+    bool tear_next_write;           // The next write programs only its first half
+    uint32_t bytes_programmed;
+    uint32_t bits_set;              // 0 -> 1 transitions a write asked for, impossible on NOR
+    uint32_t erases;
+} flash;
+
+static sensor_data_callback_t store_callback;
+static int64_t now_us;
+static uint32_t random_state;
+static int16_t temperature;
+static int16_t humidity;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    return strcmp(label, flash.partition.label) == 0 ? &flash.partition : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(flash.bytes), src_offset + size);
+    memcpy(dst, flash.bytes + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(flash.bytes), dst_offset + size);
+    if (flash.tear_next_write) {
+        flash.tear_next_write = false;
+        size /= 2;
+    }
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < size; i++) {
+        flash.bits_set += __builtin_popcount(bytes[i] & ~flash.bytes[dst_offset + i]);
+        flash.bytes[dst_offset + i] &= bytes[i];
+    }
+    flash.bytes_programmed += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    TEST_ASSERT_EQUAL(0, offset % SAMPLE_STORE_SEGMENT_SIZE);
+    TEST_ASSERT_EQUAL(0, size % SAMPLE_STORE_SEGMENT_SIZE);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(flash.bytes), offset + size);
+    memset(flash.bytes + offset, 0xff, size);
+    flash.erases += size / SAMPLE_STORE_SEGMENT_SIZE;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void) {
+    return now_us;
+}
+
+// The store subscribes once; samples are delivered straight from the test
+esp_err_t data_manager_subscribe(const data_manager_subscriber_config_t *config, size_t *id) {
+    TEST_ASSERT_NULL(store_callback);
+    store_callback = config->callback;
+    return ESP_OK;
+}
+
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+// DHT11-like readings: whole degrees and percent that seldom change, a little timestamp jitter
+static sensor_sample_t next_sample(void) {
+    uint32_t r = next_random();
+    if ((r & 0x0f) == 0) {
+        temperature += (r & 0x10) ? 100 : -100;
+    }
+    if ((r & 0x700) == 0) {
+        humidity += (r & 0x800) ? 100 : -100;
+    }
+    now_us += SAMPLE_INTERVAL_MS * 1000 + (int64_t)((r >> 16) % 3) * 1000;
+    return (sensor_sample_t) {
+        .temperature = temperature,
+        .humidity = humidity,
+        .temperature_filtered = temperature,
+        .humidity_filtered = humidity,
+        .timestamp_ms = (uint32_t)(now_us / 1000),
+        .flags = SENSOR_SAMPLE_VALID,
+    };
+}
+
+static sample_store_stats_t get_stats(void) {
+    sample_store_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_get_stats(&stats));
+    return stats;
+}
+
+static void feed(uint32_t samples) {
+    for (uint32_t i = 0; i < samples; i++) {
+        sensor_sample_t sample = next_sample();
+        TEST_ASSERT_EQUAL(ESP_OK, store_callback("dht11", &sample));
+    }
+}
+
+// Feed until the store has programmed this many more records; returns the samples fed
+static uint32_t feed_records(uint32_t records) {
+    uint32_t target = get_stats().records + records;
+    uint32_t samples = 0;
+    while (get_stats().records < target) {
+        feed(1);
+        samples++;
+    }
+    return samples;
+}
+
+static void boot(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_init());
+}
+
+static void power_cut(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_deinit());
+}
+
+static void reboot(void) {
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_flush());
+    power_cut();
+    boot();
+}
+
+// Blank flash, a fresh clock and the same sample sequence for every test
+static void start_over(void) {
+    // Refused when the previous test left the store down
+    sample_store_deinit();
+    memset(&flash, 0, sizeof(flash));
+    memset(flash.bytes, 0xff, sizeof(flash.bytes));
+    flash.partition.type = ESP_PARTITION_TYPE_DATA;
+    flash.partition.size = sizeof(flash.bytes);
+    flash.partition.erase_size = SAMPLE_STORE_SEGMENT_SIZE;
+    strcpy(flash.partition.label, SAMPLE_STORE_PARTITION_LABEL);
+    now_us = 0;
+    random_state = 0x2545F491;
+    temperature = 2300;
+    humidity = 4500;
+    boot();
+}
+
+// Recovery reads every first page, then the head segment up to its first free page
+static uint32_t expected_recovery_reads(uint32_t pages_written) {
+    uint32_t head_pages = (pages_written - 1) % PAGES_PER_SEGMENT + 1;
+    return FLASH_SEGMENTS + (head_pages < PAGES_PER_SEGMENT ? head_pages + 1 : PAGES_PER_SEGMENT);
+}
+
+typedef struct {
+    uint32_t records;
+    uint32_t first_seq;
+    uint32_t last_seq;
+    uint32_t samples;
+    uint32_t last_boot;
+} walk_t;
+
+// Read the whole log in order, checking every record decodes
+static walk_t walk_log(void) {
+    walk_t walk = {0};
+    sample_store_record_t record;
+    uint32_t seq = 0;
+    while (sample_store_read(seq, &record) == ESP_OK) {
+        if (walk.records == 0) {
+            walk.first_seq = record.seq;
+        } else {
+            TEST_ASSERT_GREATER_THAN_UINT32(walk.last_seq, record.seq);
+            TEST_ASSERT_GREATER_OR_EQUAL_UINT32(walk.last_boot, record.boot);
+        }
+        TEST_ASSERT_EQUAL_STRING("dht11", record.source);
+
+        ts_block_decoder_t decoder;
+        size_t len = ts_block_size(record.block);
+        TEST_ASSERT_EQUAL(ESP_OK, ts_block_decoder_init(&decoder, record.block, len));
+        sensor_sample_t sample;
+        while (ts_block_decode_next(&decoder, &sample)) {
+            walk.samples++;
+        }
+
+        walk.records++;
+        walk.last_seq = record.seq;
+        walk.last_boot = record.boot;
+        seq = record.seq + 1;
+    }
+    return walk;
+}
+
+TEST_CASE("blank partition recovers from the first page of every segment", "[sample_store]") {
+    start_over();
+    sample_store_stats_t stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(FLASH_SEGMENTS, stats.segments);
+    TEST_ASSERT_EQUAL_UINT32(FLASH_SEGMENTS, stats.recovery_reads);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.next_seq);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.boot);
+
+    sample_store_record_t record;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, sample_store_read(0, &record));
+    TEST_ASSERT_EQUAL_UINT32(0, flash.erases);
+}
+
+TEST_CASE("records survive reboots in order", "[sample_store]") {
+    start_over();
+    uint32_t fed = 0;
+    for (uint32_t boot_number = 0; boot_number < 3; boot_number++) {
+        fed += feed_records(5);
+        feed(7);
+        fed += 7;
+        reboot();
+
+        // The flush added one partly used record to the five full ones
+        sample_store_stats_t stats = get_stats();
+        TEST_ASSERT_EQUAL_UINT32(boot_number + 1, stats.boot);
+        TEST_ASSERT_EQUAL_UINT32((boot_number + 1) * 6, stats.next_seq);
+        TEST_ASSERT_EQUAL_UINT32(expected_recovery_reads(stats.next_seq), stats.recovery_reads);
+
+        walk_t walk = walk_log();
+        TEST_ASSERT_EQUAL_UINT32(stats.next_seq, walk.records);
+        TEST_ASSERT_EQUAL_UINT32(0, walk.first_seq);
+        TEST_ASSERT_EQUAL_UINT32(boot_number, walk.last_boot);
+        TEST_ASSERT_EQUAL_UINT32(fed, walk.samples);
+    }
+
+    // Samples not yet in a programmed record are lost with the power
+    feed(7);
+    power_cut();
+    boot();
+    TEST_ASSERT_EQUAL_UINT32(fed, walk_log().samples);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.bits_set);
+}
+
+TEST_CASE("write amplification and erases per record are reproducible", "[sample_store]") {
+    start_over();
+    const uint32_t records = FLASH_SEGMENTS * PAGES_PER_SEGMENT * 3;
+    uint32_t fed = feed_records(records);
+    sample_store_stats_t stats = get_stats();
+
+    // Every programmed byte is counted once, a header per record on top of the blocks
+    TEST_ASSERT_EQUAL_UINT32(records, stats.records);
+    TEST_ASSERT_EQUAL_UINT32(fed, stats.samples);
+    TEST_ASSERT_EQUAL_UINT32(flash.bytes_programmed, stats.bytes_programmed);
+    TEST_ASSERT_EQUAL_UINT32(stats.bytes_encoded + records * SAMPLE_STORE_RECORD_HEADER_SIZE,
+                             stats.bytes_programmed);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.bits_set);
+
+    // One erase per segment of records, the first on the blank partition
+    TEST_ASSERT_EQUAL_UINT32(records / PAGES_PER_SEGMENT, stats.segments_erased);
+    TEST_ASSERT_EQUAL_UINT32(flash.erases, stats.segments_erased);
+
+    // The last lap is still readable, the full head segment included
+    walk_t walk = walk_log();
+    TEST_ASSERT_EQUAL_UINT32(FLASH_SEGMENTS * PAGES_PER_SEGMENT, walk.records);
+    TEST_ASSERT_EQUAL_UINT32(records - walk.records, walk.first_seq);
+
+    // The sample that closed the last record opened the next one, still in RAM
+    double amplification = (double)stats.bytes_programmed / stats.bytes_encoded;
+    double samples_per_record = (double)(stats.samples - 1) / records;
+    printf("%" PRIu32 " records, %.1f samples per record, %.2f block bytes per sample\n",
+           records, samples_per_record, (double)stats.bytes_encoded / (stats.samples - 1));
+    printf("write amplification %.3f, %.4f segment erases per record\n",
+           amplification, (double)stats.segments_erased / records);
+    TEST_ASSERT_TRUE(amplification > 1.0 && amplification < 1.2);
+}
+
+TEST_CASE("a torn page is skipped and its sequence number reused", "[sample_store]") {
+    start_over();
+    feed_records(3);
+    flash.tear_next_write = true;
+    feed_records(1);
+    feed_records(2);
+    power_cut();
+    boot();
+
+    // Three good records, the torn one, then two more; recovery scans past the torn page
+    sample_store_stats_t stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(6, stats.next_seq);
+    TEST_ASSERT_EQUAL_UINT32(expected_recovery_reads(6), stats.recovery_reads);
+    walk_t walk = walk_log();
+    TEST_ASSERT_EQUAL_UINT32(5, walk.records);
+    TEST_ASSERT_EQUAL_UINT32(5, walk.last_seq);
+
+    // A tear at the head: the next boot writes after it under the same number
+    flash.tear_next_write = true;
+    feed_records(1);
+    power_cut();
+    boot();
+    stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(6, stats.next_seq);
+    TEST_ASSERT_EQUAL_UINT32(expected_recovery_reads(7), stats.recovery_reads);
+    feed_records(1);
+    reboot();
+
+    // The boot that wrote only the torn page left no record, so its number comes back too
+    sample_store_record_t record;
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_read(6, &record));
+    TEST_ASSERT_EQUAL_UINT32(6, record.seq);
+    TEST_ASSERT_EQUAL_UINT32(1, record.boot);
+    walk = walk_log();
+    TEST_ASSERT_EQUAL_UINT32(7, walk.records);
+    TEST_ASSERT_EQUAL_UINT32(7, walk.last_seq);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.bits_set);
+}
+
+TEST_CASE("a torn first page of a new segment leaves the previous one as head", "[sample_store]") {
+    start_over();
+    feed_records(PAGES_PER_SEGMENT);
+    flash.tear_next_write = true;
+    feed_records(1);
+    TEST_ASSERT_EQUAL_UINT32(1, get_stats().head_segment);
+    power_cut();
+    boot();
+
+    // The torn segment has no valid first page, so the full one before it is the head
+    sample_store_stats_t stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(0, stats.head_segment);
+    TEST_ASSERT_EQUAL_UINT32(PAGES_PER_SEGMENT, stats.next_seq);
+    TEST_ASSERT_EQUAL_UINT32(expected_recovery_reads(PAGES_PER_SEGMENT), stats.recovery_reads);
+    TEST_ASSERT_EQUAL_UINT32(PAGES_PER_SEGMENT, walk_log().records);
+
+    // The next record erases the torn segment again before programming its first page
+    uint32_t erases = flash.erases;
+    feed_records(1);
+    stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.head_segment);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.segments_erased);
+    TEST_ASSERT_EQUAL_UINT32(erases + 1, flash.erases);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.bits_set);
+
+    reboot();
+    stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.head_segment);
+    TEST_ASSERT_EQUAL_UINT32(PAGES_PER_SEGMENT + 2, stats.next_seq);
+    TEST_ASSERT_EQUAL_UINT32(expected_recovery_reads(stats.next_seq), stats.recovery_reads);
+    walk_t walk = walk_log();
+    TEST_ASSERT_EQUAL_UINT32(PAGES_PER_SEGMENT + 2, walk.records);
+    TEST_ASSERT_EQUAL_UINT32(PAGES_PER_SEGMENT + 1, walk.last_seq);
+}
+
+TEST_CASE("wrap-around evicts the oldest segment and drops a stale read hint", "[sample_store]") {
+    start_over();
+    const uint32_t records = FLASH_SEGMENTS * PAGES_PER_SEGMENT * 2 + 5;
+    feed_records(records);
+
+    // The head holds 5 records, every other segment is full
+    sample_store_stats_t stats = get_stats();
+    uint32_t live = (FLASH_SEGMENTS - 1) * PAGES_PER_SEGMENT + 5;
+    uint32_t oldest = records - live;
+    TEST_ASSERT_EQUAL_UINT32(0, stats.head_segment);
+    walk_t walk = walk_log();
+    TEST_ASSERT_EQUAL_UINT32(live, walk.records);
+    TEST_ASSERT_EQUAL_UINT32(oldest, walk.first_seq);
+    TEST_ASSERT_EQUAL_UINT32(records - 1, walk.last_seq);
+
+    // Start a sequential read in the oldest segment, then evict that segment
+    sample_store_record_t record;
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_read(0, &record));
+    TEST_ASSERT_EQUAL_UINT32(oldest, record.seq);
+    uint32_t erased = stats.segments_erased;
+    feed_records(PAGES_PER_SEGMENT - 5 + 1);
+    TEST_ASSERT_EQUAL_UINT32(erased + 1, get_stats().segments_erased);
+
+    // The continuation lands on the new oldest record instead of the reused pages
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_read(oldest + 1, &record));
+    TEST_ASSERT_EQUAL_UINT32(oldest + PAGES_PER_SEGMENT, record.seq);
+    TEST_ASSERT_EQUAL(ESP_OK, sample_store_read(record.seq + 1, &record));
+    TEST_ASSERT_EQUAL_UINT32(oldest + PAGES_PER_SEGMENT + 1, record.seq);
+
+    // Recovery after the wrap finds the head by sequence number, not by position
+    reboot();
+    stats = get_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.head_segment);
+    TEST_ASSERT_EQUAL_UINT32(records + PAGES_PER_SEGMENT - 5 + 1 + 1, stats.next_seq);
+    TEST_ASSERT_EQUAL_UINT32(expected_recovery_reads(stats.next_seq), stats.recovery_reads);
+    walk = walk_log();
+    TEST_ASSERT_EQUAL_UINT32((FLASH_SEGMENTS - 1) * PAGES_PER_SEGMENT + 2, walk.records);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.bits_set);
+}
+
+TEST_CASE("no partition, no store", "[sample_store]") {
+    start_over();
+    power_cut();
+    flash.partition.label[0] = '\0';
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, sample_store_init());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, sample_store_deinit());
+    sensor_sample_t sample = next_sample();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, store_callback("dht11", &sample));
+}
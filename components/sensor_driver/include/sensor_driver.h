@@ -0,0 +1,217 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SENSOR_SOURCE_NAME_LEN   16     // Source id length, including terminator
+#define SENSOR_MAX_SOURCES       8      // Sources tracked by the data manager
+
+// Sensor reading shared by all drivers and consumers
+typedef struct {
+    float temperature;     // Temperature in Celsius
+    float humidity;        // Humidity percentage
+    uint64_t timestamp;    // Reading timestamp
+    bool valid;           // Data validity flag
+    uint8_t filter;                // Filter that produced the *_filtered values, 0 if none
+    float temperature_filtered;    // Filtered temperature, published next to the raw value
+    float humidity_filtered;       // Filtered humidity
+} sensor_reading_t;
+
+#define SENSOR_SAMPLE_CHANNELS   2      // Channels carried by sensor_sample_t
+
+/**
+ * @brief Static description of one channel of a source
+ */
+typedef struct {
+    const char *name;              // e.g. "temperature"
+    const char *unit;              // e.g. "°C"
+    uint16_t scale;                // Stored integer steps per unit, 100 for centi-units
+} sensor_channel_desc_t;
+
+// Flag bits of sensor_sample_t
+#define SENSOR_SAMPLE_VALID      (1 << 0)   // Reading passed the driver's validation
+#define SENSOR_SAMPLE_UNSENT     (1 << 1)   // Taken while the uplink was down, forwarded later from flash
+
+/**
+ * @brief Compact fixed-point sample carried through the data path
+ *
+ * Values are in hundredths of the channel unit (0.01 °C, 0.01 %RH), so
+ * the data manager, filters and payload builders never touch floats.
+ * 16 bytes instead of the 32 of a float reading with filtered values.
+ */
+typedef struct {
+    int16_t temperature;           // Centi-degrees Celsius
+    int16_t humidity;              // Centi-percent relative humidity
+    int16_t temperature_filtered;  // Filtered values, equal to raw when no filter is active
+    int16_t humidity_filtered;
+    uint32_t timestamp_ms;         // Low 32 bits of ms since boot, see sensor_sample_time_ms()
+    uint8_t flags;                 // SENSOR_SAMPLE_* bits
+    uint8_t filter;                // Filter that produced the *_filtered values, 0 if none
+} sensor_sample_t;
+
+// printf helpers for centi values, e.g. ESP_LOGI(TAG, "T=" SENSOR_CENTI_FMT, SENSOR_CENTI_ARGS(t))
+#define SENSOR_CENTI_FMT         "%s%d.%02d"
+#define SENSOR_CENTI_ARGS(v)     ((v) < 0 ? "-" : ""), abs((v) / 100), abs((v) % 100)
+#define SENSOR_CENTI_STR_LEN     8      // "-327.68" and the terminator
+
+// A centi value as decimal text, e.g. a JSON number for cJSON_AddRawToObject() that skips double
+static inline const char *sensor_centi_format(int16_t value, char buf[SENSOR_CENTI_STR_LEN]) {
+    snprintf(buf, SENSOR_CENTI_STR_LEN, SENSOR_CENTI_FMT, SENSOR_CENTI_ARGS(value));
+    return buf;
+}
+
+static inline int16_t sensor_centi_from_float(float value) {
+    float scaled = value * 100.0f;
+    if (scaled > INT16_MAX) return INT16_MAX;
+    if (scaled < INT16_MIN) return INT16_MIN;
+    return (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+static inline float sensor_centi_to_float(int16_t value) {
+    return value / 100.0f;
+}
+
+// Expand a sample's 32-bit timestamp against the current time; exact for samples younger than ~49 days
+static inline uint64_t sensor_sample_time_ms(const sensor_sample_t *sample, uint64_t now_ms) {
+    return now_ms - (uint32_t)((uint32_t)now_ms - sample->timestamp_ms);
+}
+
+static inline bool sensor_sample_is_valid(const sensor_sample_t *sample) {
+    return (sample->flags & SENSOR_SAMPLE_VALID) != 0;
+}
+
+// Convert a driver reading at the ingest edge
+static inline void sensor_sample_from_reading(const sensor_reading_t *reading, sensor_sample_t *sample) {
+    sample->temperature = sensor_centi_from_float(reading->temperature);
+    sample->humidity = sensor_centi_from_float(reading->humidity);
+    sample->temperature_filtered = sample->temperature;
+    sample->humidity_filtered = sample->humidity;
+    sample->timestamp_ms = (uint32_t)reading->timestamp;
+    sample->flags = reading->valid ? SENSOR_SAMPLE_VALID : 0;
+    sample->filter = 0;
+}
+
+// Convert for float consumers at the presentation edge
+static inline void sensor_sample_to_reading(const sensor_sample_t *sample, uint64_t now_ms, sensor_reading_t *reading) {
+    reading->temperature = sensor_centi_to_float(sample->temperature);
+    reading->humidity = sensor_centi_to_float(sample->humidity);
+    reading->timestamp = sensor_sample_time_ms(sample, now_ms);
+    reading->valid = sensor_sample_is_valid(sample);
+    reading->filter = sample->filter;
+    reading->temperature_filtered = sensor_centi_to_float(sample->temperature_filtered);
+    reading->humidity_filtered = sensor_centi_to_float(sample->humidity_filtered);
+}
+
+// Sampling cadence statistics for one source
+typedef struct {
+    uint32_t samples;          // Scheduled slots that started a read
+    uint32_t missed_slots;     // Slots skipped because the task ran late
+    uint32_t retries;          // Retries issued in the slack of a period
+    uint32_t retry_successes;  // Retries that produced a valid reading
+    int32_t jitter_last_us;    // Read start minus scheduled slot time
+    int32_t jitter_max_us;     // Largest start delay seen
+    uint32_t jitter_mean_us;   // Mean absolute start deviation
+    uint32_t interval_ms;      // Interval currently scheduled, moves when sampling is adaptive
+} sensor_cadence_stats_t;
+
+#define SENSOR_HISTOGRAM_BUCKETS 12     // Buckets per timing histogram
+
+// Fixed-width histogram of a timing quantity in microseconds
+typedef struct {
+    uint16_t offset_us;        // Lower edge of the first bucket; smaller values land in it
+    uint16_t bucket_us;        // Bucket width; the last bucket also counts values above the range
+    uint32_t buckets[SENSOR_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;         // Sum for the mean
+} sensor_histogram_t;
+
+// Per-read acquisition timing of one source
+typedef struct {
+    uint32_t reads;                    // Acquisitions attempted
+    uint32_t failed_reads;             // Acquisitions without a valid reading
+    sensor_histogram_t latency;        // Read start to decoded frame
+    sensor_histogram_t response_low;   // Width of the sensor's response low
+    sensor_histogram_t response_high;  // Width of the sensor's response high
+    sensor_histogram_t bit_margin;     // Distance of each bit's high width from the decision threshold
+    uint32_t last_min_margin_us;       // Smallest bit margin of the last frame
+} sensor_timing_stats_t;
+
+static inline void sensor_histogram_init(sensor_histogram_t *hist, uint16_t offset_us, uint16_t bucket_us) {
+    *hist = (sensor_histogram_t) { .offset_us = offset_us, .bucket_us = bucket_us, .min_us = UINT32_MAX };
+}
+
+static inline void sensor_histogram_add(sensor_histogram_t *hist, uint32_t value_us) {
+    uint32_t bucket = (value_us > hist->offset_us) ? (value_us - hist->offset_us) / hist->bucket_us : 0;
+    hist->buckets[bucket < SENSOR_HISTOGRAM_BUCKETS ? bucket : SENSOR_HISTOGRAM_BUCKETS - 1]++;
+    hist->count++;
+    hist->total_us += value_us;
+    if (value_us < hist->min_us) hist->min_us = value_us;
+    if (value_us > hist->max_us) hist->max_us = value_us;
+}
+
+// Channels a driver can measure
+#define SENSOR_CHANNEL_TEMPERATURE   (1 << 0)
+#define SENSOR_CHANNEL_HUMIDITY      (1 << 1)
+
+/**
+ * @brief What a driver can do, reported through get_capabilities
+ */
+typedef struct {
+    uint32_t channels;             // SENSOR_CHANNEL_* bitmask
+    uint32_t min_interval_ms;      // Shortest allowed time between triggers
+    float temperature_resolution;  // Smallest temperature step in Celsius
+    float humidity_resolution;     // Smallest humidity step in %RH
+} sensor_capabilities_t;
+
+typedef struct sensor_driver sensor_driver_t;
+
+/**
+ * @brief Sensor driver interface
+ *
+ * Drivers embed this as their first member and recover their own state
+ * with __containerof, the same way RMT encoders are built.
+ */
+struct sensor_driver {
+    const char *name;  // Driver name, e.g. "dht11"
+
+    /**
+     * @brief Prepare the hardware or model for the first trigger
+     */
+    esp_err_t (*init)(sensor_driver_t *driver);
+
+    /**
+     * @brief Start an acquisition; may block until the sample is captured
+     */
+    esp_err_t (*trigger)(sensor_driver_t *driver);
+
+    /**
+     * @brief Fetch the result of the last trigger
+     */
+    esp_err_t (*read)(sensor_driver_t *driver, sensor_reading_t *reading);
+
+    /**
+     * @brief Describe the driver's channels and timing limits
+     */
+    void (*get_capabilities)(sensor_driver_t *driver, sensor_capabilities_t *caps);
+};
+
+static inline esp_err_t sensor_driver_init(sensor_driver_t *driver) {
+    return driver->init ? driver->init(driver) : ESP_OK;
+}
+
+static inline esp_err_t sensor_driver_trigger(sensor_driver_t *driver) {
+    return driver->trigger(driver);
+}
+
+static inline esp_err_t sensor_driver_read(sensor_driver_t *driver, sensor_reading_t *reading) {
+    return driver->read(driver, reading);
+}
+
+static inline void sensor_driver_get_capabilities(sensor_driver_t *driver, sensor_capabilities_t *caps) {
+    driver->get_capabilities(driver, caps);
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "unity.h"
+#include "sensor_driver.h"
+#include "sensor_filter.h"
+
+/*
+ * Per-sample cost of the data path with float readings against the
+ * fixed-point samples that replaced them: frame bytes to values, an EWMA
+ * step, and the JSON number formatting of the sample payload. The float
+ * side reproduces what the path did before: the float EWMA of the old
+ * filter, and cJSON's number printing (%1.15g, checked by strtod, else
+ * %1.17g). Host timings only rank the two; the ESP32-S3 FPU is single
+ * precision, so the double math behind that formatting runs in software.
+ */
+
+#define BENCH_SAMPLES       204800
+#define BENCH_BATCH         256     // Samples per timed batch, keeps the clock reads out of the figures
+#define BENCH_EWMA_ALPHA    0.3f
+
+// Float EWMA as the filter ran it before the fixed-point data path
+typedef struct {
+    float estimate;
+    bool primed;
+} float_ewma_t;
+
+static float float_ewma_update(float_ewma_t *ewma, float value) {
+    if (!ewma->primed) {
+        ewma->estimate = value;
+        ewma->primed = true;
+    } else {
+        ewma->estimate += BENCH_EWMA_ALPHA * (value - ewma->estimate);
+    }
+    return ewma->estimate;
+}
+
+// cJSON_AddNumberToObject() formatting of a float widened to double
+static int print_cjson_number(char *buf, size_t size, double value) {
+    int len = snprintf(buf, size, "%1.15g", value);
+    if (strtod(buf, NULL) != value) {
+        len = snprintf(buf, size, "%1.17g", value);
+    }
+    return len;
+}
+
+// DHT11-like frame bytes: humidity int/dec, temperature int/dec
+static void frame_bytes(uint32_t i, uint8_t data[4]) {
+    data[0] = 40 + (i / 7) % 20;
+    data[1] = 0;
+    data[2] = 20 + (i / 13) % 8;
+    data[3] = i % 10;
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+TEST_CASE("float and fixed-point sample path", "[sensor_driver][bench]") {
+    static sensor_reading_t readings[BENCH_BATCH];
+    static sensor_sample_t samples[BENCH_BATCH];
+    char payload[160];
+    char temp[32], hum[32];
+    uint8_t data[4];
+    unsigned sink = 0;
+    struct timespec t0, t1, t2, t3;
+
+    // Float path: sensor_reading_t, float EWMA, double formatting
+    float_ewma_t ewma_t = {0}, ewma_h = {0};
+    double float_convert = 0, float_filter = 0, float_format = 0;
+    for (uint32_t base = 0; base < BENCH_SAMPLES; base += BENCH_BATCH) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+            sensor_reading_t *reading = &readings[k];
+            frame_bytes(base + k, data);
+            reading->humidity = (float)data[0] + (float)data[1] / 10.0f;
+            reading->temperature = (float)data[2] + (float)data[3] / 10.0f;
+            reading->timestamp = (base + k) * 2000ull;
+            reading->valid = true;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+            readings[k].temperature_filtered = float_ewma_update(&ewma_t, readings[k].temperature);
+            readings[k].humidity_filtered = float_ewma_update(&ewma_h, readings[k].humidity);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+            print_cjson_number(temp, sizeof(temp), readings[k].temperature_filtered);
+            print_cjson_number(hum, sizeof(hum), readings[k].humidity_filtered);
+            sink += snprintf(payload, sizeof(payload), "{\"temperature\":%s,\"humidity\":%s,\"timestamp\":%llu}",
+                             temp, hum, (unsigned long long)readings[k].timestamp);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t3);
+        float_convert += elapsed_ns(&t0, &t1);
+        float_filter += elapsed_ns(&t1, &t2);
+        float_format += elapsed_ns(&t2, &t3);
+    }
+
+    // Fixed-point path: sensor_sample_t, the Q8 EWMA of sensor_filter, integer formatting
+    sensor_filter_config_t config = SENSOR_FILTER_DEFAULT_CONFIG();
+    config.type = SENSOR_FILTER_EWMA;
+    config.ewma_alpha = BENCH_EWMA_ALPHA;
+    sensor_filter_t filter;
+    TEST_ASSERT_EQUAL(ESP_OK, sensor_filter_init(&filter, &config));
+    double fixed_convert = 0, fixed_filter = 0, fixed_format = 0;
+    for (uint32_t base = 0; base < BENCH_SAMPLES; base += BENCH_BATCH) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+            sensor_sample_t *sample = &samples[k];
+            frame_bytes(base + k, data);
+            sample->humidity = (int16_t)(data[0] * 100 + data[1] * 10);
+            sample->temperature = (int16_t)(data[2] * 100 + data[3] * 10);
+            sample->timestamp_ms = (base + k) * 2000u;
+            sample->flags = SENSOR_SAMPLE_VALID;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+            sensor_filter_apply(&filter, &samples[k]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+            const sensor_sample_t *sample = &samples[k];
+            sink += snprintf(payload, sizeof(payload),
+                             "{\"temperature\":" SENSOR_CENTI_FMT ",\"humidity\":" SENSOR_CENTI_FMT ",\"timestamp\":%lu}",
+                             SENSOR_CENTI_ARGS(sample->temperature_filtered),
+                             SENSOR_CENTI_ARGS(sample->humidity_filtered), (unsigned long)sample->timestamp_ms);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t3);
+        fixed_convert += elapsed_ns(&t0, &t1);
+        fixed_filter += elapsed_ns(&t1, &t2);
+        fixed_format += elapsed_ns(&t2, &t3);
+    }
+
+    // Both paths filter to the same values within a centi step
+    for (uint32_t k = 0; k < BENCH_BATCH; k++) {
+        TEST_ASSERT_INT_WITHIN(1, sensor_centi_from_float(readings[k].temperature_filtered),
+                               samples[k].temperature_filtered);
+    }
+
+    printf("per sample, ns                            float   fixed\n");
+    printf("  frame bytes to values                 %7.1f %7.1f\n",
+           float_convert / BENCH_SAMPLES, fixed_convert / BENCH_SAMPLES);
+    printf("  EWMA step, both channels              %7.1f %7.1f\n",
+           float_filter / BENCH_SAMPLES, fixed_filter / BENCH_SAMPLES);
+    printf("  JSON sample payload                   %7.1f %7.1f\n",
+           float_format / BENCH_SAMPLES, fixed_format / BENCH_SAMPLES);
+    printf("bytes per stored sample                 %7zu %7zu\n",
+           sizeof(sensor_reading_t), sizeof(sensor_sample_t));
+    printf("(sink %u)\n", sink);
+}
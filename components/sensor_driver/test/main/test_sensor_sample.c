@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include "unity.h"
+#include "sensor_driver.h"
+
+TEST_CASE("sample stays at 16 bytes", "[sensor_driver]") {
+    TEST_ASSERT_EQUAL(16, sizeof(sensor_sample_t));
+}
+
+TEST_CASE("float to centi rounds to nearest and clamps", "[sensor_driver]") {
+    TEST_ASSERT_EQUAL_INT16(2370, sensor_centi_from_float(23.7f));
+    TEST_ASSERT_EQUAL_INT16(4100, sensor_centi_from_float(41.0f));
+    TEST_ASSERT_EQUAL_INT16(-5, sensor_centi_from_float(-0.05f));
+    TEST_ASSERT_EQUAL_INT16(-1234, sensor_centi_from_float(-12.34f));
+    TEST_ASSERT_EQUAL_INT16(1, sensor_centi_from_float(0.006f));
+    TEST_ASSERT_EQUAL_INT16(INT16_MAX, sensor_centi_from_float(1000.0f));
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN, sensor_centi_from_float(-1000.0f));
+}
+
+TEST_CASE("centi values print with sign and two decimals", "[sensor_driver]") {
+    const struct {
+        int16_t value;
+        const char *text;
+    } cases[] = {
+        { 2370, "23.70" }, { 5, "0.05" }, { -5, "-0.05" }, { -1234, "-12.34" }, { 0, "0.00" },
+        { INT16_MIN, "-327.68" }, { INT16_MAX, "327.67" },
+    };
+    char buf[16];
+    char number[SENSOR_CENTI_STR_LEN];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        snprintf(buf, sizeof(buf), SENSOR_CENTI_FMT, SENSOR_CENTI_ARGS(cases[i].value));
+        TEST_ASSERT_EQUAL_STRING(cases[i].text, buf);
+        TEST_ASSERT_EQUAL_STRING(cases[i].text, sensor_centi_format(cases[i].value, number));
+    }
+}
+
+TEST_CASE("timestamps widen across the 32-bit wrap", "[sensor_driver]") {
+    sensor_sample_t sample = { .timestamp_ms = 0xFFFFFF00u };
+    TEST_ASSERT_EQUAL_UINT64(0x1FFFFFF00ull, sensor_sample_time_ms(&sample, 0x200000100ull));
+    sample.timestamp_ms = 1000;
+    TEST_ASSERT_EQUAL_UINT64(1000, sensor_sample_time_ms(&sample, 5000));
+}
+
+TEST_CASE("reading and sample convert both ways", "[sensor_driver]") {
+    sensor_reading_t reading = {
+        .temperature = 21.4f, .humidity = 55.0f, .timestamp = 123456, .valid = true
+    };
+    sensor_sample_t sample;
+    sensor_sample_from_reading(&reading, &sample);
+    TEST_ASSERT_EQUAL_INT16(2140, sample.temperature);
+    TEST_ASSERT_EQUAL_INT16(5500, sample.humidity);
+    TEST_ASSERT_EQUAL_INT16(2140, sample.temperature_filtered);
+    TEST_ASSERT_TRUE(sensor_sample_is_valid(&sample));
+
+    sample.temperature_filtered = 2135;
+    sample.filter = 2;
+    sensor_reading_t back;
+    sensor_sample_to_reading(&sample, 123456, &back);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.4f, back.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.35f, back.temperature_filtered);
+    TEST_ASSERT_EQUAL_UINT64(123456, back.timestamp);
+    TEST_ASSERT_TRUE(back.valid);
+    TEST_ASSERT_EQUAL_UINT8(2, back.filter);
+}
+
+TEST_CASE("histogram buckets clamp at both ends", "[sensor_driver]") {
+    sensor_histogram_t hist;
+    sensor_histogram_init(&hist, 60, 4);
+    sensor_histogram_add(&hist, 10);      // Below the offset
+    sensor_histogram_add(&hist, 81);
+    sensor_histogram_add(&hist, 500);     // Above the range
+    TEST_ASSERT_EQUAL_UINT32(1, hist.buckets[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, hist.buckets[5]);
+    TEST_ASSERT_EQUAL_UINT32(1, hist.buckets[SENSOR_HISTOGRAM_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL_UINT32(3, hist.count);
+    TEST_ASSERT_EQUAL_UINT32(10, hist.min_us);
+    TEST_ASSERT_EQUAL_UINT32(500, hist.max_us);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensor_driver.h"
+
+#define SENSOR_FILTER_MEDIAN_MAX     9      // Largest sliding median window
+
+// Filter applied to each channel of a source
+typedef enum {
+    SENSOR_FILTER_NONE = 0,        // Filtered values equal the raw values
+    SENSOR_FILTER_MEDIAN,          // Sliding median over the last median_window samples
+    SENSOR_FILTER_EWMA,            // Exponentially weighted moving average
+    SENSOR_FILTER_KALMAN           // Scalar Kalman filter with a constant-value model
+} sensor_filter_type_t;
+
+/**
+ * @brief Filter selection and tuning
+ */
+typedef struct {
+    sensor_filter_type_t type;
+    uint8_t median_window;         // Odd, 3..SENSOR_FILTER_MEDIAN_MAX
+    float ewma_alpha;              // Weight of the newest sample, 0 < alpha <= 1
+    float kalman_q;                // Process noise variance per sample, in unit^2
+    float kalman_r;                // Measurement noise variance, in unit^2
+} sensor_filter_config_t;
+
+#define SENSOR_FILTER_DEFAULT_CONFIG() { \
+    .type = SENSOR_FILTER_NONE,          \
+    .median_window = 5,                  \
+    .ewma_alpha = 0.3f,                  \
+    .kalman_q = 0.01f,                   \
+    .kalman_r = 1.0f,                    \
+}
+
+// State of one filtered channel, values in centi-units
+typedef struct {
+    int16_t window[SENSOR_FILTER_MEDIAN_MAX];  // Median ring buffer
+    uint8_t head;
+    uint8_t count;
+    int32_t ewma_q8;               // EWMA estimate, centi-units << 8
+    float estimate;                // Kalman estimate
+    float variance;                // Kalman error variance
+    bool primed;                   // Estimate seeded from the first sample
+} sensor_filter_channel_t;
+
+/**
+ * @brief Filter state of one source, fixed size with no allocation
+ */
+typedef struct {
+    sensor_filter_config_t config;
+    int32_t ewma_alpha_q8;         // ewma_alpha in 1/256 steps
+    sensor_filter_channel_t temperature;
+    sensor_filter_channel_t humidity;
+} sensor_filter_t;
+
+/**
+ * @brief Check a filter configuration
+ *
+ * @param config Configuration to check
+ * @return esp_err_t ESP_OK if usable, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t sensor_filter_validate(const sensor_filter_config_t *config);
+
+/**
+ * @brief Configure a filter and clear its history
+ *
+ * @param filter Filter state
+ * @param config Configuration, NULL for defaults
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_filter_init(sensor_filter_t *filter, const sensor_filter_config_t *config);
+
+/**
+ * @brief Feed a valid sample and fill in its filtered values
+ *
+ * Constant time and memory per sample. Median and EWMA run in integer
+ * arithmetic; only the Kalman filter uses floats internally. The raw
+ * values are left untouched.
+ *
+ * @param filter Filter state
+ * @param sample Sample to filter in place
+ */
+void sensor_filter_apply(sensor_filter_t *filter, sensor_sample_t *sample);
+
+/**
+ * @brief Get a short name for a filter type, e.g. "median"
+ */
+const char *sensor_filter_type_name(sensor_filter_type_t type);
+
+/**
+ * @brief Parse a filter type name
+ *
+ * @param name Name as returned by sensor_filter_type_name
+ * @param type Parsed type
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for unknown names
+ */
+esp_err_t sensor_filter_type_from_name(const char *name, sensor_filter_type_t *type);
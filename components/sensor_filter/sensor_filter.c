@@ -0,0 +1,150 @@
+#include <string.h>
+#include "sensor_filter.h"
+
+static const char *const filter_names[] = {
+    [SENSOR_FILTER_NONE] = "none",
+    [SENSOR_FILTER_MEDIAN] = "median",
+    [SENSOR_FILTER_EWMA] = "ewma",
+    [SENSOR_FILTER_KALMAN] = "kalman",
+};
+
+static int16_t median_update(sensor_filter_channel_t *channel, uint8_t window, int16_t value) {
+    channel->window[channel->head] = value;
+    channel->head = (channel->head + 1) % window;
+    if (channel->count < window) {
+        channel->count++;
+    }
+
+    // Insertion sort of at most SENSOR_FILTER_MEDIAN_MAX values
+    int16_t sorted[SENSOR_FILTER_MEDIAN_MAX];
+    for (uint8_t i = 0; i < channel->count; i++) {
+        int16_t v = channel->window[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+
+    if (channel->count % 2) {
+        return sorted[channel->count / 2];
+    }
+    return (int16_t)(((int32_t)sorted[channel->count / 2 - 1] + sorted[channel->count / 2]) / 2);
+}
+
+static int16_t ewma_update(sensor_filter_channel_t *channel, int32_t alpha_q8, int16_t value) {
+    int32_t value_q8 = (int32_t)value * 256;
+    if (!channel->primed) {
+        channel->ewma_q8 = value_q8;
+        channel->primed = true;
+    } else {
+        channel->ewma_q8 += (alpha_q8 * (value_q8 - channel->ewma_q8)) / 256;
+    }
+    return (int16_t)((channel->ewma_q8 + (channel->ewma_q8 < 0 ? -128 : 128)) / 256);
+}
+
+// Runs in channel units so q and r keep their meaning; the only float math in the data path
+static int16_t kalman_update(sensor_filter_channel_t *channel, float q, float r, int16_t value) {
+    float measurement = sensor_centi_to_float(value);
+    if (!channel->primed) {
+        channel->estimate = measurement;
+        channel->variance = r;
+        channel->primed = true;
+        return value;
+    }
+
+    // Predict with a constant model, then correct with the new measurement
+    float predicted_variance = channel->variance + q;
+    float gain = predicted_variance / (predicted_variance + r);
+    channel->estimate += gain * (measurement - channel->estimate);
+    channel->variance = (1.0f - gain) * predicted_variance;
+    return sensor_centi_from_float(channel->estimate);
+}
+
+static int16_t channel_update(sensor_filter_t *filter, sensor_filter_channel_t *channel, int16_t value) {
+    const sensor_filter_config_t *config = &filter->config;
+
+    switch (config->type) {
+        case SENSOR_FILTER_MEDIAN:
+            return median_update(channel, config->median_window, value);
+        case SENSOR_FILTER_EWMA:
+            return ewma_update(channel, filter->ewma_alpha_q8, value);
+        case SENSOR_FILTER_KALMAN:
+            return kalman_update(channel, config->kalman_q, config->kalman_r, value);
+        case SENSOR_FILTER_NONE:
+        default:
+            return value;
+    }
+}
+
+esp_err_t sensor_filter_validate(const sensor_filter_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switch (config->type) {
+        case SENSOR_FILTER_NONE:
+            return ESP_OK;
+        case SENSOR_FILTER_MEDIAN:
+            return (config->median_window >= 3 && config->median_window <= SENSOR_FILTER_MEDIAN_MAX &&
+                    (config->median_window % 2) == 1) ? ESP_OK : ESP_ERR_INVALID_ARG;
+        case SENSOR_FILTER_EWMA:
+            return (config->ewma_alpha > 0.0f && config->ewma_alpha <= 1.0f) ? ESP_OK : ESP_ERR_INVALID_ARG;
+        case SENSOR_FILTER_KALMAN:
+            return (config->kalman_q >= 0.0f && config->kalman_r > 0.0f) ? ESP_OK : ESP_ERR_INVALID_ARG;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+esp_err_t sensor_filter_init(sensor_filter_t *filter, const sensor_filter_config_t *config) {
+    static const sensor_filter_config_t default_config = SENSOR_FILTER_DEFAULT_CONFIG();
+
+    if (filter == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config == NULL) {
+        config = &default_config;
+    }
+
+    esp_err_t ret = sensor_filter_validate(config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memset(filter, 0, sizeof(*filter));
+    filter->config = *config;
+    filter->ewma_alpha_q8 = (int32_t)(config->ewma_alpha * 256.0f + 0.5f);
+    if (filter->ewma_alpha_q8 < 1) {
+        filter->ewma_alpha_q8 = 1;
+    }
+    return ESP_OK;
+}
+
+void sensor_filter_apply(sensor_filter_t *filter, sensor_sample_t *sample) {
+    sample->filter = filter->config.type;
+    sample->temperature_filtered = channel_update(filter, &filter->temperature, sample->temperature);
+    sample->humidity_filtered = channel_update(filter, &filter->humidity, sample->humidity);
+}
+
+const char *sensor_filter_type_name(sensor_filter_type_t type) {
+    if ((unsigned)type >= sizeof(filter_names) / sizeof(filter_names[0])) {
+        return "unknown";
+    }
+    return filter_names[type];
+}
+
+esp_err_t sensor_filter_type_from_name(const char *name, sensor_filter_type_t *type) {
+    if (name == NULL || type == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < sizeof(filter_names) / sizeof(filter_names[0]); i++) {
+        if (strcmp(name, filter_names[i]) == 0) {
+            *type = (sensor_filter_type_t)i;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Trace format, one reading per line:
+ *
+ *     <timestamp_ms>,<source>,<temperature>,<humidity>[,<valid>]
+ *
+ * Timestamps only need to be monotonic; the first one is the replay origin.
+ * Published samples carry ms since boot like live ones: the replay start
+ * plus the trace offset divided by the speedup, or the publish time when
+ * replaying as fast as possible. Empty lines and lines starting with '#'
+ * are skipped.
+ */
+
+#define SENSOR_REPLAY_STDIN         "-"     // Path that selects stdin
+
+/**
+ * @brief Replay configuration
+ */
+typedef struct {
+    const char *path;           // Trace file (e.g. "/spiffs/trace.csv") or SENSOR_REPLAY_STDIN
+    uint32_t speedup;           // 1 = original timing, N = N times faster, 0 = as fast as possible
+    uint32_t loops;             // Times to replay a file trace (0 = once)
+} sensor_replay_config_t;
+
+/**
+ * @brief Replay run report
+ */
+typedef struct {
+    bool running;
+    uint32_t samples;           // Readings published
+    uint32_t publish_errors;    // Readings rejected by the data manager
+    uint32_t parse_errors;      // Malformed trace lines
+    uint32_t late_samples;      // Readings published after their scaled due time
+    uint64_t elapsed_us;        // Wall time of the run
+    float samples_per_sec;      // Sustained end-to-end publish rate
+    uint32_t heap_free_start;   // Free heap when the run started
+    uint32_t heap_free_end;     // Free heap when the run finished
+    uint32_t heap_low_water;    // Lowest free heap observed during the run
+    uint32_t stack_low_water;   // Replay task stack high-water mark (bytes)
+} sensor_replay_stats_t;
+
+/**
+ * @brief Start replaying a recorded trace into the data manager
+ *
+ * @param config Replay configuration, path is copied
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_replay_start(const sensor_replay_config_t *config);
+
+/**
+ * @brief Abort a running replay
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_replay_stop(void);
+
+/**
+ * @brief Get the report of the current or last replay run
+ *
+ * @param stats Pointer to store the report
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_replay_get_stats(sensor_replay_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
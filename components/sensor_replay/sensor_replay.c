@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sensor_replay.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sensor_driver.h"
+#include "data_manager.h"
+#include "error_handler.h"
+
+static const char *TAG = "sensor_replay";
+
+#define REPLAY_TASK_STACK_SIZE      4096
+#define REPLAY_TASK_PRIORITY        5
+#define REPLAY_PATH_MAX             64
+#define REPLAY_LINE_MAX             96
+#define REPLAY_PROGRESS_INTERVAL    10000   // Samples between progress logs
+
+static TaskHandle_t replay_task_handle = NULL;
+static volatile bool stop_requested = false;
+static char replay_path[REPLAY_PATH_MAX];
+static sensor_replay_config_t replay_config;
+
+static sensor_replay_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Parse a decimal such as "-12.34" into centi-units without float math
+static bool parse_centi(const char *text, int16_t *value) {
+    while (*text == ' ') {
+        text++;
+    }
+    bool negative = (*text == '-');
+    if (*text == '-' || *text == '+') {
+        text++;
+    }
+
+    int32_t whole = 0;
+    int digits = 0;
+    while (*text >= '0' && *text <= '9') {
+        whole = whole * 10 + (*text++ - '0');
+        if (whole > -(INT16_MIN / 100)) {
+            return false;
+        }
+        digits++;
+    }
+
+    int32_t fraction = 0;
+    if (*text == '.') {
+        text++;
+        for (int scale = 10; *text >= '0' && *text <= '9'; text++, scale /= 10) {
+            fraction += (*text - '0') * scale;   // Digits past hundredths are dropped
+            digits++;
+        }
+    }
+
+    if (digits == 0) {
+        return false;
+    }
+    // One more step below zero than above: -327.68 is the smallest centi value
+    int32_t centi = negative ? -(whole * 100 + fraction) : whole * 100 + fraction;
+    if (centi < INT16_MIN || centi > INT16_MAX) {
+        return false;
+    }
+    *value = (int16_t)centi;
+    return true;
+}
+
+// Parse one trace line, returns false for malformed lines
+static bool parse_line(char *line, uint64_t *timestamp_ms, char *source, size_t source_len,
+                       sensor_sample_t *sample) {
+    char *save = NULL;
+    char *fields[5] = {0};
+    int count = 0;
+
+    for (char *token = strtok_r(line, ",\r\n", &save); token != NULL && count < 5;
+         token = strtok_r(NULL, ",\r\n", &save)) {
+        fields[count++] = token;
+    }
+    if (count < 4) {
+        return false;
+    }
+
+    char *end;
+    *timestamp_ms = strtoull(fields[0], &end, 10);
+    if (end == fields[0]) {
+        return false;
+    }
+
+    while (*fields[1] == ' ') {
+        fields[1]++;
+    }
+    if (*fields[1] == '\0' || strlen(fields[1]) >= source_len) {
+        return false;
+    }
+    strlcpy(source, fields[1], source_len);
+
+    if (!parse_centi(fields[2], &sample->temperature) || !parse_centi(fields[3], &sample->humidity)) {
+        return false;
+    }
+    sample->temperature_filtered = sample->temperature;
+    sample->humidity_filtered = sample->humidity;
+    sample->filter = 0;
+    sample->flags = ((count < 5) || atoi(fields[4]) != 0) ? SENSOR_SAMPLE_VALID : 0;
+    return true;
+}
+
+static void update_stats(uint32_t heap_free) {
+    portENTER_CRITICAL(&stats_lock);
+    if (heap_free < stats.heap_low_water) {
+        stats.heap_low_water = heap_free;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Replay one pass over the trace, returns the time span it covered;
+// trace_offset_ms places the pass after the earlier ones on the replay timeline
+static uint64_t replay_pass(FILE *trace, int64_t start_us, uint64_t trace_offset_ms) {
+    char line[REPLAY_LINE_MAX];
+    char source[SENSOR_SOURCE_NAME_LEN];
+    char cached_source[SENSOR_SOURCE_NAME_LEN] = "";
+    data_manager_handle_t handle = DATA_MANAGER_INVALID_HANDLE;
+    sensor_sample_t sample;
+    uint64_t origin_ms = 0;
+    uint64_t last_ms = 0;
+    bool have_origin = false;
+
+    while (!stop_requested && fgets(line, sizeof(line), trace) != NULL) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == '\0') {
+            continue;
+        }
+
+        uint64_t timestamp_ms;
+        if (!parse_line(line, &timestamp_ms, source, sizeof(source), &sample)) {
+            portENTER_CRITICAL(&stats_lock);
+            stats.parse_errors++;
+            portEXIT_CRITICAL(&stats_lock);
+            continue;
+        }
+
+        if (!have_origin) {
+            origin_ms = timestamp_ms;
+            have_origin = true;
+        }
+        if (timestamp_ms < last_ms) {
+            timestamp_ms = last_ms;     // Clamp non-monotonic input
+        }
+        last_ms = timestamp_ms;
+
+        // Pace to the scaled trace time; gaps shorter than a tick are batched
+        bool late = false;
+        int64_t due_us = esp_timer_get_time();
+        if (replay_config.speedup > 0) {
+            due_us = start_us +
+                (int64_t)((timestamp_ms - origin_ms + trace_offset_ms) * 1000 / replay_config.speedup);
+            int64_t ahead_us = due_us - esp_timer_get_time();
+            TickType_t ticks = (ahead_us > 0) ? pdMS_TO_TICKS(ahead_us / 1000) : 0;
+            if (ticks > 0) {
+                vTaskDelay(ticks);
+            } else if (ahead_us < -(int64_t)portTICK_PERIOD_MS * 1000) {
+                late = true;
+            }
+        }
+
+        // Traces are usually long runs of one source, so only a change costs a lookup
+        esp_err_t ret = ESP_OK;
+        if (handle == DATA_MANAGER_INVALID_HANDLE || strcmp(source, cached_source) != 0) {
+            ret = data_manager_register_source(source, NULL, &handle);
+            if (ret == ESP_OK) {
+                strlcpy(cached_source, source, sizeof(cached_source));
+            } else {
+                handle = DATA_MANAGER_INVALID_HANDLE;
+            }
+        }
+
+        // Rebased onto ms since boot, which rollups, history queries and wall-clock conversion expect
+        sample.timestamp_ms = (uint32_t)(due_us / 1000);
+        if (ret == ESP_OK) {
+            ret = data_manager_publish(handle, &sample);
+        }
+        uint32_t heap_free = esp_get_free_heap_size();
+
+        portENTER_CRITICAL(&stats_lock);
+        if (ret == ESP_OK) {
+            stats.samples++;
+        } else {
+            stats.publish_errors++;
+        }
+        if (late) {
+            stats.late_samples++;
+        }
+        uint32_t total = stats.samples + stats.publish_errors;
+        portEXIT_CRITICAL(&stats_lock);
+        update_stats(heap_free);
+
+        if (total % REPLAY_PROGRESS_INTERVAL == 0) {
+            ESP_LOGI(TAG, "Replayed %lu samples, free heap %lu", total, heap_free);
+        }
+    }
+
+    return have_origin ? (last_ms - origin_ms) : 0;
+}
+
+static void replay_task(void *pvParameters) {
+    bool from_stdin = strcmp(replay_path, SENSOR_REPLAY_STDIN) == 0;
+    FILE *trace = from_stdin ? stdin : fopen(replay_path, "r");
+    int64_t start_us = esp_timer_get_time();
+
+    if (trace == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NOT_FOUND, ERROR_CAT_STORAGE, "Failed to open trace %s", replay_path);
+    } else {
+        uint32_t passes = (from_stdin || replay_config.loops == 0) ? 1 : replay_config.loops;
+        uint64_t offset_ms = 0;
+
+        for (uint32_t pass = 0; pass < passes && !stop_requested; pass++) {
+            if (pass > 0) {
+                rewind(trace);
+            }
+            // Shift later passes so timestamps keep increasing
+            offset_ms += replay_pass(trace, start_us, offset_ms) + 1;
+        }
+
+        if (!from_stdin) {
+            fclose(trace);
+        }
+    }
+
+    uint64_t elapsed_us = esp_timer_get_time() - start_us;
+    uint32_t heap_free = esp_get_free_heap_size();
+    update_stats(heap_free);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.elapsed_us = elapsed_us;
+    stats.samples_per_sec = elapsed_us ? (float)stats.samples * 1000000.0f / (float)elapsed_us : 0.0f;
+    stats.heap_free_end = heap_free;
+    stats.stack_low_water = uxTaskGetStackHighWaterMark(NULL) * sizeof(StackType_t);
+    stats.running = false;
+    sensor_replay_stats_t report = stats;
+    portEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGI(TAG, "Replay %s: %lu samples in %.2f s (%.1f samples/s), %lu late, "
+             "%lu publish errors, %lu parse errors",
+             stop_requested ? "aborted" : "finished", report.samples,
+             report.elapsed_us / 1000000.0f, report.samples_per_sec, report.late_samples,
+             report.publish_errors, report.parse_errors);
+    ESP_LOGI(TAG, "Heap: start %lu, end %lu (delta %ld), low-water %lu, since boot %lu; "
+             "task stack low-water %lu bytes",
+             report.heap_free_start, report.heap_free_end,
+             (int32_t)(report.heap_free_start - report.heap_free_end), report.heap_low_water,
+             esp_get_minimum_free_heap_size(), report.stack_low_water);
+
+    replay_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t sensor_replay_start(const sensor_replay_config_t *config) {
+    if (config == NULL || config->path == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Invalid replay configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (replay_task_handle != NULL) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_STATE, ERROR_CAT_SYSTEM, "Replay already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (strlcpy(replay_path, config->path, sizeof(replay_path)) >= sizeof(replay_path)) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION, "Trace path too long");
+        return ESP_ERR_INVALID_ARG;
+    }
+    replay_config = *config;
+    replay_config.path = replay_path;
+    stop_requested = false;
+
+    uint32_t heap_free = esp_get_free_heap_size();
+    portENTER_CRITICAL(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    stats.running = true;
+    stats.heap_free_start = heap_free;
+    stats.heap_low_water = heap_free;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (xTaskCreate(replay_task, "sensor_replay", REPLAY_TASK_STACK_SIZE,
+                    NULL, REPLAY_TASK_PRIORITY, &replay_task_handle) != pdPASS) {
+        ERROR_LOG_ERROR(TAG, ESP_FAIL, ERROR_CAT_SYSTEM, "Failed to create replay task");
+        stats.running = false;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Replaying %s at %s", replay_path,
+             config->speedup == 0 ? "full speed" : "scaled timing");
+    return ESP_OK;
+}
+
+esp_err_t sensor_replay_stop(void) {
+    if (replay_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The task finishes the current line and reports
+    stop_requested = true;
+    return ESP_OK;
+}
+
+esp_err_t sensor_replay_get_stats(sensor_replay_stats_t *out) {
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
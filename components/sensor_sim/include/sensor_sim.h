@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include "sensor_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Simulated signal shapes
+ */
+typedef enum {
+    SENSOR_SIM_WAVE_CONSTANT = 0,   // Always the base value
+    SENSOR_SIM_WAVE_SINE,           // base + amplitude * sin
+    SENSOR_SIM_WAVE_TRIANGLE,       // Linear ramp up and down
+    SENSOR_SIM_WAVE_SQUARE,         // Steps between base +/- amplitude
+    SENSOR_SIM_WAVE_RANDOM_WALK     // Seeded random walk bounded by amplitude
+} sensor_sim_wave_t;
+
+/**
+ * @brief One simulated channel
+ */
+typedef struct {
+    sensor_sim_wave_t wave;
+    float base;                // Center value
+    float amplitude;           // Peak deviation from base
+    uint32_t period_samples;   // Samples per waveform period
+    float noise;               // Peak uniform noise added to every sample
+} sensor_sim_channel_t;
+
+/**
+ * @brief Simulated driver configuration
+ *
+ * Output depends only on the sample index and seed, never on wall time,
+ * so a run is reproducible at any rate.
+ */
+typedef struct {
+    sensor_sim_channel_t temperature;
+    sensor_sim_channel_t humidity;
+    uint32_t seed;             // PRNG seed for noise and random walk
+    uint32_t fault_period;     // Every fault_period samples...
+    uint32_t fault_length;     // ...the first fault_length triggers fail (0 disables)
+    uint32_t invalid_period;   // Every Nth sample is returned with valid=false (0 disables)
+    uint32_t min_interval_ms;  // Reported minimum trigger interval
+} sensor_sim_config_t;
+
+#define SENSOR_SIM_DEFAULT_CONFIG() {                                           \
+    .temperature = { SENSOR_SIM_WAVE_SINE, 24.0f, 3.0f, 1800, 0.2f },         \
+    .humidity = { SENSOR_SIM_WAVE_RANDOM_WALK, 50.0f, 10.0f, 0, 0.5f },       \
+    .seed = 1,                                                                 \
+    .fault_period = 0,                                                         \
+    .fault_length = 0,                                                         \
+    .invalid_period = 0,                                                       \
+    .min_interval_ms = 1,                                                      \
+}
+
+/**
+ * @brief Create a simulated sensor driver
+ * 
+ * @param config Waveform and fault configuration
+ * @param ret_driver Returned driver interface
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_sim_new(const sensor_sim_config_t *config, sensor_driver_t **ret_driver);
+
+/**
+ * @brief Delete a simulated sensor driver
+ * 
+ * @param driver Driver returned by sensor_sim_new
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_sim_del(sensor_driver_t *driver);
+
+/**
+ * @brief Start a task that triggers any sensor driver and publishes to the data manager
+ * 
+ * @param driver Driver to sample
+ * @param source Data manager source id
+ * Readings that fail the driver's validation are published without
+ * SENSOR_SAMPLE_VALID; failed triggers and reads publish nothing.
+ *
+ * @param interval_ms Sampling interval, clamped to the driver's minimum, then
+ *                    rounded down to whole FreeRTOS ticks and at least one tick
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_sim_start(sensor_driver_t *driver, const char *source, uint32_t interval_ms);
+
+/**
+ * @brief Stop the task started by sensor_sim_start
+ * 
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_sim_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,245 @@
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "sensor_sim.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "data_manager.h"
+#include "error_handler.h"
+
+static const char *TAG = "sensor_sim";
+
+#define SENSOR_SIM_TASK_STACK_SIZE   3072
+#define SENSOR_SIM_TASK_PRIORITY     5
+#define SENSOR_SIM_PI                3.14159265f
+
+// Simulated driver state
+typedef struct {
+    sensor_driver_t base;           // Generic driver interface, must stay first
+    sensor_sim_config_t config;
+    uint32_t sample_index;          // Samples generated so far
+    uint32_t rng_state;             // xorshift32 state
+    float temperature_walk;         // Random walk offsets from base
+    float humidity_walk;
+    sensor_reading_t last_reading;
+} sensor_sim_t;
+
+// Runner task state
+typedef struct {
+    sensor_driver_t *driver;
+    char source[SENSOR_SOURCE_NAME_LEN];
+    data_manager_handle_t data_handle;
+    uint32_t interval_ms;
+} sensor_sim_runner_t;
+
+static TaskHandle_t runner_task_handle = NULL;
+static sensor_sim_runner_t runner;
+
+// Deterministic uniform value in [-1, 1]
+static float next_random(sensor_sim_t *sim) {
+    uint32_t x = sim->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->rng_state = x;
+    return (float)x / (float)UINT32_MAX * 2.0f - 1.0f;
+}
+
+static float channel_value(sensor_sim_t *sim, const sensor_sim_channel_t *channel, float *walk) {
+    uint32_t period = channel->period_samples ? channel->period_samples : 1;
+    float phase = (float)(sim->sample_index % period) / (float)period;
+    float shape = 0.0f;
+
+    switch (channel->wave) {
+        case SENSOR_SIM_WAVE_SINE:
+            shape = sinf(2.0f * SENSOR_SIM_PI * phase);
+            break;
+        case SENSOR_SIM_WAVE_TRIANGLE:
+            shape = (phase < 0.5f) ? (4.0f * phase - 1.0f) : (3.0f - 4.0f * phase);
+            break;
+        case SENSOR_SIM_WAVE_SQUARE:
+            shape = (phase < 0.5f) ? 1.0f : -1.0f;
+            break;
+        case SENSOR_SIM_WAVE_RANDOM_WALK:
+            // Step by up to 5% of the amplitude and reflect at the bounds
+            *walk += next_random(sim) * channel->amplitude * 0.05f;
+            if (*walk > channel->amplitude) *walk = 2.0f * channel->amplitude - *walk;
+            if (*walk < -channel->amplitude) *walk = -2.0f * channel->amplitude - *walk;
+            return channel->base + *walk + next_random(sim) * channel->noise;
+        case SENSOR_SIM_WAVE_CONSTANT:
+        default:
+            break;
+    }
+
+    return channel->base + channel->amplitude * shape + next_random(sim) * channel->noise;
+}
+
+static esp_err_t sensor_sim_init(sensor_driver_t *driver) {
+    sensor_sim_t *sim = __containerof(driver, sensor_sim_t, base);
+    sim->sample_index = 0;
+    sim->rng_state = sim->config.seed ? sim->config.seed : 1;
+    sim->temperature_walk = 0.0f;
+    sim->humidity_walk = 0.0f;
+    memset(&sim->last_reading, 0, sizeof(sim->last_reading));
+    return ESP_OK;
+}
+
+static esp_err_t sensor_sim_trigger(sensor_driver_t *driver) {
+    sensor_sim_t *sim = __containerof(driver, sensor_sim_t, base);
+    const sensor_sim_config_t *config = &sim->config;
+    uint32_t index = sim->sample_index;
+
+    // Always advance the model so faults do not shift the waveform
+    float temperature = channel_value(sim, &config->temperature, &sim->temperature_walk);
+    float humidity = channel_value(sim, &config->humidity, &sim->humidity_walk);
+    sim->sample_index++;
+
+    if (config->fault_period && config->fault_length &&
+        (index % config->fault_period) < config->fault_length) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    sim->last_reading.temperature = roundf(temperature * 10.0f) / 10.0f;
+    sim->last_reading.humidity = roundf(humidity * 10.0f) / 10.0f;
+    sim->last_reading.timestamp = esp_timer_get_time() / 1000;
+    sim->last_reading.valid = !(config->invalid_period && (index % config->invalid_period) == 0);
+    return ESP_OK;
+}
+
+static esp_err_t sensor_sim_read(sensor_driver_t *driver, sensor_reading_t *reading) {
+    sensor_sim_t *sim = __containerof(driver, sensor_sim_t, base);
+    *reading = sim->last_reading;
+    return ESP_OK;
+}
+
+static void sensor_sim_get_capabilities(sensor_driver_t *driver, sensor_capabilities_t *caps) {
+    sensor_sim_t *sim = __containerof(driver, sensor_sim_t, base);
+    caps->channels = SENSOR_CHANNEL_TEMPERATURE | SENSOR_CHANNEL_HUMIDITY;
+    caps->min_interval_ms = sim->config.min_interval_ms;
+    caps->temperature_resolution = 0.1f;
+    caps->humidity_resolution = 0.1f;
+}
+
+esp_err_t sensor_sim_new(const sensor_sim_config_t *config, sensor_driver_t **ret_driver) {
+    if (config == NULL || ret_driver == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sensor_sim_t *sim = calloc(1, sizeof(sensor_sim_t));
+    if (sim == NULL) {
+        ERROR_LOG_ERROR(TAG, ESP_ERR_NO_MEM, ERROR_CAT_SYSTEM, "Failed to allocate simulated sensor");
+        return ESP_ERR_NO_MEM;
+    }
+
+    sim->base.name = "sim";
+    sim->base.init = sensor_sim_init;
+    sim->base.trigger = sensor_sim_trigger;
+    sim->base.read = sensor_sim_read;
+    sim->base.get_capabilities = sensor_sim_get_capabilities;
+    sim->config = *config;
+    sensor_sim_init(&sim->base);
+
+    *ret_driver = &sim->base;
+    return ESP_OK;
+}
+
+esp_err_t sensor_sim_del(sensor_driver_t *driver) {
+    if (driver == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    free(__containerof(driver, sensor_sim_t, base));
+    return ESP_OK;
+}
+
+static void sensor_sim_task(void *pvParameters) {
+    TickType_t last_wake_time = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(runner.interval_ms);
+    uint32_t published = 0;
+    uint32_t invalid = 0;
+    uint32_t failed = 0;
+
+    if (period == 0) {
+        period = 1;
+    }
+
+    while (1) {
+        sensor_reading_t reading;
+        esp_err_t ret = sensor_driver_trigger(runner.driver);
+        if (ret == ESP_OK) {
+            ret = sensor_driver_read(runner.driver, &reading);
+        }
+
+        if (ret == ESP_OK) {
+            // Drivers report floats; the data path carries fixed point. Invalid readings are
+            // published without SENSOR_SAMPLE_VALID so injected faults reach every consumer
+            sensor_sample_t sample;
+            sensor_sample_from_reading(&reading, &sample);
+            data_manager_publish(runner.data_handle, &sample);
+            published++;
+            invalid += !reading.valid;
+        } else {
+            failed++;
+        }
+
+        if ((published + failed) % 1000 == 0) {
+            ESP_LOGI(TAG, "%s: %lu published (%lu invalid), %lu failed", runner.source, published, invalid, failed);
+        }
+
+        vTaskDelayUntil(&last_wake_time, period);
+    }
+}
+
+esp_err_t sensor_sim_start(sensor_driver_t *driver, const char *source, uint32_t interval_ms) {
+    if (driver == NULL || source == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (runner_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sensor_capabilities_t caps;
+    sensor_driver_get_capabilities(driver, &caps);
+    if (interval_ms < caps.min_interval_ms) {
+        ERROR_LOG_WARNING(TAG, ESP_ERR_INVALID_ARG, ERROR_CAT_VALIDATION,
+                 "Interval too short for %s, using minimum %lums", driver->name, caps.min_interval_ms);
+        interval_ms = caps.min_interval_ms;
+    }
+
+    esp_err_t ret = sensor_driver_init(driver);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SENSOR, "Failed to initialize %s driver", driver->name);
+        return ret;
+    }
+
+    ret = data_manager_register_source(source, NULL, &runner.data_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    runner.driver = driver;
+    strlcpy(runner.source, source, sizeof(runner.source));
+    runner.interval_ms = interval_ms;
+
+    if (xTaskCreate(sensor_sim_task, "sensor_sim", SENSOR_SIM_TASK_STACK_SIZE,
+                    NULL, SENSOR_SIM_TASK_PRIORITY, &runner_task_handle) != pdPASS) {
+        ERROR_LOG_ERROR(TAG, ESP_FAIL, ERROR_CAT_SYSTEM, "Failed to create simulation task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Sampling %s driver as '%s' every %lu ms", driver->name, source, interval_ms);
+    return ESP_OK;
+}
+
+esp_err_t sensor_sim_stop(void) {
+    if (runner_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    vTaskDelete(runner_task_handle);
+    runner_task_handle = NULL;
+    return ESP_OK;
+}
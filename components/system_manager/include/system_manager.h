@@ -1,6 +1,7 @@
 #pragma once
 
 #include <esp_err.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -12,15 +13,26 @@ typedef struct {
     uint32_t conn_timeout_ms;
 } network_config_t;
 
+// Payload encoding of an MQTT data topic
+typedef enum {
+    MQTT_PAYLOAD_JSON = 0,
+    MQTT_PAYLOAD_CBOR,          // See mqtt_payload.h
+} mqtt_payload_format_t;
+
 // Configuration structure for MQTT settings
 typedef struct {
     char broker_url[128];
     char client_id[32];
     uint16_t keepalive;
     uint32_t timeout_ms;
-    uint32_t retry_timeout_ms;
+    uint32_t retry_timeout_ms;  // Reconnect attempt timeout, at least timeout_ms
+    uint8_t sample_format;      // mqtt_payload_format_t of /envilog/diagnostic/<source>
+    uint8_t rollup_format;      // mqtt_payload_format_t of /envilog/rollups/...
 } mqtt_config_t;
 
+// Size of mqtt_config_t before the payload formats were added
+#define MQTT_CONFIG_V1_SIZE     offsetof(mqtt_config_t, sample_format)
+
 // Configuration structure for system settings
 typedef struct {
     uint32_t task_wdt_timeout_ms;
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "system_manager.h"
 #include "network_manager.h"
 #include "task_manager.h"
@@ -76,7 +77,9 @@ esp_err_t system_manager_init(void)
         .client_id = ENVILOG_MQTT_CLIENT_ID,
         .keepalive = ENVILOG_MQTT_KEEPALIVE,
         .timeout_ms = ENVILOG_MQTT_TIMEOUT_MS,
-        .retry_timeout_ms = ENVILOG_MQTT_RETRY_TIMEOUT_MS
+        .retry_timeout_ms = ENVILOG_MQTT_RETRY_TIMEOUT_MS,
+        .sample_format = MQTT_PAYLOAD_JSON,
+        .rollup_format = MQTT_PAYLOAD_JSON
     };
 
     // Enhanced system config with new thresholds
@@ -214,10 +217,12 @@ esp_err_t system_manager_load_mqtt_config(mqtt_config_t *config)
         return ret;
     }
 
-    if (required_size != sizeof(mqtt_config_t)) {
+    // Configs saved before the payload formats default to JSON
+    if (required_size != sizeof(mqtt_config_t) && required_size != MQTT_CONFIG_V1_SIZE) {
         return ESP_ERR_INVALID_SIZE;
     }
 
+    memset(config, 0, sizeof(mqtt_config_t));
     return nvs_get_blob(nvs_config_handle, NVS_KEY_MQTT_CONFIG, config, &required_size);
 }
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_err.h"
@@ -19,9 +20,42 @@
 #include "dht11_sensor.h"
 #include "error_handler.h"
 #include "data_manager.h"
+#include "sensor_sim.h"
+#include "sensor_replay.h"
+#include "sample_store.h"
 
 static const char *TAG = "envilog";
 
+#if CONFIG_ENVILOG_MQTT_FORWARD
+static volatile bool forwarding = false;
+
+// Samples only count as unsent once something will forward them
+static bool uplink_connected(void) {
+    return !forwarding || envilog_mqtt_is_connected();
+}
+#endif
+
+// Register the additional probes listed in CONFIG_DHT11_EXTRA_GPIOS
+static void init_extra_dht11_sensors(void) {
+    char gpio_list[] = CONFIG_DHT11_EXTRA_GPIOS;
+    int index = 1;
+
+    for (char *token = strtok(gpio_list, ", "); token != NULL; token = strtok(NULL, ", ")) {
+        char source[DHT11_SOURCE_NAME_LEN];
+        snprintf(source, sizeof(source), "dht11_%d", index++);
+
+        dht11_config_t config = {
+            .gpio_num = (uint8_t)atoi(token),
+            .source = source
+        };
+        dht11_handle_t handle;
+        esp_err_t ret = dht11_new_sensor(&config, &handle);
+        if (ret != ESP_OK) {
+            ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SENSOR, "Failed to initialize %s on GPIO%s", source, token);
+        }
+    }
+}
+
 void app_main(void) {
     // Initialize logging
     esp_log_level_set(TAG, ESP_LOG_INFO);
@@ -77,7 +111,20 @@ void app_main(void) {
     // Initialize Data Manager with MQTT callback
     ESP_LOGI(TAG, "Initializing Data Manager...");
     data_manager_config_t data_config = {
+#if CONFIG_ENVILOG_MQTT_RAW_SAMPLES
         .mqtt_callback = envilog_mqtt_get_sensor_callback(),
+#endif
+#if CONFIG_ENVILOG_MQTT_REPORT_BY_EXCEPTION
+        .mqtt_deadband = {
+            .enabled = true,
+            .absolute = CONFIG_ENVILOG_MQTT_DEADBAND,
+            .percent = CONFIG_ENVILOG_MQTT_DEADBAND_PERCENT,
+            .heartbeat_ms = CONFIG_ENVILOG_MQTT_HEARTBEAT_S * 1000U,
+        },
+#endif
+#if CONFIG_ENVILOG_MQTT_FORWARD
+        .uplink_connected = uplink_connected,
+#endif
         .http_getter = NULL  // HTTP uses direct API calls
     };
 
@@ -88,12 +135,41 @@ void app_main(void) {
         return;
     }
 
+#if CONFIG_ENVILOG_MQTT_ROLLUP_LEVEL > 0
+    // Long-term storage takes rollup buckets instead of every sample
+    data_manager_subscriber_config_t rollup_subscriber = {
+        .name = "mqtt_rollup",
+        .rollup_level = CONFIG_ENVILOG_MQTT_ROLLUP_LEVEL,
+        .rollup_callback = envilog_mqtt_get_rollup_callback(),
+        .queue_depth = 0,
+        .overflow = DATA_MANAGER_OVERFLOW_DROP_NEWEST,
+    };
+    ret = data_manager_subscribe(&rollup_subscriber, NULL);
+    if (ret != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SYSTEM, "Failed to subscribe MQTT to rollups");
+    }
+#endif
+
+#if CONFIG_ENVILOG_SAMPLE_STORE
+    // Persist samples before any source starts publishing
+    ret = sample_store_init();
+    if (ret != ESP_OK) {
+        ERROR_LOG_WARNING(TAG, ret, ERROR_CAT_SYSTEM, "Sample store unavailable");
+    }
+#if CONFIG_ENVILOG_MQTT_FORWARD
+    else if (envilog_mqtt_start_forward() == ESP_OK) {
+        forwarding = true;
+    }
+#endif
+#endif
+
     // Initialize DHT11 sensor
     ESP_LOGI(TAG, "Initializing DHT11 sensor...");
     ret = dht11_init(CONFIG_DHT11_GPIO);
     if (ret != ESP_OK) {
         ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SENSOR, "Failed to initialize DHT11");
     } else {
+        init_extra_dht11_sensors();
         ret = dht11_start_reading(CONFIG_DHT11_READ_INTERVAL);
         if (ret != ESP_OK) {
             ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SENSOR, "Failed to start DHT11 readings");
@@ -102,6 +178,19 @@ void app_main(void) {
         }
     }
 
+#ifdef CONFIG_ENVILOG_SENSOR_SIM
+    // Start the simulated sensor
+    sensor_sim_config_t sim_config = SENSOR_SIM_DEFAULT_CONFIG();
+    sensor_driver_t *sim_driver;
+    ret = sensor_sim_new(&sim_config, &sim_driver);
+    if (ret == ESP_OK) {
+        ret = sensor_sim_start(sim_driver, "sim", CONFIG_ENVILOG_SENSOR_SIM_INTERVAL);
+    }
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SENSOR, "Failed to start simulated sensor");
+    }
+#endif
+
     ESP_LOGI(TAG, "Starting HTTP server...");
     ret = http_server_init_default();
     if (ret != ESP_OK) {
@@ -109,6 +198,19 @@ void app_main(void) {
         return;
     }
 
+#ifdef CONFIG_ENVILOG_SENSOR_REPLAY
+    // Replay after the HTTP server has mounted SPIFFS
+    sensor_replay_config_t replay_config = {
+        .path = CONFIG_ENVILOG_SENSOR_REPLAY_PATH,
+        .speedup = CONFIG_ENVILOG_SENSOR_REPLAY_SPEEDUP,
+        .loops = CONFIG_ENVILOG_SENSOR_REPLAY_LOOPS
+    };
+    ret = sensor_replay_start(&replay_config);
+    if (ret != ESP_OK) {
+        ERROR_LOG_ERROR(TAG, ret, ERROR_CAT_SENSOR, "Failed to start trace replay");
+    }
+#endif
+
     ESP_LOGI(TAG, "Starting diagnostics system...");
     ret = system_manager_start_diagnostics(ENVILOG_DIAG_CHECK_INTERVAL_MS);
     if (ret != ESP_OK) {
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Decode EnviLog MQTT sample and rollup payloads, JSON or CBOR.
+
+The CBOR layout is documented in components/envilog_mqtt/include/mqtt_payload.h.
+Both encodings decode to the field names of the JSON payloads, with values
+in degrees Celsius and percent:
+
+    from envilog_payload import decode_samples, decode_rollup
+    for sample in decode_samples(message.payload):
+        print(sample['timestamp'], sample['temperature'])
+
+or from the command line, with a payload saved by e.g. mosquitto_sub -N:
+
+    tools/envilog_payload.py sample payload.bin
+"""
+
+import argparse
+import json
+import sys
+
+SAMPLE_KEYS = {0: 'timestamp', 1: 'temperature', 2: 'humidity',
+               3: 'temperature_filtered', 4: 'humidity_filtered', 5: 'filter'}
+ROLLUP_KEYS = {0: 'start', 1: 'temperature', 2: 'humidity', 6: 'resolution_s', 7: 'count'}
+SUMMARY_FIELDS = ('min', 'max', 'mean', 'p5', 'p50', 'p95')
+CENTI_FIELDS = ('temperature', 'humidity', 'temperature_filtered', 'humidity_filtered')
+
+_BREAK = object()
+
+
+class CborDecoder:
+    """Minimal RFC 8949 decoder for the subset the firmware emits."""
+
+    def __init__(self, data):
+        self.data = bytes(data)
+        self.pos = 0
+
+    def _take(self, count):
+        if self.pos + count > len(self.data):
+            raise ValueError('truncated CBOR payload')
+        chunk = self.data[self.pos:self.pos + count]
+        self.pos += count
+        return chunk
+
+    def _argument(self, info):
+        if info < 24:
+            return info
+        if info == 31:
+            return None
+        widths = {24: 1, 25: 2, 26: 4, 27: 8}
+        if info not in widths:
+            raise ValueError('reserved CBOR argument %d' % info)
+        return int.from_bytes(self._take(widths[info]), 'big')
+
+    def decode(self):
+        initial = self._take(1)[0]
+        major, info = initial >> 5, initial & 0x1f
+        if initial == 0xff:
+            return _BREAK
+        value = self._argument(info)
+        if major == 0:
+            return value
+        if major == 1:
+            return -1 - value
+        if major in (2, 3):
+            if value is None:
+                raise ValueError('indefinite strings are not used')
+            chunk = self._take(value)
+            return chunk if major == 2 else chunk.decode('utf-8')
+        if major == 4:
+            items = []
+            while value is None or len(items) < value:
+                item = self.decode()
+                if item is _BREAK:
+                    break
+                items.append(item)
+            return items
+        if major == 5:
+            items = {}
+            while value is None or len(items) < value:
+                key = self.decode()
+                if key is _BREAK:
+                    break
+                items[key] = self.decode()
+            return items
+        if major == 7 and info in (20, 21, 22):
+            return {20: False, 21: True, 22: None}[info]
+        raise ValueError('unsupported CBOR item 0x%02x' % initial)
+
+
+def decode_cbor(data):
+    decoder = CborDecoder(data)
+    value = decoder.decode()
+    if decoder.pos != len(decoder.data):
+        raise ValueError('trailing bytes after CBOR item')
+    return value
+
+
+def is_json(payload):
+    return bytes(payload[:1]) in (b'{', b'[')
+
+
+def _centi(value):
+    return value / 100.0
+
+
+def _sample_from_cbor(item):
+    sample = {SAMPLE_KEYS[key]: value for key, value in item.items() if key in SAMPLE_KEYS}
+    for field in CENTI_FIELDS:
+        if field in sample:
+            sample[field] = _centi(sample[field])
+    return sample
+
+
+def decode_samples(payload):
+    """Return the samples of a /envilog/diagnostic/<source> or /envilog/forward/<source>/<boot> message as a list of dicts."""
+    if is_json(payload):
+        value = json.loads(bytes(payload).decode('utf-8'))
+        return value if isinstance(value, list) else [value]
+    value = decode_cbor(payload)
+    items = value if isinstance(value, list) else [value]
+    return [_sample_from_cbor(item) for item in items]
+
+
+def decode_rollup(payload):
+    """Return a /envilog/rollups/<source>/<seconds> message as a dict."""
+    if is_json(payload):
+        return json.loads(bytes(payload).decode('utf-8'))
+    item = decode_cbor(payload)
+    rollup = {}
+    for key, value in item.items():
+        name = ROLLUP_KEYS.get(key)
+        if name in ('temperature', 'humidity'):
+            rollup[name] = {field: _centi(v) for field, v in zip(SUMMARY_FIELDS, value)}
+        elif name is not None:
+            rollup[name] = value
+    return rollup
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('kind', choices=('sample', 'rollup'), help='topic the payload came from')
+    parser.add_argument('payload', help='payload file, - for stdin')
+    args = parser.parse_args()
+
+    if args.payload == '-':
+        payload = sys.stdin.buffer.read()
+    else:
+        with open(args.payload, 'rb') as f:
+            payload = f.read()
+
+    decoded = decode_samples(payload) if args.kind == 'sample' else decode_rollup(payload)
+    json.dump(decoded, sys.stdout, indent=2)
+    print()
+
+
+if __name__ == '__main__':
+    main()
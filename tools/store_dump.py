@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Decode a dump of the EnviLog "tsdata" sample store partition.
+
+Read the partition off a device with
+
+    parttool.py --port PORT read_partition --partition-name tsdata --output tsdata.bin
+
+then print its samples as CSV, oldest first:
+
+    tools/store_dump.py tsdata.bin > samples.csv
+
+Layouts are documented in components/sample_store/include/sample_store.h and
+components/data_manager/include/ts_block.h.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+SEGMENT_SIZE = 4096
+PAGE_SIZE = 256
+RECORD_HEADER_SIZE = 32
+BLOCK_HEADER_SIZE = 16
+MAGIC = 0x52564E45
+BLOCK_VERSION = 1
+SAMPLE_VALID = 0x01
+
+TIMESTAMP_WIDTHS = (0, 7, 12, 20, 32)
+VALUE_WIDTHS = (0, 6, 10, 17)
+
+
+class BitReader:
+    def __init__(self, data, bits):
+        self.data = data
+        self.bits = bits
+        self.pos = 0
+
+    def read(self, width):
+        if self.pos + width > self.bits:
+            raise EOFError
+        value = 0
+        for _ in range(width):
+            value = (value << 1) | ((self.data[self.pos // 8] >> (7 - self.pos % 8)) & 1)
+            self.pos += 1
+        return value
+
+    def prefix(self, limit):
+        ones = 0
+        while ones < limit and self.read(1):
+            ones += 1
+        return ones
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def read_code(reader, widths):
+    prefix = reader.prefix(len(widths) - 1)
+    return unzigzag(reader.read(widths[prefix])) if prefix else 0
+
+
+def decode_block(block):
+    """Yield (timestamp_ms, temperature, humidity, flags) with values in centi-units."""
+    version, flags, count, timestamp, temperature, humidity, bits = struct.unpack_from('<BBHIhhH', block)
+    if version != BLOCK_VERSION or count == 0:
+        return
+    yield timestamp, temperature, humidity, flags
+
+    reader = BitReader(block[BLOCK_HEADER_SIZE:], bits)
+    delta = 0
+    try:
+        for _ in range(count - 1):
+            delta += read_code(reader, TIMESTAMP_WIDTHS)
+            timestamp = (timestamp + delta) & 0xffffffff
+            temperature += read_code(reader, VALUE_WIDTHS)
+            humidity += read_code(reader, VALUE_WIDTHS)
+            if reader.read(1):
+                flags = reader.read(8)
+            yield timestamp, temperature, humidity, flags
+    except EOFError:
+        return
+
+
+def read_records(dump):
+    """Return valid records as (seq, boot, source, block) plus the count of torn pages."""
+    records = []
+    torn = 0
+    for offset in range(0, len(dump) - PAGE_SIZE + 1, PAGE_SIZE):
+        page = dump[offset:offset + PAGE_SIZE]
+        if page == b'\xff' * PAGE_SIZE:
+            continue
+        magic, crc, seq, boot = struct.unpack_from('<IIII', page)
+        bits = struct.unpack_from('<H', page, RECORD_HEADER_SIZE + 12)[0]
+        length = RECORD_HEADER_SIZE + BLOCK_HEADER_SIZE + (bits + 7) // 8
+        if magic != MAGIC or length > PAGE_SIZE or zlib.crc32(page[8:length]) != crc:
+            torn += 1
+            continue
+        source = page[16:RECORD_HEADER_SIZE].split(b'\0', 1)[0].decode('utf-8', 'replace')
+        records.append((seq, boot, source, page[RECORD_HEADER_SIZE:length]))
+    records.sort(key=lambda record: record[0])
+    return records, torn
+
+
+def centi(value):
+    return '%s%d.%02d' % ('-' if value < 0 else '', abs(value) // 100, abs(value) % 100)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('dump', help='tsdata partition image')
+    parser.add_argument('--source', help='only print this source')
+    parser.add_argument('--all', action='store_true', help='include samples not flagged valid')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        dump = f.read()
+
+    records, torn = read_records(dump)
+
+    # Timestamps are the low 32 bits of ms since boot; unwrap them per boot and source
+    uptime_high = {}
+    last_timestamp = {}
+    samples = 0
+    print('seq,boot,source,uptime_ms,temperature,humidity,flags')
+    for seq, boot, source, block in records:
+        if args.source and source != args.source:
+            continue
+        key = (boot, source)
+        for timestamp, temperature, humidity, flags in decode_block(block):
+            if key in last_timestamp and timestamp < last_timestamp[key]:
+                uptime_high[key] = uptime_high.get(key, 0) + (1 << 32)
+            last_timestamp[key] = timestamp
+            if not args.all and not flags & SAMPLE_VALID:
+                continue
+            print('%d,%d,%s,%d,%s,%s,0x%02x' % (seq, boot, source, uptime_high.get(key, 0) + timestamp,
+                                                centi(temperature), centi(humidity), flags))
+            samples += 1
+
+    segments = len(dump) // SEGMENT_SIZE
+    print('%d records, %d samples, %d torn pages, %d segments' % (len(records), samples, torn, segments),
+          file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()